@@ -15,6 +15,7 @@ static struct bfqio_cgroup bfqio_root_cgroup = {
 	.weight = BFQ_DEFAULT_GRP_WEIGHT,
 	.ioprio = BFQ_DEFAULT_GRP_IOPRIO,
 	.ioprio_class = BFQ_DEFAULT_GRP_CLASS,
+	.launch_raising = 1,
 };
 
 static inline void bfq_init_entity(struct bfq_entity *entity,
@@ -65,6 +66,7 @@ static inline void bfq_group_init_entity(struct bfqio_cgroup *bgrp,
 	entity->ioprio_class = entity->new_ioprio_class = bgrp->ioprio_class;
 	entity->ioprio_changed = 1;
 	entity->my_sched_data = &bfqg->sched_data;
+	bfqg->launch_raising = bgrp->launch_raising;
 }
 
 static inline void bfq_group_set_parent(struct bfq_group *bfqg,
@@ -520,11 +522,21 @@ static struct bfq_group *bfq_alloc_root_group(struct bfq_data *bfqd, int node)
 	spin_lock_irq(&bgrp->lock);
 	rcu_assign_pointer(bfqg->bfqd, bfqd);
 	hlist_add_head_rcu(&bfqg->group_node, &bgrp->group_data);
+	bfqg->launch_raising = bgrp->launch_raising;
 	spin_unlock_irq(&bgrp->lock);
 
 	return bfqg;
 }
 
+/*
+ * Whether queues created by young processes of @bfqg may get the
+ * application launch weight raising.  Called with the queue lock held.
+ */
+static inline int bfq_group_launch_raising(struct bfq_group *bfqg)
+{
+	return bfqg->launch_raising;
+}
+
 #define SHOW_FUNCTION(__VAR)						\
 static u64 bfqio_cgroup_##__VAR##_read(struct cgroup *cgroup,		\
 				       struct cftype *cftype)		\
@@ -548,6 +560,7 @@ static u64 bfqio_cgroup_##__VAR##_read(struct cgroup *cgroup,		\
 SHOW_FUNCTION(weight);
 SHOW_FUNCTION(ioprio);
 SHOW_FUNCTION(ioprio_class);
+SHOW_FUNCTION(launch_raising);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__VAR, __MIN, __MAX)				\
@@ -586,6 +599,38 @@ STORE_FUNCTION(ioprio, 0, IOPRIO_BE_NR - 1);
 STORE_FUNCTION(ioprio_class, IOPRIO_CLASS_RT, IOPRIO_CLASS_IDLE);
 #undef STORE_FUNCTION
 
+/*
+ * launch_raising is not an entity parameter, so it does not need to go
+ * through the ioprio_changed machinery: the groups just pick up the new
+ * value for the queues created from now on.
+ */
+static int bfqio_cgroup_launch_raising_write(struct cgroup *cgroup,
+					     struct cftype *cftype,
+					     u64 val)
+{
+	struct bfqio_cgroup *bgrp;
+	struct bfq_group *bfqg;
+	struct hlist_node *n;
+
+	if (val > 1)
+		return -EINVAL;
+
+	if (!cgroup_lock_live_group(cgroup))
+		return -ENODEV;
+
+	bgrp = cgroup_to_bfqio(cgroup);
+
+	spin_lock_irq(&bgrp->lock);
+	bgrp->launch_raising = (unsigned short)val;
+	hlist_for_each_entry(bfqg, n, &bgrp->group_data, group_node)
+		bfqg->launch_raising = (int)val;
+	spin_unlock_irq(&bgrp->lock);
+
+	cgroup_unlock();
+
+	return 0;
+}
+
 static struct cftype bfqio_files[] = {
 	{
 		.name = "weight",
@@ -602,6 +647,11 @@ static struct cftype bfqio_files[] = {
 		.read_u64 = bfqio_cgroup_ioprio_class_read,
 		.write_u64 = bfqio_cgroup_ioprio_class_write,
 	},
+	{
+		.name = "launch_raising",
+		.read_u64 = bfqio_cgroup_launch_raising_read,
+		.write_u64 = bfqio_cgroup_launch_raising_write,
+	},
 };
 
 static int bfqio_populate(struct cgroup_subsys *subsys, struct cgroup *cgroup)
@@ -626,6 +676,9 @@ static struct cgroup_subsys_state *bfqio_create(struct cgroup_subsys *subsys,
 	INIT_HLIST_HEAD(&bgrp->group_data);
 	bgrp->ioprio = BFQ_DEFAULT_GRP_IOPRIO;
 	bgrp->ioprio_class = BFQ_DEFAULT_GRP_CLASS;
+	if (cgroup->parent != NULL)
+		bgrp->launch_raising =
+			cgroup_to_bfqio(cgroup->parent)->launch_raising;
 
 	return &bgrp->css;
 }
@@ -766,4 +819,9 @@ static struct bfq_group *bfq_alloc_root_group(struct bfq_data *bfqd, int node)
 
 	return bfqg;
 }
+
+static inline int bfq_group_launch_raising(struct bfq_group *bfqg)
+{
+	return 1;
+}
 #endif
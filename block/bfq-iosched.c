@@ -469,10 +469,31 @@ static void bfq_add_rq_rb(struct request *rq)
 			goto add_bfqq_busy;
 
 		/*
-		 * If the queue is not being boosted and has been idle
-		 * for enough time, start a weight-raising period
+		 * A launching application is expected to start with a
+		 * burst of sync reads; if it starts writing instead, it
+		 * is not what we are looking for.
 		 */
-		if(old_raising_coeff == 1 && (idle_for_long_time || soft_rt)) {
+		if (old_raising_coeff == 1 && bfq_bfqq_launch(bfqq) &&
+		    rq_data_dir(rq) != READ)
+			bfq_clear_bfqq_launch(bfqq);
+
+		/*
+		 * If the queue is not being boosted and either belongs
+		 * to a launching application or has been idle for enough
+		 * time, start a weight-raising period.  The period of a
+		 * launching application is bounded by its own tunable.
+		 */
+		if (old_raising_coeff == 1 && bfq_bfqq_launch(bfqq)) {
+			bfqq->raising_coeff = bfqd->bfq_raising_coeff;
+			bfqq->raising_cur_max_time =
+				bfqd->bfq_raising_launch_max_time;
+			bfq_log_bfqq(bfqd, bfqq,
+				     "launch wrais starting, "
+				     "rais_max_time %u",
+				     jiffies_to_msecs(bfqq->
+					raising_cur_max_time));
+		} else if(old_raising_coeff == 1 &&
+			  (idle_for_long_time || soft_rt)) {
 			bfqq->raising_coeff = bfqd->bfq_raising_coeff;
 			bfqq->raising_cur_max_time = idle_for_long_time ?
 				bfqd->bfq_raising_max_time :
@@ -484,7 +505,7 @@ static void bfq_add_rq_rb(struct request *rq)
 				     jiffies_to_msecs(bfqq->
 					raising_cur_max_time));
 		} else if (old_raising_coeff > 1) {
-			if (idle_for_long_time)
+			if (idle_for_long_time && !bfq_bfqq_launch(bfqq))
 				bfqq->raising_cur_max_time =
 					bfqd->bfq_raising_max_time;
 			else if (bfqq->raising_cur_max_time ==
@@ -1532,6 +1553,8 @@ static void update_raising_data(struct bfq_data *bfqd, struct bfq_queue *bfqq)
 			int soft_rt = bfqd->bfq_raising_max_softrt_rate > 0 &&
 				bfqq->soft_rt_next_start < jiffies;
 
+			/* a launch is weight-raised only once */
+			bfq_clear_bfqq_launch(bfqq);
 			bfqq->last_rais_start_finish = jiffies;
 			if (soft_rt)
 				bfqq->raising_cur_max_time =
@@ -1887,6 +1910,42 @@ static void bfq_init_bfqq(struct bfq_data *bfqd, struct bfq_queue *bfqq,
 	bfqq->soft_rt_next_start = -1;
 }
 
+/*
+ * A sync queue created by a process that started less than
+ * bfq_raising_launch_window ago most likely belongs to an application
+ * being launched, and is marked so that its first burst of reads gets
+ * a weight-raising period bounded by bfq_raising_launch_max_time.
+ *
+ * Groups that opted out of launch raising (e.g., the ones containing
+ * media scanners or package installers) do not even get the start-up
+ * raising that any new queue would otherwise receive for looking idle
+ * for a long time: their new queues are considered as just idled.
+ */
+static void bfq_check_launch(struct bfq_data *bfqd, struct bfq_queue *bfqq,
+			     struct bfq_group *bfqg)
+{
+	struct timespec now, age;
+
+	if (!bfqd->low_latency)
+		return;
+
+	if (!bfq_group_launch_raising(bfqg)) {
+		bfqq->budget_timeout = jiffies;
+		return;
+	}
+
+	if (bfqd->bfq_raising_launch_max_time == 0)
+		return;
+
+	do_posix_clock_monotonic_gettime(&now);
+	age = timespec_sub(now, current->group_leader->start_time);
+	if (timespec_to_jiffies(&age) < bfqd->bfq_raising_launch_window) {
+		bfq_mark_bfqq_launch(bfqq);
+		bfq_log_bfqq(bfqd, bfqq, "launching, age %u msec",
+			     jiffies_to_msecs(timespec_to_jiffies(&age)));
+	}
+}
+
 static struct bfq_queue *bfq_find_alloc_queue(struct bfq_data *bfqd,
 					      struct bfq_group *bfqg,
 					      int is_sync,
@@ -1927,6 +1986,8 @@ retry:
 		if (bfqq != NULL) {
 			bfq_init_bfqq(bfqd, bfqq, current->pid, is_sync);
 			bfq_log_bfqq(bfqd, bfqq, "allocated");
+			if (is_sync)
+				bfq_check_launch(bfqd, bfqq, bfqg);
 		} else {
 			bfqq = &bfqd->oom_bfqq;
 			bfq_log_bfqq(bfqd, bfqq, "using oom bfqq");
@@ -2665,6 +2726,8 @@ static void *bfq_init_queue(struct request_queue *q)
 	bfqd->bfq_raising_max_time = msecs_to_jiffies(7500);
 	bfqd->bfq_raising_min_idle_time = msecs_to_jiffies(2000);
 	bfqd->bfq_raising_max_softrt_rate = 7000;
+	bfqd->bfq_raising_launch_max_time = msecs_to_jiffies(3000);
+	bfqd->bfq_raising_launch_window = msecs_to_jiffies(1000);
 
 	return bfqd;
 }
@@ -2768,6 +2831,10 @@ SHOW_FUNCTION(bfq_raising_min_idle_time_show, bfqd->bfq_raising_min_idle_time,
 	1);
 SHOW_FUNCTION(bfq_raising_max_softrt_rate_show,
 	bfqd->bfq_raising_max_softrt_rate, 0);
+SHOW_FUNCTION(bfq_raising_launch_max_time_show,
+	bfqd->bfq_raising_launch_max_time, 1);
+SHOW_FUNCTION(bfq_raising_launch_window_show,
+	bfqd->bfq_raising_launch_window, 1);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -2810,6 +2877,10 @@ STORE_FUNCTION(bfq_raising_min_idle_time_store,
 	       &bfqd->bfq_raising_min_idle_time, 0, INT_MAX, 1);
 STORE_FUNCTION(bfq_raising_max_softrt_rate_store,
 	       &bfqd->bfq_raising_max_softrt_rate, 0, INT_MAX, 0);
+STORE_FUNCTION(bfq_raising_launch_max_time_store,
+	       &bfqd->bfq_raising_launch_max_time, 0, INT_MAX, 1);
+STORE_FUNCTION(bfq_raising_launch_window_store,
+	       &bfqd->bfq_raising_launch_window, 0, INT_MAX, 1);
 #undef STORE_FUNCTION
 
 /* do nothing for the moment */
@@ -2902,6 +2973,8 @@ static struct elv_fs_entry bfq_attrs[] = {
 	BFQ_ATTR(raising_rt_max_time),
 	BFQ_ATTR(raising_min_idle_time),
 	BFQ_ATTR(raising_max_softrt_rate),
+	BFQ_ATTR(raising_launch_max_time),
+	BFQ_ATTR(raising_launch_window),
 	BFQ_ATTR(weights),
 	__ATTR_NULL
 };
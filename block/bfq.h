@@ -295,6 +295,10 @@ struct bfq_queue {
  *			       may be reactivated for a queue (in jiffies)
  * @bfq_raising_max_softrt_rate: max service-rate for a soft real-time queue,
  *			         sectors per seconds
+ * @bfq_raising_launch_max_time: duration of the weight-raising period granted
+ *				 to a launching application (0 disables it)
+ * @bfq_raising_launch_window: maximum age of a process for its new queues to
+ *			       be considered part of an application launch
  * @oom_bfqq: fallback dummy bfqq for extreme OOM conditions
  *
  * All the fields are protected by the @queue lock.
@@ -356,6 +360,8 @@ struct bfq_data {
 	unsigned int bfq_raising_rt_max_time;
 	unsigned int bfq_raising_min_idle_time;
 	unsigned int bfq_raising_max_softrt_rate;
+	unsigned int bfq_raising_launch_max_time;
+	unsigned int bfq_raising_launch_window;
 
 	struct bfq_queue oom_bfqq;
 };
@@ -372,6 +378,7 @@ enum bfqq_state_flags {
 	BFQ_BFQQ_FLAG_coop,		/* bfqq is shared */
 	BFQ_BFQQ_FLAG_split_coop,	/* shared bfqq will be splitted */
 	BFQ_BFQQ_FLAG_some_coop_idle,   /* some cooperator is inactive */
+	BFQ_BFQQ_FLAG_launch,		/* created by a launching process */
 };
 
 #define BFQ_BFQQ_FNS(name)						\
@@ -399,6 +406,7 @@ BFQ_BFQQ_FNS(budget_new);
 BFQ_BFQQ_FNS(coop);
 BFQ_BFQQ_FNS(split_coop);
 BFQ_BFQQ_FNS(some_coop_idle);
+BFQ_BFQQ_FNS(launch);
 #undef BFQ_BFQQ_FNS
 
 /* Logging facilities. */
@@ -433,6 +441,8 @@ enum bfqq_expiration {
  * @async_idle_bfqq: async queue for the idle class (ioprio is ignored).
  * @my_entity: pointer to @entity, %NULL for the toplevel group; used
  *             to avoid too many special cases during group creation/migration.
+ * @launch_raising: whether new processes in the group may have their
+ *                  start-up I/O weight-raised.
  *
  * Each (device, cgroup) pair has its own bfq_group, i.e., for each cgroup
  * there is a set of bfq_groups, each one collecting the lower-level
@@ -458,6 +468,8 @@ struct bfq_group {
 	struct bfq_queue *async_idle_bfqq;
 
 	struct bfq_entity *my_entity;
+
+	int launch_raising;
 };
 
 /**
@@ -466,7 +478,9 @@ struct bfq_group {
  * @weight: cgroup weight.
  * @ioprio: cgroup ioprio.
  * @ioprio_class: cgroup ioprio_class.
- * @lock: spinlock that protects @ioprio, @ioprio_class and @group_data.
+ * @launch_raising: cgroup launch_raising flag, see struct bfq_group.
+ * @lock: spinlock that protects @ioprio, @ioprio_class, @launch_raising
+ *        and @group_data.
  * @group_data: list containing the bfq_group belonging to this cgroup.
  *
  * @group_data is accessed using RCU, with @lock protecting the updates,
@@ -476,6 +490,7 @@ struct bfqio_cgroup {
 	struct cgroup_subsys_state css;
 
 	unsigned short weight, ioprio, ioprio_class;
+	unsigned short launch_raising;
 
 	spinlock_t lock;
 	struct hlist_head group_data;
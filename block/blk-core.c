@@ -27,6 +27,7 @@
 #include <linux/writeback.h>
 #include <linux/task_io_accounting_ops.h>
 #include <linux/fault-inject.h>
+#include <linux/list_sort.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/block.h>
@@ -606,6 +607,9 @@ blk_init_allocated_queue_node(struct request_queue *q, request_fn_proc *rfn,
 	if (blk_init_free_list(q))
 		return NULL;
 
+	if (blk_latency_hist_init(q))
+		return NULL;
+
 	q->request_fn		= rfn;
 	q->prep_rq_fn		= NULL;
 	q->unprep_rq_fn		= NULL;
@@ -1192,15 +1196,99 @@ static inline bool queue_should_plug(struct request_queue *q)
 	return !(blk_queue_nonrot(q) && blk_queue_tagged(q));
 }
 
+static bool bio_attempt_back_merge(struct request_queue *q, struct request *req,
+				   struct bio *bio)
+{
+	const unsigned long ff = bio->bi_rw & REQ_FAILFAST_MASK;
+
+	if (!ll_back_merge_fn(q, req, bio))
+		return false;
+
+	trace_block_bio_backmerge(q, bio);
+
+	if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff)
+		blk_rq_set_mixed_merge(req);
+
+	req->biotail->bi_next = bio;
+	req->biotail = bio;
+	req->__data_len += bio->bi_size;
+	req->ioprio = ioprio_best(req->ioprio, bio_prio(bio));
+	if (!blk_rq_cpu_valid(req))
+		req->cpu = bio->bi_comp_cpu;
+	drive_stat_acct(req, 0);
+	elv_bio_merged(q, req, bio);
+	return true;
+}
+
+static bool bio_attempt_front_merge(struct request_queue *q,
+				    struct request *req, struct bio *bio)
+{
+	const unsigned long ff = bio->bi_rw & REQ_FAILFAST_MASK;
+
+	if (!ll_front_merge_fn(q, req, bio))
+		return false;
+
+	trace_block_bio_frontmerge(q, bio);
+
+	if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff) {
+		blk_rq_set_mixed_merge(req);
+		req->cmd_flags &= ~REQ_FAILFAST_MASK;
+		req->cmd_flags |= ff;
+	}
+
+	bio->bi_next = req->bio;
+	req->bio = bio;
+
+	/*
+	 * may not be valid. if the low level driver said
+	 * it didn't need a bounce buffer then it better
+	 * not touch req->buffer either...
+	 */
+	req->buffer = bio_data(bio);
+	req->__sector = bio->bi_sector;
+	req->__data_len += bio->bi_size;
+	req->ioprio = ioprio_best(req->ioprio, bio_prio(bio));
+	if (!blk_rq_cpu_valid(req))
+		req->cpu = bio->bi_comp_cpu;
+	drive_stat_acct(req, 0);
+	elv_bio_merged(q, req, bio);
+	return true;
+}
+
+/*
+ * Attempts to merge with the plugged list in the current process. Returns
+ * true if merge was successful, otherwise false.  The plugged requests
+ * belong to this task only, so no queue lock is needed.
+ */
+static bool attempt_plug_merge(struct task_struct *tsk, struct request_queue *q,
+			       struct bio *bio)
+{
+	struct blk_plug *plug = tsk->plug;
+	struct request *rq;
+
+	list_for_each_entry_reverse(rq, &plug->list, queuelist) {
+		if (rq->q != q || !elv_rq_merge_ok(rq, bio))
+			continue;
+
+		if (blk_rq_pos(rq) + blk_rq_sectors(rq) == bio->bi_sector) {
+			if (bio_attempt_back_merge(q, rq, bio))
+				return true;
+		} else if (blk_rq_pos(rq) - bio_sectors(bio) == bio->bi_sector) {
+			if (bio_attempt_front_merge(q, rq, bio))
+				return true;
+		}
+	}
+
+	return false;
+}
+
 static int __make_request(struct request_queue *q, struct bio *bio)
 {
 	struct request *req;
 	int el_ret;
-	unsigned int bytes = bio->bi_size;
-	const unsigned short prio = bio_prio(bio);
 	const bool sync = !!(bio->bi_rw & REQ_SYNC);
 	const bool unplug = !!(bio->bi_rw & REQ_UNPLUG);
-	const unsigned long ff = bio->bi_rw & REQ_FAILFAST_MASK;
+	struct blk_plug *plug;
 	int rw_flags;
 
 	if ((bio->bi_rw & REQ_HARDBARRIER) &&
@@ -1215,6 +1303,21 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	 */
 	blk_queue_bounce(q, &bio);
 
+	/*
+	 * Barriers are ordered against everything already submitted, so
+	 * push out whatever this task has plugged and queue the barrier
+	 * the old way.  Everything else first tries to merge into the
+	 * task's own plugged requests, which doesn't need the queue lock.
+	 */
+	plug = current->plug;
+	if (plug) {
+		if (unlikely(bio->bi_rw & REQ_HARDBARRIER)) {
+			blk_flush_plug_list(plug, false);
+			plug = NULL;
+		} else if (attempt_plug_merge(current, q, bio))
+			return 0;
+	}
+
 	spin_lock_irq(q->queue_lock);
 
 	if (unlikely((bio->bi_rw & REQ_HARDBARRIER)) || elv_queue_empty(q))
@@ -1225,22 +1328,9 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	case ELEVATOR_BACK_MERGE:
 		BUG_ON(!rq_mergeable(req));
 
-		if (!ll_back_merge_fn(q, req, bio))
+		if (!bio_attempt_back_merge(q, req, bio))
 			break;
 
-		trace_block_bio_backmerge(q, bio);
-
-		if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff)
-			blk_rq_set_mixed_merge(req);
-
-		req->biotail->bi_next = bio;
-		req->biotail = bio;
-		req->__data_len += bytes;
-		req->ioprio = ioprio_best(req->ioprio, prio);
-		if (!blk_rq_cpu_valid(req))
-			req->cpu = bio->bi_comp_cpu;
-		drive_stat_acct(req, 0);
-		elv_bio_merged(q, req, bio);
 		if (!attempt_back_merge(q, req))
 			elv_merged_request(q, req, el_ret);
 		goto out;
@@ -1248,33 +1338,9 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	case ELEVATOR_FRONT_MERGE:
 		BUG_ON(!rq_mergeable(req));
 
-		if (!ll_front_merge_fn(q, req, bio))
+		if (!bio_attempt_front_merge(q, req, bio))
 			break;
 
-		trace_block_bio_frontmerge(q, bio);
-
-		if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff) {
-			blk_rq_set_mixed_merge(req);
-			req->cmd_flags &= ~REQ_FAILFAST_MASK;
-			req->cmd_flags |= ff;
-		}
-
-		bio->bi_next = req->bio;
-		req->bio = bio;
-
-		/*
-		 * may not be valid. if the low level driver said
-		 * it didn't need a bounce buffer then it better
-		 * not touch req->buffer either...
-		 */
-		req->buffer = bio_data(bio);
-		req->__sector = bio->bi_sector;
-		req->__data_len += bytes;
-		req->ioprio = ioprio_best(req->ioprio, prio);
-		if (!blk_rq_cpu_valid(req))
-			req->cpu = bio->bi_comp_cpu;
-		drive_stat_acct(req, 0);
-		elv_bio_merged(q, req, bio);
 		if (!attempt_front_merge(q, req))
 			elv_merged_request(q, req, el_ret);
 		goto out;
@@ -1308,10 +1374,29 @@ get_rq:
 	 */
 	init_request_from_bio(req, bio);
 
-	spin_lock_irq(q->queue_lock);
 	if (test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags) ||
 	    bio_flagged(bio, BIO_CPU_AFFINE))
-		req->cpu = blk_cpu_to_group(smp_processor_id());
+		req->cpu = blk_cpu_to_group(raw_smp_processor_id());
+
+	if (plug) {
+		/*
+		 * Keep the request on the task's plug list, it is inserted
+		 * into the queue when the plug is flushed.
+		 */
+		if (!list_empty(&plug->list) && !plug->should_sort) {
+			struct request *__rq = list_entry_rq(plug->list.prev);
+
+			if (__rq->q != q)
+				plug->should_sort = 1;
+		}
+		list_add_tail(&req->queuelist, &plug->list);
+		plug->count++;
+		if (plug->count >= BLK_MAX_REQUEST_COUNT)
+			blk_flush_plug_list(plug, false);
+		return 0;
+	}
+
+	spin_lock_irq(q->queue_lock);
 	if (queue_should_plug(q) && elv_queue_empty(q))
 		blk_plug_device(q);
 	add_request(q, req);
@@ -2181,6 +2266,7 @@ static void blk_finish_request(struct request *req, int error)
 
 
 	blk_account_io_done(req);
+	blk_latency_account(req);
 
 	if (req->end_io)
 		req->end_io(req, error);
@@ -2580,6 +2666,150 @@ int kblockd_schedule_work(struct request_queue *q, struct work_struct *work)
 }
 EXPORT_SYMBOL(kblockd_schedule_work);
 
+#define PLUG_MAGIC	0x91827364
+
+/**
+ * blk_start_plug - initialize blk_plug and track it inside the task_struct
+ * @plug:	The &struct blk_plug that needs to be initialized
+ *
+ * Description:
+ *   Tracking blk_plug inside the task_struct will help with auto-flushing the
+ *   pending I/O should the task end up blocking between blk_start_plug() and
+ *   blk_finish_plug(). This is important from a performance perspective, but
+ *   also ensures that we don't deadlock. For instance, if the task is blocking
+ *   for a memory allocation, memory reclaim could end up wanting to free a
+ *   page belonging to that request that is currently residing in our private
+ *   plug. By flushing the pending I/O when the process goes to sleep, we avoid
+ *   this kind of deadlock.
+ */
+void blk_start_plug(struct blk_plug *plug)
+{
+	struct task_struct *tsk = current;
+
+	plug->magic = PLUG_MAGIC;
+	INIT_LIST_HEAD(&plug->list);
+	plug->count = 0;
+	plug->should_sort = 0;
+
+	/*
+	 * If this is a nested plug, don't actually assign it. It will be
+	 * flushed on its own.
+	 */
+	if (!tsk->plug) {
+		/*
+		 * Store ordering should not be needed here, since a potential
+		 * preempt will imply a full memory barrier
+		 */
+		tsk->plug = plug;
+	}
+}
+EXPORT_SYMBOL(blk_start_plug);
+
+static int plug_rq_cmp(void *priv, struct list_head *a, struct list_head *b)
+{
+	struct request *rqa = container_of(a, struct request, queuelist);
+	struct request *rqb = container_of(b, struct request, queuelist);
+
+	return !(rqa->q <= rqb->q);
+}
+
+/*
+ * Called with the queue lock held once all of this task's plugged
+ * requests for @q have been inserted.  When called from schedule() the
+ * request_fn is kicked from kblockd instead, so that we neither recurse
+ * into the driver from the scheduler nor grow the sleeping task's stack.
+ */
+static void queue_unplugged(struct request_queue *q, bool from_schedule)
+{
+	trace_block_unplug_io(q);
+
+	if (unlikely(blk_queue_stopped(q)))
+		return;
+
+	if (from_schedule) {
+		queue_flag_set(QUEUE_FLAG_PLUGGED, q);
+		kblockd_schedule_work(q, &q->unplug_work);
+	} else
+		__blk_run_queue(q);
+}
+
+/**
+ * blk_flush_plug_list - hand a task's plugged requests to their queues
+ * @plug:		The &struct blk_plug to flush
+ * @from_schedule:	called from schedule() on behalf of a sleeping task
+ *
+ * Description:
+ *   All requests on @plug are inserted into the elevator of their queue,
+ *   taking each queue lock once for the whole batch, and the queues are
+ *   then run.
+ */
+void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
+{
+	struct request_queue *q;
+	unsigned long flags;
+	struct request *rq;
+	LIST_HEAD(list);
+
+	BUG_ON(plug->magic != PLUG_MAGIC);
+
+	if (list_empty(&plug->list))
+		return;
+
+	list_splice_init(&plug->list, &list);
+	plug->count = 0;
+
+	if (plug->should_sort) {
+		list_sort(NULL, &list, plug_rq_cmp);
+		plug->should_sort = 0;
+	}
+
+	q = NULL;
+
+	/*
+	 * Save and disable interrupts here, to avoid doing it for every
+	 * queue lock we have to take.
+	 */
+	local_irq_save(flags);
+	while (!list_empty(&list)) {
+		rq = list_entry_rq(list.next);
+		list_del_init(&rq->queuelist);
+		BUG_ON(!rq->q);
+		if (rq->q != q) {
+			if (q) {
+				queue_unplugged(q, from_schedule);
+				spin_unlock(q->queue_lock);
+			}
+			q = rq->q;
+			spin_lock(q->queue_lock);
+		}
+
+		/* in_flight is only changed under the queue lock */
+		drive_stat_acct(rq, 1);
+		__elv_add_request(q, rq, ELEVATOR_INSERT_SORT, 0);
+	}
+
+	if (q) {
+		queue_unplugged(q, from_schedule);
+		spin_unlock(q->queue_lock);
+	}
+
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(blk_flush_plug_list);
+
+/**
+ * blk_finish_plug - flush and stop tracking a plug
+ * @plug:	The &struct blk_plug passed to blk_start_plug()
+ */
+void blk_finish_plug(struct blk_plug *plug)
+{
+	blk_flush_plug_list(plug, false);
+
+	if (plug == current->plug)
+		current->plug = NULL;
+}
+EXPORT_SYMBOL(blk_finish_plug);
+
 int __init blk_dev_init(void)
 {
 	BUILD_BUG_ON(__REQ_NR_BITS > 8 *
@@ -0,0 +1,160 @@
+/*
+ * Per-queue I/O latency histograms
+ *
+ * Every file system request that completes on a queue is sorted into two
+ * log2 histograms: the time it spent queued (allocation to dispatch) and
+ * the time the driver spent servicing it (dispatch to completion).  Each
+ * histogram is further split by data direction and by whether the
+ * submitter flagged the I/O as synchronous.
+ *
+ * Buckets are kept per cpu and only summed when read from sysfs, so the
+ * completion path costs one sched_clock() read and two local increments.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/blkdev.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+
+#include "blk.h"
+
+enum {
+	BLK_LAT_QUEUE,		/* allocation to dispatch */
+	BLK_LAT_SERVICE,	/* dispatch to completion */
+	BLK_LAT_NR_PHASES,
+};
+
+/*
+ * Bucket 0 counts latencies below 1us, bucket i (0 < i < last) counts
+ * latencies in [2^(i-1), 2^i) usecs and the last bucket everything else.
+ */
+#define BLK_LAT_NR_BUCKETS	20
+
+struct blk_latency_hist {
+	unsigned long	bucket[2][2][BLK_LAT_NR_PHASES][BLK_LAT_NR_BUCKETS];
+};
+
+static const char *blk_lat_phase_name[BLK_LAT_NR_PHASES] = {
+	[BLK_LAT_QUEUE]		= "queue",
+	[BLK_LAT_SERVICE]	= "service",
+};
+
+int blk_latency_hist_init(struct request_queue *q)
+{
+	q->latency_hist = alloc_percpu(struct blk_latency_hist);
+	if (!q->latency_hist)
+		return -ENOMEM;
+	return 0;
+}
+
+void blk_latency_hist_exit(struct request_queue *q)
+{
+	free_percpu(q->latency_hist);
+	q->latency_hist = NULL;
+}
+
+static inline int blk_lat_bucket(u64 delta_ns)
+{
+	u64 usecs = div_u64(delta_ns, NSEC_PER_USEC);
+
+	if (usecs >= 1ULL << (BLK_LAT_NR_BUCKETS - 2))
+		return BLK_LAT_NR_BUCKETS - 1;
+	return fls((u32)usecs);
+}
+
+/**
+ * blk_latency_account - account a completed request in the histograms
+ * @rq: request being finished
+ *
+ * Description:
+ *     Called from the request completion path with the queue lock held.
+ *     Only requests that went through blk_dequeue_request() and therefore
+ *     carry a dispatch timestamp are accounted.
+ */
+void blk_latency_account(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+	u64 start, dispatch, now;
+	int rw, sync;
+
+	if (!q->latency_hist || !blk_account_rq(rq) || rq == &q->bar_rq)
+		return;
+
+	start = rq_start_time_ns(rq);
+	dispatch = rq_io_start_time_ns(rq);
+	if (!dispatch || dispatch < start)
+		return;
+
+	preempt_disable();
+	now = sched_clock();
+	if (now < dispatch)
+		now = dispatch;
+
+	rw = rq_data_dir(rq);
+	sync = !!(rq->cmd_flags & REQ_SYNC);
+	__this_cpu_inc(q->latency_hist->bucket[rw][sync][BLK_LAT_QUEUE]
+					[blk_lat_bucket(dispatch - start)]);
+	__this_cpu_inc(q->latency_hist->bucket[rw][sync][BLK_LAT_SERVICE]
+					[blk_lat_bucket(now - dispatch)]);
+	preempt_enable();
+}
+
+ssize_t blk_latency_hist_show(struct request_queue *q, char *page)
+{
+	unsigned long sum[BLK_LAT_NR_BUCKETS];
+	int rw, sync, phase, i, cpu;
+	ssize_t len = 0;
+
+	if (!q->latency_hist)
+		return -ENODEV;
+
+	len += snprintf(page + len, PAGE_SIZE - len, "%-20s", "usecs<");
+	for (i = 1; i < BLK_LAT_NR_BUCKETS; i++)
+		len += snprintf(page + len, PAGE_SIZE - len, " %lu",
+				1UL << (i - 1));
+	len += snprintf(page + len, PAGE_SIZE - len, " inf\n");
+
+	for (rw = 0; rw < 2; rw++)
+	for (sync = 1; sync >= 0; sync--)
+	for (phase = 0; phase < BLK_LAT_NR_PHASES; phase++) {
+		memset(sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct blk_latency_hist *h =
+				per_cpu_ptr(q->latency_hist, cpu);
+
+			for (i = 0; i < BLK_LAT_NR_BUCKETS; i++)
+				sum[i] += h->bucket[rw][sync][phase][i];
+		}
+
+		len += snprintf(page + len, PAGE_SIZE - len, "%-5s %-5s %-8s",
+				rw ? "write" : "read", sync ? "sync" : "async",
+				blk_lat_phase_name[phase]);
+		for (i = 0; i < BLK_LAT_NR_BUCKETS; i++)
+			len += snprintf(page + len, PAGE_SIZE - len, " %lu",
+					sum[i]);
+		len += snprintf(page + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+ssize_t blk_latency_hist_store(struct request_queue *q, const char *page,
+			       size_t count)
+{
+	unsigned long val;
+	int cpu;
+
+	if (!q->latency_hist)
+		return -ENODEV;
+	if (strict_strtoul(page, 10, &val) || val != 0)
+		return -EINVAL;
+
+	spin_lock_irq(q->queue_lock);
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(q->latency_hist, cpu), 0,
+		       sizeof(struct blk_latency_hist));
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
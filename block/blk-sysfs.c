@@ -369,6 +369,14 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_DEV_LATENCY_HIST
+static struct queue_sysfs_entry queue_latency_hist_entry = {
+	.attr = {.name = "latency_hist", .mode = S_IRUGO | S_IWUSR },
+	.show = blk_latency_hist_show,
+	.store = blk_latency_hist_store,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -390,6 +398,9 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_DEV_LATENCY_HIST
+	&queue_latency_hist_entry.attr,
+#endif
 	NULL,
 };
 
@@ -466,6 +477,8 @@ static void blk_release_queue(struct kobject *kobj)
 	if (q->queue_tags)
 		__blk_queue_free_tags(q);
 
+	blk_latency_hist_exit(q);
+
 	blk_trace_shutdown(q);
 
 	bdi_destroy(&q->backing_dev_info);
@@ -95,6 +95,26 @@ static inline int blk_should_fake_timeout(struct request_queue *q)
 }
 #endif
 
+#ifdef CONFIG_BLK_DEV_LATENCY_HIST
+int blk_latency_hist_init(struct request_queue *q);
+void blk_latency_hist_exit(struct request_queue *q);
+void blk_latency_account(struct request *rq);
+ssize_t blk_latency_hist_show(struct request_queue *q, char *page);
+ssize_t blk_latency_hist_store(struct request_queue *q, const char *page,
+			       size_t count);
+#else
+static inline int blk_latency_hist_init(struct request_queue *q)
+{
+	return 0;
+}
+static inline void blk_latency_hist_exit(struct request_queue *q)
+{
+}
+static inline void blk_latency_account(struct request *rq)
+{
+}
+#endif
+
 struct io_context *current_io_context(gfp_t gfp_flags, int node);
 
 int ll_back_merge_fn(struct request_queue *q, struct request *req,
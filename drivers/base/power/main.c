@@ -27,6 +27,9 @@
 #include <linux/sched.h>
 #include <linux/async.h>
 #include <linux/suspend.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 
 #include "../base.h"
 #include "power.h"
@@ -224,6 +227,12 @@ static void dpm_wait_for_children(struct device *dev, bool async)
        device_for_each_child(dev, &async, dpm_wait_fn);
 }
 
+static bool is_async(struct device *dev)
+{
+	return dev->power.async_suspend && pm_async_enabled
+		&& !pm_trace_is_enabled();
+}
+
 /**
  * pm_op - Execute the PM operation appropriate for given PM event.
  * @dev: Device to handle.
@@ -427,23 +436,186 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, char *info)
 		usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
 }
 
+/*
+ * Per-device timing.  The time each device spends in its callbacks of a phase,
+ * not counting the waits for its parent or children, is recorded during every
+ * system transition, and the slowest ones of the last transition are kept,
+ * slowest first, so that the devices holding suspend and resume up can be
+ * found without initcall_debug.
+ */
+#define DPM_SLOWEST	32
+
+enum dpm_phase {
+	DPM_PHASE_PREPARE,
+	DPM_PHASE_SUSPEND,
+	DPM_PHASE_SUSPEND_NOIRQ,
+	DPM_PHASE_RESUME_NOIRQ,
+	DPM_PHASE_RESUME,
+	DPM_PHASE_COMPLETE,
+	DPM_NR_PHASES
+};
+
+static const char * const dpm_phase_names[DPM_NR_PHASES] = {
+	"prepare", "suspend", "late", "early", "resume", "complete",
+};
+
+struct dpm_time {
+	char name[32];
+	char driver[24];
+	u8 phase;
+	bool async;
+	u32 usecs;
+};
+
+static DEFINE_SPINLOCK(dpm_times_lock);
+static struct dpm_time dpm_slowest[DPM_SLOWEST];
+static int dpm_nr_slowest;
+static u32 dpm_phase_usecs[DPM_NR_PHASES];
+static unsigned int dpm_transitions;
+
+static void dpm_reset_times(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	dpm_nr_slowest = 0;
+	memset(dpm_phase_usecs, 0, sizeof(dpm_phase_usecs));
+	dpm_transitions++;
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+/**
+ * dpm_record_time - Record the time a device spent in the callbacks of a phase.
+ * @dev: Device handled.
+ * @phase: Phase of the system transition.
+ * @starttime: Time the callbacks were started at.
+ * @async: If true, the device was handled asynchronously.
+ */
+static void dpm_record_time(struct device *dev, enum dpm_phase phase,
+			    ktime_t starttime, bool async)
+{
+	u32 usecs = ktime_us_delta(ktime_get(), starttime);
+	struct dpm_time *t;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	if (dpm_nr_slowest == DPM_SLOWEST) {
+		if (usecs <= dpm_slowest[DPM_SLOWEST - 1].usecs)
+			goto out;
+		i = DPM_SLOWEST - 1;
+	} else {
+		i = dpm_nr_slowest++;
+	}
+	for (; i > 0 && dpm_slowest[i - 1].usecs < usecs; i--)
+		dpm_slowest[i] = dpm_slowest[i - 1];
+
+	t = &dpm_slowest[i];
+	strlcpy(t->name, dev_name(dev), sizeof(t->name));
+	strlcpy(t->driver, dev->driver ? dev->driver->name : "",
+		sizeof(t->driver));
+	t->phase = phase;
+	t->async = async;
+	t->usecs = usecs;
+ out:
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+static void dpm_record_phase(enum dpm_phase phase, ktime_t starttime)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	dpm_phase_usecs[phase] = ktime_us_delta(ktime_get(), starttime);
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int dpm_times_show(struct seq_file *m, void *unused)
+{
+	struct dpm_time *slowest;
+	u32 phase_usecs[DPM_NR_PHASES];
+	unsigned int transitions;
+	int i, nr;
+
+	slowest = kmalloc(sizeof(dpm_slowest), GFP_KERNEL);
+	if (!slowest)
+		return -ENOMEM;
+
+	spin_lock_irq(&dpm_times_lock);
+	nr = dpm_nr_slowest;
+	memcpy(slowest, dpm_slowest, nr * sizeof(*slowest));
+	memcpy(phase_usecs, dpm_phase_usecs, sizeof(phase_usecs));
+	transitions = dpm_transitions;
+	spin_unlock_irq(&dpm_times_lock);
+
+	seq_printf(m, "transition %u\n", transitions);
+	for (i = 0; i < DPM_NR_PHASES; i++)
+		seq_printf(m, "%-8s %6lu.%03lu msecs\n", dpm_phase_names[i],
+			   (unsigned long)phase_usecs[i] / USEC_PER_MSEC,
+			   (unsigned long)phase_usecs[i] % USEC_PER_MSEC);
+
+	seq_printf(m, "\n%-10s %-8s %-5s %-23s %s\n",
+		   "msecs", "phase", "async", "driver", "device");
+	for (i = 0; i < nr; i++)
+		seq_printf(m, "%6lu.%03lu %-8s %-5s %-23s %s\n",
+			   (unsigned long)slowest[i].usecs / USEC_PER_MSEC,
+			   (unsigned long)slowest[i].usecs % USEC_PER_MSEC,
+			   dpm_phase_names[slowest[i].phase],
+			   slowest[i].async ? "yes" : "no",
+			   slowest[i].driver[0] ? slowest[i].driver : "-",
+			   slowest[i].name);
+
+	kfree(slowest);
+	return 0;
+}
+
+static int dpm_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_times_show, NULL);
+}
+
+static const struct file_operations dpm_times_fops = {
+	.open		= dpm_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_debugfs_init(void)
+{
+	debugfs_create_file("suspend_devices", S_IRUGO, NULL, NULL,
+			    &dpm_times_fops);
+	return 0;
+}
+late_initcall(dpm_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
 /*------------------------- Resume routines -------------------------*/
 
 /**
  * device_resume_noirq - Execute an "early resume" callback for given device.
  * @dev: Device to handle.
  * @state: PM transition of the system being carried out.
+ * @async: If true, the device is being resumed asynchronously.
  *
  * The driver of @dev will not receive interrupts while this function is being
  * executed.
  */
-static int device_resume_noirq(struct device *dev, pm_message_t state)
+static int device_resume_noirq(struct device *dev, pm_message_t state,
+			       bool async)
 {
+	ktime_t starttime;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
+	/* The parent's early resume was started before ours if it has one */
+	dpm_wait(dev->parent, async);
+	starttime = ktime_get();
+	dev->power.status = DPM_OFF;
+
 	if (dev->bus && dev->bus->pm) {
 		pm_dev_dbg(dev, state, "EARLY ");
 		error = pm_noirq_op(dev, dev->bus->pm, state);
@@ -464,16 +636,32 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 	}
 
 End:
+	dpm_record_time(dev, DPM_PHASE_RESUME_NOIRQ, starttime, async);
+	complete_all(&dev->power.completion);
+
 	TRACE_RESUME(error);
 	return error;
 }
 
+static void async_resume_noirq(void *data, async_cookie_t cookie)
+{
+	struct device *dev = (struct device *)data;
+	int error;
+
+	error = device_resume_noirq(dev, pm_transition, true);
+	if (error)
+		pm_dev_err(dev, pm_transition, " async early", error);
+	put_device(dev);
+}
+
 /**
  * dpm_resume_noirq - Execute "early resume" callbacks for non-sysdev devices.
  * @state: PM transition of the system being carried out.
  *
  * Call the "noirq" resume handlers for all devices marked as DPM_OFF_IRQ and
- * enable device drivers to receive interrupts.
+ * enable device drivers to receive interrupts.  The devices allowed to be
+ * resumed asynchronously are started first, each of them waiting for its
+ * parent only.
  */
 void dpm_resume_noirq(pm_message_t state)
 {
@@ -482,17 +670,31 @@ void dpm_resume_noirq(pm_message_t state)
 
 	mutex_lock(&dpm_list_mtx);
 	transition_started = false;
+	pm_transition = state;
+
+	list_for_each_entry(dev, &dpm_list, power.entry) {
+		if (dev->power.status <= DPM_OFF)
+			continue;
+
+		INIT_COMPLETION(dev->power.completion);
+		if (is_async(dev)) {
+			get_device(dev);
+			async_schedule(async_resume_noirq, dev);
+		}
+	}
+
 	list_for_each_entry(dev, &dpm_list, power.entry)
-		if (dev->power.status > DPM_OFF) {
+		if (!is_async(dev) && dev->power.status > DPM_OFF) {
 			int error;
 
-			dev->power.status = DPM_OFF;
-			error = device_resume_noirq(dev, state);
+			error = device_resume_noirq(dev, state, false);
 			if (error)
 				pm_dev_err(dev, state, " early", error);
 		}
 	mutex_unlock(&dpm_list_mtx);
+	async_synchronize_full();
 	dpm_show_time(starttime, state, "early");
+	dpm_record_phase(DPM_PHASE_RESUME_NOIRQ, starttime);
 	resume_device_irqs();
 }
 EXPORT_SYMBOL_GPL(dpm_resume_noirq);
@@ -525,6 +727,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
  */
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t starttime;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -533,6 +736,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	if (dev->parent && (dev->parent->power.status >= DPM_OFF ||
 			    dev->parent->power.status == DPM_RESUMING))
 		dpm_wait(dev->parent, async);
+	starttime = ktime_get();
 	device_lock(dev);
 
 	dev->power.status = DPM_RESUMING;
@@ -569,6 +773,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
  End:
 	device_unlock(dev);
+	dpm_record_time(dev, DPM_PHASE_RESUME, starttime, async);
 	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
@@ -586,12 +791,6 @@ static void async_resume(void *data, async_cookie_t cookie)
 	put_device(dev);
 }
 
-static bool is_async(struct device *dev)
-{
-	return dev->power.async_suspend && pm_async_enabled
-		&& !pm_trace_is_enabled();
-}
-
 /**
  *	dpm_drv_timeout - Driver suspend / resume watchdog handler
  *	@data: struct device which timed out
@@ -670,6 +869,7 @@ static void dpm_resume(pm_message_t state)
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, NULL);
+	dpm_record_phase(DPM_PHASE_RESUME, starttime);
 }
 
 /**
@@ -679,6 +879,8 @@ static void dpm_resume(pm_message_t state)
  */
 static void device_complete(struct device *dev, pm_message_t state)
 {
+	ktime_t starttime = ktime_get();
+
 	device_lock(dev);
 
 	if (dev->class && dev->class->pm && dev->class->pm->complete) {
@@ -697,6 +899,7 @@ static void device_complete(struct device *dev, pm_message_t state)
 	}
 
 	device_unlock(dev);
+	dpm_record_time(dev, DPM_PHASE_COMPLETE, starttime, false);
 }
 
 /**
@@ -709,6 +912,7 @@ static void device_complete(struct device *dev, pm_message_t state)
 static void dpm_complete(pm_message_t state)
 {
 	struct list_head list;
+	ktime_t starttime = ktime_get();
 
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
@@ -732,6 +936,7 @@ static void dpm_complete(pm_message_t state)
 	}
 	list_splice(&list, &dpm_list);
 	mutex_unlock(&dpm_list_mtx);
+	dpm_record_phase(DPM_PHASE_COMPLETE, starttime);
 }
 
 /**
@@ -777,14 +982,23 @@ static pm_message_t resume_event(pm_message_t sleep_state)
  * device_suspend_noirq - Execute a "late suspend" callback for given device.
  * @dev: Device to handle.
  * @state: PM transition of the system being carried out.
+ * @async: If true, the device is being suspended asynchronously.
  *
  * The driver of @dev will not receive interrupts while this function is being
  * executed.
  */
-static int device_suspend_noirq(struct device *dev, pm_message_t state)
+static int device_suspend_noirq(struct device *dev, pm_message_t state,
+				bool async)
 {
+	ktime_t starttime;
 	int error = 0;
 
+	dpm_wait_for_children(dev, async);
+	starttime = ktime_get();
+
+	if (async_error)
+		goto End;
+
 	if (dev->class && dev->class->pm) {
 		pm_dev_dbg(dev, state, "LATE class ");
 		error = pm_noirq_op(dev, dev->class->pm, state);
@@ -804,16 +1018,38 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state)
 		error = pm_noirq_op(dev, dev->bus->pm, state);
 	}
 
+	if (!error)
+		dev->power.status = DPM_OFF_IRQ;
+
 End:
+	dpm_record_time(dev, DPM_PHASE_SUSPEND_NOIRQ, starttime, async);
+	complete_all(&dev->power.completion);
+
+	if (error)
+		async_error = error;
+
 	return error;
 }
 
+static void async_suspend_noirq(void *data, async_cookie_t cookie)
+{
+	struct device *dev = (struct device *)data;
+	int error;
+
+	error = device_suspend_noirq(dev, pm_transition, true);
+	if (error)
+		pm_dev_err(dev, pm_transition, " async late", error);
+
+	put_device(dev);
+}
+
 /**
  * dpm_suspend_noirq - Execute "late suspend" callbacks for non-sysdev devices.
  * @state: PM transition of the system being carried out.
  *
  * Prevent device drivers from receiving interrupts and call the "noirq" suspend
- * handlers for all non-sysdev devices.
+ * handlers for all non-sysdev devices.  The devices allowed to be suspended
+ * asynchronously only wait for their children.
  */
 int dpm_suspend_noirq(pm_message_t state)
 {
@@ -823,19 +1059,34 @@ int dpm_suspend_noirq(pm_message_t state)
 
 	suspend_device_irqs();
 	mutex_lock(&dpm_list_mtx);
+	pm_transition = state;
+	async_error = 0;
 	list_for_each_entry_reverse(dev, &dpm_list, power.entry) {
-		error = device_suspend_noirq(dev, state);
+		INIT_COMPLETION(dev->power.completion);
+		if (is_async(dev)) {
+			get_device(dev);
+			async_schedule(async_suspend_noirq, dev);
+			continue;
+		}
+
+		error = device_suspend_noirq(dev, state, false);
 		if (error) {
 			pm_dev_err(dev, state, " late", error);
 			break;
 		}
-		dev->power.status = DPM_OFF_IRQ;
+		if (async_error)
+			break;
 	}
 	mutex_unlock(&dpm_list_mtx);
-	if (error)
+	async_synchronize_full();
+	if (!error)
+		error = async_error;
+	if (error) {
 		dpm_resume_noirq(resume_event(state));
-	else
+	} else {
 		dpm_show_time(starttime, state, "late");
+		dpm_record_phase(DPM_PHASE_SUSPEND_NOIRQ, starttime);
+	}
 	return error;
 }
 EXPORT_SYMBOL_GPL(dpm_suspend_noirq);
@@ -871,10 +1122,12 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 {
 	int error = 0;
+	ktime_t starttime;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
 
 	dpm_wait_for_children(dev, async);
+	starttime = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -936,6 +1189,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	del_timer_sync(&timer);
 	destroy_timer_on_stack(&timer);
 
+	dpm_record_time(dev, DPM_PHASE_SUSPEND, starttime, async);
 	complete_all(&dev->power.completion);
 
 	if (error)
@@ -1008,8 +1262,10 @@ static int dpm_suspend(pm_message_t state)
 	async_synchronize_full();
 	if (!error)
 		error = async_error;
-	if (!error)
+	if (!error) {
 		dpm_show_time(starttime, state, NULL);
+		dpm_record_phase(DPM_PHASE_SUSPEND, starttime);
+	}
 	return error;
 }
 
@@ -1023,6 +1279,7 @@ static int dpm_suspend(pm_message_t state)
  */
 static int device_prepare(struct device *dev, pm_message_t state)
 {
+	ktime_t starttime = ktime_get();
 	int error = 0;
 
 	device_lock(dev);
@@ -1050,6 +1307,7 @@ static int device_prepare(struct device *dev, pm_message_t state)
 	}
  End:
 	device_unlock(dev);
+	dpm_record_time(dev, DPM_PHASE_PREPARE, starttime, false);
 
 	return error;
 }
@@ -1063,8 +1321,10 @@ static int device_prepare(struct device *dev, pm_message_t state)
 static int dpm_prepare(pm_message_t state)
 {
 	struct list_head list;
+	ktime_t starttime = ktime_get();
 	int error = 0;
 
+	dpm_reset_times();
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
 	transition_started = true;
@@ -1107,6 +1367,8 @@ static int dpm_prepare(pm_message_t state)
 	}
 	list_splice(&list, &dpm_list);
 	mutex_unlock(&dpm_list_mtx);
+	if (!error)
+		dpm_record_phase(DPM_PHASE_PREPARE, starttime);
 	return error;
 }
 
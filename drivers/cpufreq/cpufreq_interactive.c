@@ -31,6 +31,9 @@
 #include <linux/input.h>
 #include <asm/cputime.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_interactive.h>
+
 static atomic_t active_count = ATOMIC_INIT(0);
 
 struct cpufreq_interactive_cpuinfo {
@@ -48,6 +51,7 @@ struct cpufreq_interactive_cpuinfo {
 	unsigned int floor_freq;
 	u64 floor_validate_time;
 	u64 hispeed_validate_time;
+	struct task_struct *boost_task;
 	int governor_enabled;
 };
 
@@ -108,6 +112,24 @@ static struct cpufreq_interactive_inputopen inputopen;
 
 static int boost_val;
 
+/*
+ * Tasks handling user input keep the speed of the cpu they run on at
+ * hispeed_freq or above for this long after the input, in usecs.  0
+ * disables it.
+ */
+static unsigned long task_boost_time_val;
+
+#define MAX_BOOSTED_TASKS 8
+
+struct cpufreq_interactive_boosted_task {
+	struct task_struct *task;
+	u64 expires;
+};
+
+/* Holds a reference to each task, protected by boosted_tasks_lock */
+static struct cpufreq_interactive_boosted_task boosted_tasks[MAX_BOOSTED_TASKS];
+static spinlock_t boosted_tasks_lock;
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event);
 
@@ -121,6 +143,93 @@ struct cpufreq_governor cpufreq_gov_interactive = {
 	.owner = THIS_MODULE,
 };
 
+/*
+ * Sets the task boosting a cpu, NULL if none, tracing the change.  Called
+ * with boosted_tasks_lock held.
+ */
+static void set_boost_task(unsigned int cpu, struct task_struct *p)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+
+	if (pcpu->boost_task == p)
+		return;
+	if (pcpu->boost_task)
+		trace_cpufreq_interactive_boost_end(cpu, pcpu->boost_task,
+						    pcpu->target_freq);
+	if (p)
+		trace_cpufreq_interactive_boost_start(cpu, p, hispeed_freq);
+	pcpu->boost_task = p;
+}
+
+/*
+ * Drops the boosted task of the given slot, returning it for the caller
+ * to put once boosted_tasks_lock is released.
+ */
+static struct task_struct *drop_boosted_task(int i)
+{
+	struct task_struct *p = boosted_tasks[i].task;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(cpuinfo, cpu).boost_task == p)
+			set_boost_task(cpu, NULL);
+	}
+	boosted_tasks[i].task = NULL;
+	return p;
+}
+
+/*
+ * Returns whether a task handling input is runnable on the cpu, dropping
+ * the tasks which are done with their input.
+ */
+static int cpufreq_interactive_task_boosted(unsigned int cpu)
+{
+	struct task_struct *expired[MAX_BOOSTED_TASKS];
+	struct task_struct *p, *boost = NULL;
+	unsigned long flags;
+	int i, nr_expired = 0;
+	u64 now;
+
+	if (!task_boost_time_val)
+		return 0;
+
+	now = ktime_to_us(ktime_get());
+	spin_lock_irqsave(&boosted_tasks_lock, flags);
+	for (i = 0; i < MAX_BOOSTED_TASKS; i++) {
+		p = boosted_tasks[i].task;
+		if (!p)
+			continue;
+		if (boosted_tasks[i].expires <= now) {
+			expired[nr_expired++] = drop_boosted_task(i);
+			continue;
+		}
+		if (!boost && task_cpu(p) == cpu && p->state == TASK_RUNNING)
+			boost = p;
+	}
+	set_boost_task(cpu, boost);
+	spin_unlock_irqrestore(&boosted_tasks_lock, flags);
+
+	for (i = 0; i < nr_expired; i++)
+		put_task_struct(expired[i]);
+
+	return boost != NULL;
+}
+
+static void cpufreq_interactive_clear_boosted_tasks(void)
+{
+	struct task_struct *p;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < MAX_BOOSTED_TASKS; i++) {
+		spin_lock_irqsave(&boosted_tasks_lock, flags);
+		p = boosted_tasks[i].task ? drop_boosted_task(i) : NULL;
+		spin_unlock_irqrestore(&boosted_tasks_lock, flags);
+		if (p)
+			put_task_struct(p);
+	}
+}
+
 static void cpufreq_interactive_timer(unsigned long data)
 {
 	unsigned int delta_idle;
@@ -193,7 +302,8 @@ static void cpufreq_interactive_timer(unsigned long data)
 	if (load_since_change > cpu_load)
 		cpu_load = load_since_change;
 
-	if (cpu_load >= go_hispeed_load || boost_val) {
+	if (cpu_load >= go_hispeed_load || boost_val ||
+	    cpufreq_interactive_task_boosted(data)) {
 		if (pcpu->target_freq <= pcpu->policy->min) {
 			new_freq = hispeed_freq;
 		} else {
@@ -509,6 +619,89 @@ static void cpufreq_interactive_boost(void)
 		wake_up_process(up_task);
 }
 
+/*
+ * A task starts handling input: raise the speed of its cpu to hispeed_freq
+ * for as long as it is runnable there, until task_boost_time has passed.
+ */
+static int cpufreq_interactive_boost_notifier(struct notifier_block *nb,
+					      unsigned long stamp, void *data)
+{
+	struct task_struct *p = data;
+	struct task_struct *old = NULL;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned long flags, j = jiffies;
+	unsigned int cpu;
+	int i, slot = -1, anyboost = 0;
+	u64 now, elapsed, expires;
+
+	/* In jiffies, stamps are never reset and usecs of them would wrap */
+	if (time_after_eq(j, stamp + usecs_to_jiffies(task_boost_time_val)))
+		return NOTIFY_DONE;
+	elapsed = div_u64((u64)(j - stamp) * USEC_PER_SEC, HZ);
+	if (elapsed >= task_boost_time_val)
+		return NOTIFY_DONE;
+
+	now = ktime_to_us(ktime_get());
+	expires = now + task_boost_time_val - elapsed;
+
+	spin_lock_irqsave(&boosted_tasks_lock, flags);
+
+	/* Take its slot, else a free one, else the one expiring first */
+	for (i = 0; i < MAX_BOOSTED_TASKS; i++) {
+		if (boosted_tasks[i].task == p) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 || (boosted_tasks[slot].task &&
+				 (!boosted_tasks[i].task ||
+				  boosted_tasks[i].expires <
+				  boosted_tasks[slot].expires)))
+			slot = i;
+	}
+
+	if (boosted_tasks[slot].task != p) {
+		if (boosted_tasks[slot].task)
+			old = drop_boosted_task(slot);
+		get_task_struct(p);
+		boosted_tasks[slot].task = p;
+	}
+	if (expires > boosted_tasks[slot].expires)
+		boosted_tasks[slot].expires = expires;
+
+	cpu = task_cpu(p);
+	pcpu = &per_cpu(cpuinfo, cpu);
+	if (pcpu->governor_enabled && p->state == TASK_RUNNING) {
+		set_boost_task(cpu, p);
+
+		spin_lock(&up_cpumask_lock);
+		if (pcpu->target_freq < hispeed_freq) {
+			pcpu->target_freq = hispeed_freq;
+			cpumask_set_cpu(cpu, &up_cpumask);
+			pcpu->target_set_time_in_idle =
+				get_cpu_idle_time_us(cpu,
+						     &pcpu->target_set_time);
+			pcpu->hispeed_validate_time = pcpu->target_set_time;
+			anyboost = 1;
+		}
+		pcpu->floor_freq = hispeed_freq;
+		pcpu->floor_validate_time = now;
+		spin_unlock(&up_cpumask_lock);
+	}
+
+	spin_unlock_irqrestore(&boosted_tasks_lock, flags);
+
+	if (old)
+		put_task_struct(old);
+	if (anyboost)
+		wake_up_process(up_task);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_interactive_boost_nb = {
+	.notifier_call = cpufreq_interactive_boost_notifier,
+};
+
 /*
  * Pulsed boost on input event raises CPUs to hispeed_freq and lets
  * usual algorithm of min_sample_time  decide when to allow speed
@@ -773,6 +966,31 @@ static ssize_t store_boostpulse(struct kobject *kobj, struct attribute *attr,
 static struct global_attr boostpulse =
 	__ATTR(boostpulse, 0200, NULL, store_boostpulse);
 
+static ssize_t show_task_boost_time(struct kobject *kobj,
+				    struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", task_boost_time_val);
+}
+
+static ssize_t store_task_boost_time(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	task_boost_time_val = val;
+	sched_set_boost_lifetime(usecs_to_jiffies(val));
+	if (!val)
+		cpufreq_interactive_clear_boosted_tasks();
+	return count;
+}
+
+define_one_global_rw(task_boost_time);
+
 static struct attribute *interactive_attributes[] = {
 	&hispeed_freq_attr.attr,
 	&go_hispeed_load_attr.attr,
@@ -782,6 +1000,7 @@ static struct attribute *interactive_attributes[] = {
 	&input_boost.attr,
 	&boost.attr,
 	&boostpulse.attr,
+	&task_boost_time.attr,
 	NULL,
 };
 
@@ -866,6 +1085,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			return 0;
 
 		input_unregister_handler(&cpufreq_interactive_input_handler);
+		cpufreq_interactive_clear_boosted_tasks();
 		sysfs_remove_group(cpufreq_global_kobject,
 				&interactive_attr_group);
 
@@ -942,9 +1162,11 @@ static int __init cpufreq_interactive_init(void)
 
 	spin_lock_init(&up_cpumask_lock);
 	spin_lock_init(&down_cpumask_lock);
+	spin_lock_init(&boosted_tasks_lock);
 	mutex_init(&set_speed_lock);
 
 	idle_notifier_register(&cpufreq_interactive_idle_nb);
+	register_sched_boost_notifier(&cpufreq_interactive_boost_nb);
 	INIT_WORK(&inputopen.inputopen_work, cpufreq_interactive_input_open);
 	return cpufreq_register_governor(&cpufreq_gov_interactive);
 
@@ -962,6 +1184,9 @@ module_init(cpufreq_interactive_init);
 static void __exit cpufreq_interactive_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	unregister_sched_boost_notifier(&cpufreq_interactive_boost_nb);
+	sched_set_boost_lifetime(0);
+	cpufreq_interactive_clear_boosted_tasks();
 	kthread_stop(up_task);
 	put_task_struct(up_task);
 	destroy_workqueue(down_wq);
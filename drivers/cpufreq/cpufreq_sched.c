@@ -0,0 +1,359 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * A cpufreq governor driven by the scheduler: CFS reports the decayed
+ * utilization of each cpu when tasks are enqueued and dequeued and on every
+ * tick, and the governor picks the lowest frequency of the policy's table
+ * which serves that utilization with some headroom.  There is no sampling
+ * timer: a change of frequency is only requested when the utilization
+ * calls for one.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+struct cpufreq_sched_cpuinfo {
+	struct update_util_data update_util;
+	struct hrtimer kick_timer;
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int target_freq;
+	u64 target_set_time;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_sched_cpuinfo, cpuinfo);
+
+static atomic_t active_count = ATOMIC_INIT(0);
+
+/* The thread setting speeds, and the cpus whose target_freq changed */
+static struct task_struct *speedchange_task;
+static cpumask_t speedchange_cpumask;
+static spinlock_t speedchange_cpumask_lock;
+static struct mutex set_speed_lock;
+
+/*
+ * Frequency headroom over the utilization, in percent: the cpu runs at
+ * the frequency at which it would be busy 100/(100+headroom) of the time.
+ */
+#define DEFAULT_HEADROOM 25
+static unsigned long headroom_val;
+
+/*
+ * The minimum time to spend at a frequency before lowering it, in usecs.
+ */
+#define DEFAULT_DOWN_DELAY (20 * USEC_PER_MSEC)
+static unsigned long down_delay_val;
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.max_transition_latency = 9500000,
+	.owner = THIS_MODULE,
+};
+
+/*
+ * Runs on the cpu which requested a speed change, once the runqueue lock
+ * it held is released.
+ */
+static enum hrtimer_restart cpufreq_sched_kick(struct hrtimer *timer)
+{
+	wake_up_process(speedchange_task);
+	return HRTIMER_NORESTART;
+}
+
+static void cpufreq_sched_update_util(struct update_util_data *data,
+				      u64 time, unsigned long util,
+				      unsigned long max)
+{
+	struct cpufreq_sched_cpuinfo *pcpu =
+		container_of(data, struct cpufreq_sched_cpuinfo, update_util);
+	struct cpufreq_policy *policy = pcpu->policy;
+	struct hrtimer *kick;
+	unsigned int new_freq, index;
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	new_freq = div_u64((u64)policy->max * util * (100 + headroom_val),
+			   max * 100);
+
+	if (cpufreq_frequency_table_target(policy, pcpu->freq_table,
+					   new_freq, CPUFREQ_RELATION_L,
+					   &index))
+		return;
+	new_freq = pcpu->freq_table[index].frequency;
+
+	if (new_freq == pcpu->target_freq)
+		return;
+
+	/* Do not scale down until down_delay has passed at this speed */
+	if (new_freq < pcpu->target_freq &&
+	    time - pcpu->target_set_time < (u64)down_delay_val * NSEC_PER_USEC)
+		return;
+
+	pcpu->target_freq = new_freq;
+	pcpu->target_set_time = time;
+
+	spin_lock(&speedchange_cpumask_lock);
+	cpumask_set_cpu(policy->cpu, &speedchange_cpumask);
+	spin_unlock(&speedchange_cpumask_lock);
+
+	/*
+	 * The runqueue lock is held: the thread cannot be woken up from here,
+	 * leave it to a timer expiring as soon as the lock is dropped.
+	 */
+	kick = &__get_cpu_var(cpuinfo).kick_timer;
+	if (!hrtimer_is_queued(kick))
+		__hrtimer_start_range_ns(kick, ktime_set(0, 0), 0,
+					 HRTIMER_MODE_REL_PINNED, 0);
+}
+
+static int cpufreq_sched_speedchange_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	struct cpufreq_sched_cpuinfo *pcpu;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+
+		if (cpumask_empty(&speedchange_cpumask)) {
+			spin_unlock_irqrestore(&speedchange_cpumask_lock,
+					       flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = speedchange_cpumask;
+		cpumask_clear(&speedchange_cpumask);
+		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			unsigned int j;
+			unsigned int max_freq = 0;
+
+			pcpu = &per_cpu(cpuinfo, cpu);
+			smp_rmb();
+
+			if (!pcpu->governor_enabled)
+				continue;
+
+			mutex_lock(&set_speed_lock);
+
+			for_each_cpu(j, pcpu->policy->cpus) {
+				struct cpufreq_sched_cpuinfo *pjcpu =
+					&per_cpu(cpuinfo, j);
+
+				if (pjcpu->target_freq > max_freq)
+					max_freq = pjcpu->target_freq;
+			}
+
+			if (max_freq != pcpu->policy->cur)
+				__cpufreq_driver_target(pcpu->policy,
+							max_freq,
+							CPUFREQ_RELATION_H);
+			mutex_unlock(&set_speed_lock);
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t show_headroom(struct kobject *kobj,
+			     struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", headroom_val);
+}
+
+static ssize_t store_headroom(struct kobject *kobj,
+			      struct attribute *attr, const char *buf,
+			      size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	headroom_val = val;
+	return count;
+}
+
+define_one_global_rw(headroom);
+
+static ssize_t show_down_delay(struct kobject *kobj,
+			       struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", down_delay_val);
+}
+
+static ssize_t store_down_delay(struct kobject *kobj,
+				struct attribute *attr, const char *buf,
+				size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	down_delay_val = val;
+	return count;
+}
+
+define_one_global_rw(down_delay);
+
+static struct attribute *sched_attributes[] = {
+	&headroom.attr,
+	&down_delay.attr,
+	NULL,
+};
+
+static struct attribute_group sched_attr_group = {
+	.attrs = sched_attributes,
+	.name = "sched",
+};
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	int rc;
+	unsigned int j;
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct cpufreq_frequency_table *freq_table;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		freq_table = cpufreq_frequency_get_table(policy->cpu);
+		if (!freq_table)
+			return -EINVAL;
+
+		/*
+		 * Do not create the sysfs entries if we have already done
+		 * so.
+		 */
+		if (atomic_inc_return(&active_count) == 1) {
+			rc = sysfs_create_group(cpufreq_global_kobject,
+						&sched_attr_group);
+			if (rc) {
+				atomic_dec(&active_count);
+				return rc;
+			}
+		}
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->freq_table = freq_table;
+			pcpu->target_freq = policy->cur;
+			pcpu->target_set_time = 0;
+			pcpu->governor_enabled = 1;
+			smp_wmb();
+			cpufreq_set_update_util_data(j, &pcpu->update_util);
+		}
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			cpufreq_set_update_util_data(j, NULL);
+			pcpu->governor_enabled = 0;
+			smp_wmb();
+		}
+		/* wait for the scheduler to be done with the callbacks */
+		synchronize_sched();
+
+		if (atomic_dec_return(&active_count) > 0)
+			return 0;
+
+		sysfs_remove_group(cpufreq_global_kobject,
+				&sched_attr_group);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&set_speed_lock);
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+		mutex_unlock(&set_speed_lock);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_sched_init(void)
+{
+	unsigned int i;
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+
+	headroom_val = DEFAULT_HEADROOM;
+	down_delay_val = DEFAULT_DOWN_DELAY;
+
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		pcpu->update_util.func = cpufreq_sched_update_util;
+		hrtimer_init(&pcpu->kick_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL_PINNED);
+		pcpu->kick_timer.function = cpufreq_sched_kick;
+	}
+
+	spin_lock_init(&speedchange_cpumask_lock);
+	mutex_init(&set_speed_lock);
+
+	speedchange_task = kthread_create(cpufreq_sched_speedchange_task,
+					  NULL, "ksched_freq");
+	if (IS_ERR(speedchange_task))
+		return PTR_ERR(speedchange_task);
+
+	sched_setscheduler_nocheck(speedchange_task, SCHED_FIFO, &param);
+	get_task_struct(speedchange_task);
+
+	return cpufreq_register_governor(&cpufreq_gov_sched);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_sched_init);
+#else
+module_init(cpufreq_sched_init);
+#endif
+
+MODULE_DESCRIPTION("'cpufreq_sched' - A cpufreq governor driven by "
+	"scheduler load tracking");
+MODULE_LICENSE("GPL");
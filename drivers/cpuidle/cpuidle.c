@@ -96,7 +96,9 @@ static void cpuidle_idle_call(void)
 
 	/* enter the state and update stats */
 	dev->last_state = target_state;
+	sched_set_idle_exit_latency(target_state->exit_latency);
 	dev->last_residency = target_state->enter(dev, target_state);
+	sched_set_idle_exit_latency(0);
 	if (dev->last_state)
 		target_state = dev->last_state;
 
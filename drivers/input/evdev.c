@@ -377,6 +377,17 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 	return have_event;
 }
 
+/*
+ * Keys, buttons and touchscreens are driven by the user, unlike sensors
+ * which only report axes.
+ */
+static bool evdev_is_user_input(struct input_dev *dev)
+{
+	return test_bit(EV_KEY, dev->evbit) ||
+		(test_bit(EV_ABS, dev->evbit) &&
+		 test_bit(ABS_MT_POSITION_X, dev->absbit));
+}
+
 static ssize_t evdev_read(struct file *file, char __user *buffer,
 			  size_t count, loff_t *ppos)
 {
@@ -409,6 +420,9 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		retval += input_event_size();
 	}
 
+	if (retval && evdev_is_user_input(evdev->handle.dev))
+		sched_boost_task(current, jiffies);
+
 	return retval;
 }
 
@@ -32,6 +32,8 @@
 #include <linux/smp_lock.h>
 #include <linux/scatterlist.h>
 #include <linux/string_helpers.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -83,6 +85,8 @@ struct mmc_blk_data {
 
 	unsigned int	usage;
 	unsigned int	read_only;
+
+	struct dentry	*packed_stats_dentry;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -169,11 +173,17 @@ static const struct block_device_operations mmc_bdops = {
 	.owner			= THIS_MODULE,
 };
 
-struct mmc_blk_request {
-	struct mmc_request	mrq;
-	struct mmc_command	cmd;
-	struct mmc_command	stop;
-	struct mmc_data		data;
+/*
+ * Outcome of a read/write request, as classified by mmc_blk_err_check()
+ * once the transfer has finished.
+ */
+enum mmc_blk_status {
+	MMC_BLK_SUCCESS = 0,
+	MMC_BLK_PARTIAL,	/* no error, but more of the request remains */
+	MMC_BLK_RETRY_SINGLE,	/* multi block read failed, redo per sector */
+	MMC_BLK_DATA_ERR,	/* single sector read failed */
+	MMC_BLK_WRITE_RETRY,	/* write data error, may be retried */
+	MMC_BLK_CMD_ERR,	/* give up on the request */
 };
 
 static u32 mmc_sd_num_wr_blocks(struct mmc_card *card)
@@ -273,8 +283,6 @@ static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
 	unsigned int from, nr, arg;
 	int err = 0;
 
-	mmc_claim_host(card->host);
-
 	if (!mmc_can_erase(card)) {
 		err = -EOPNOTSUPP;
 		goto out;
@@ -303,8 +311,6 @@ out:
 	__blk_end_request(req, err, blk_rq_bytes(req));
 	spin_unlock_irq(&md->lock);
 
-	mmc_release_host(card->host);
-
 	return err ? 0 : 1;
 }
 
@@ -316,8 +322,6 @@ static int mmc_blk_issue_secdiscard_rq(struct mmc_queue *mq,
 	unsigned int from, nr, arg;
 	int err = 0;
 
-	mmc_claim_host(card->host);
-
 	if (!mmc_can_secure_erase_trim(card)) {
 		err = -EOPNOTSUPP;
 		goto out;
@@ -356,225 +360,538 @@ out:
 	__blk_end_request(req, err, blk_rq_bytes(req));
 	spin_unlock_irq(&md->lock);
 
-	mmc_release_host(card->host);
-
 	return err ? 0 : 1;
 }
 
-static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *req)
+static int mmc_blk_err_check(struct mmc_card *card,
+			     struct mmc_async_req *areq)
 {
-	struct mmc_blk_data *md = mq->data;
-	struct mmc_card *card = md->queue.card;
-	struct mmc_blk_request brq;
-	int ret = 1, disable_multi = 0;
-
- 	int write_retry = 2;
+	struct mmc_queue_req *mq_mrq = container_of(areq, struct mmc_queue_req,
+						    mmc_active);
+	struct mmc_blk_request *brq = &mq_mrq->brq;
+	struct request *req = mq_mrq->req;
+	struct mmc_command cmd;
+	u32 status = 0;
 
+	/*
+	 * Check for errors here, but don't give up on the request
+	 * until later as we need to wait for the card to leave
+	 * programming mode even when things go wrong.
+	 */
+	if (brq->sbc.error || brq->cmd.error || brq->data.error ||
+	    brq->stop.error) {
+		if (brq->data.blocks > 1 && rq_data_dir(req) == READ) {
+			/* Redo read one sector at a time */
+			printk(KERN_WARNING "%s: retrying using single "
+			       "block read\n", req->rq_disk->disk_name);
+			return MMC_BLK_RETRY_SINGLE;
+		}
+		status = get_card_status(card, req);
+	}
 
-	mmc_claim_host(card->host);
+	if (brq->sbc.error) {
+		printk(KERN_ERR "%s: error %d sending set block count "
+		       "command, response %#x, card status %#x\n",
+		       req->rq_disk->disk_name, brq->sbc.error,
+		       brq->sbc.resp[0], status);
+	}
 
-	do {
-		struct mmc_command cmd;
-		u32 readcmd, writecmd, status = 0;
-
-		memset(&brq, 0, sizeof(struct mmc_blk_request));
-		brq.mrq.cmd = &brq.cmd;
-		brq.mrq.data = &brq.data;
-
-		brq.cmd.arg = blk_rq_pos(req);
-		if (!mmc_card_blockaddr(card))
-			brq.cmd.arg <<= 9;
-		brq.cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
-		brq.data.blksz = 512;
-		brq.stop.opcode = MMC_STOP_TRANSMISSION;
-		brq.stop.arg = 0;
-		brq.stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-		brq.data.blocks = blk_rq_sectors(req);
+	if (brq->cmd.error) {
+		printk(KERN_ERR "%s: error %d sending read/write "
+		       "command, response %#x, card status %#x\n",
+		       req->rq_disk->disk_name, brq->cmd.error,
+		       brq->cmd.resp[0], status);
+	}
 
-		/*
-		 * The block layer doesn't support all sector count
-		 * restrictions, so we need to be prepared for too big
-		 * requests.
-		 */
-		if (brq.data.blocks > card->host->max_blk_count)
-			brq.data.blocks = card->host->max_blk_count;
+	if (brq->data.error) {
+		if (brq->data.error == -ETIMEDOUT && brq->mrq.stop)
+			/* 'Stop' response contains card status */
+			status = brq->mrq.stop->resp[0];
+		printk(KERN_ERR "%s: error %d transferring data,"
+		       " sector %u, nr %u, card status %#x\n",
+		       req->rq_disk->disk_name, brq->data.error,
+		       (unsigned)blk_rq_pos(req),
+		       (unsigned)blk_rq_sectors(req), status);
+	}
 
-		/*
-		 * After a read error, we redo the request one sector at a time
-		 * in order to accurately determine which sectors can be read
-		 * successfully.
-		 */
-		if (disable_multi && brq.data.blocks > 1)
-			brq.data.blocks = 1;
+	if (brq->stop.error) {
+		printk(KERN_ERR "%s: error %d sending stop command, "
+		       "response %#x, card status %#x\n",
+		       req->rq_disk->disk_name, brq->stop.error,
+		       brq->stop.resp[0], status);
+	}
 
-		if (brq.data.blocks > 1) {
-			/* SPI multiblock writes terminate using a special
-			 * token, not a STOP_TRANSMISSION request.
+	if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
+		do {
+			int err;
+
+			cmd.opcode = MMC_SEND_STATUS;
+			cmd.arg = card->rca << 16;
+			cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+			err = mmc_wait_for_cmd(card->host, &cmd, 5);
+			if (err) {
+				printk(KERN_ERR "%s: error %d requesting status\n",
+				       req->rq_disk->disk_name, err);
+				return MMC_BLK_CMD_ERR;
+			}
+			/*
+			 * Some cards mishandle the status bits,
+			 * so make sure to check both the busy
+			 * indication and the card state.
 			 */
-			if (!mmc_host_is_spi(card->host)
-					|| rq_data_dir(req) == READ)
-				brq.mrq.stop = &brq.stop;
-			readcmd = MMC_READ_MULTIPLE_BLOCK;
-			writecmd = MMC_WRITE_MULTIPLE_BLOCK;
-		} else {
-			brq.mrq.stop = NULL;
-			readcmd = MMC_READ_SINGLE_BLOCK;
-			writecmd = MMC_WRITE_BLOCK;
-		}
+		} while (!(cmd.resp[0] & R1_READY_FOR_DATA) ||
+			(R1_CURRENT_STATE(cmd.resp[0]) == 7));
 
-		if (rq_data_dir(req) == READ) {
-			brq.cmd.opcode = readcmd;
-			brq.data.flags |= MMC_DATA_READ;
-		} else {
-			brq.cmd.opcode = writecmd;
-			brq.data.flags |= MMC_DATA_WRITE;
-		}
+		if (brq->data.error)
+			return MMC_BLK_WRITE_RETRY;
+	}
 
-		mmc_set_data_timeout(&brq.data, card);
+	if (brq->sbc.error || brq->cmd.error || brq->stop.error ||
+	    brq->data.error) {
+		if (rq_data_dir(req) == READ)
+			return MMC_BLK_DATA_ERR;
+		return MMC_BLK_CMD_ERR;
+	}
 
-		brq.data.sg = mq->sg;
-		brq.data.sg_len = mmc_queue_map_sg(mq);
+	if (mq_mrq->packed.type != MMC_PACKED_NONE) {
+		if (brq->data.bytes_xfered !=
+		    brq->data.blocks * brq->data.blksz)
+			return MMC_BLK_PARTIAL;
+	} else if (blk_rq_bytes(req) != brq->data.bytes_xfered)
+		return MMC_BLK_PARTIAL;
 
+	return MMC_BLK_SUCCESS;
+}
+
+/*
+ * Requests that must reach the card on their own.
+ */
+#define MMC_BLK_NO_BATCH_FLAGS	(REQ_DISCARD | REQ_HARDBARRIER | REQ_FUA | \
+				 REQ_FLUSH)
+
+static inline int mmc_blk_can_batch(struct request *req)
+{
+	return req->cmd_type == REQ_TYPE_FS && rq_data_dir(req) == WRITE &&
+	       !(req->cmd_flags & MMC_BLK_NO_BATCH_FLAGS);
+}
+
+/*
+ * Pull write requests queued behind @req into the current slot so they
+ * go to the card as one command.  eMMC 4.5 cards take them as a packed
+ * write; otherwise only requests that continue where the previous one
+ * ended are taken and sent as one plain multiple block write.
+ */
+static void mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_packed *packed = &mq->mqrq_cur->packed;
+#ifdef CONFIG_MMC_BLOCK_PACKED_WRITE
+	struct request_queue *q = mq->queue;
+	struct mmc_card *card = mq->card;
+	struct mmc_host *host = card->host;
+	struct request *next;
+	unsigned int max_entries, max_blocks, max_segs;
+	unsigned int blocks, segs;
+	sector_t end;
+	enum mmc_packed_type type;
+#endif
+
+	packed->type = MMC_PACKED_NONE;
+	packed->nr_entries = 1;
+
+	if (!mmc_blk_can_batch(req))
+		return;
+
+#ifdef CONFIG_MMC_BLOCK_PACKED_WRITE
+	if (mq->mqrq_cur->bounce_buf || mmc_host_is_spi(host))
+		goto out;
+
+	max_blocks = min(host->max_blk_count, host->max_req_size >> 9);
+	max_segs = min(host->max_hw_segs, host->max_phys_segs);
+	max_entries = MMC_PACKED_MAX_ENTRIES;
+
+	if (packed->cmd_hdr && !(mq->flags & MMC_QUEUE_NO_PACKED)) {
+		type = MMC_PACKED_WRITE;
+		max_entries = min_t(unsigned int, MMC_PACKED_CMD_MAX,
+				    card->ext_csd.max_packed_writes);
+		/* the header takes a block and a segment of its own */
+		max_blocks--;
+		max_segs--;
+	} else
+		type = MMC_PACKED_MERGE;
+
+	blocks = blk_rq_sectors(req);
+	segs = req->nr_phys_segments;
+	end = blk_rq_pos(req) + blocks;
+	if (blocks > max_blocks || segs > max_segs)
+		goto out;
+
+	INIT_LIST_HEAD(&packed->list);
+	list_add_tail(&req->queuelist, &packed->list);
+
+	spin_lock_irq(q->queue_lock);
+	while (packed->nr_entries < max_entries) {
+		next = blk_peek_request(q);
+		if (!next || !mmc_blk_can_batch(next))
+			break;
+		if (type == MMC_PACKED_MERGE && blk_rq_pos(next) != end)
+			break;
+		if (blocks + blk_rq_sectors(next) > max_blocks ||
+		    segs + next->nr_phys_segments > max_segs)
+			break;
+
+		blk_start_request(next);
+		list_add_tail(&next->queuelist, &packed->list);
+		packed->nr_entries++;
+		blocks += blk_rq_sectors(next);
+		segs += next->nr_phys_segments;
+		end = blk_rq_pos(next) + blk_rq_sectors(next);
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	if (packed->nr_entries > 1) {
+		packed->type = type;
+		packed->blocks = blocks;
+	} else
+		list_del_init(&req->queuelist);
+out:
+#endif
+	mq->packed_stats.cmds[packed->type][packed->nr_entries]++;
+}
+
+/*
+ * Build the single write command carrying every request on the packed
+ * list of @mqrq.
+ */
+static void mmc_blk_packed_rq_prep(struct mmc_queue_req *mqrq,
+				   struct mmc_card *card,
+				   struct mmc_queue *mq)
+{
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_packed *packed = &mqrq->packed;
+	struct request *req = mqrq->req;
+	struct request *prq;
+	int i = 1;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+	brq->mrq.stop = &brq->stop;
+
+	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	brq->data.blksz = 512;
+	brq->data.blocks = packed->blocks;
+	brq->data.flags |= MMC_DATA_WRITE;
+
+	if (packed->type == MMC_PACKED_WRITE) {
 		/*
-		 * Adjust the sg list so it is the same size as the
-		 * request.
+		 * The first data block is the packed command header: one
+		 * CMD23/CMD25 argument pair per request.
 		 */
-		if (brq.data.blocks != blk_rq_sectors(req)) {
-			int i, data_size = brq.data.blocks << 9;
-			struct scatterlist *sg;
-
-			for_each_sg(brq.data.sg, sg, brq.data.sg_len, i) {
-				data_size -= sg->length;
-				if (data_size <= 0) {
-					sg->length += data_size;
-					i++;
-					break;
-				}
-			}
-			brq.data.sg_len = i;
+		memset(packed->cmd_hdr, 0, 512);
+		packed->cmd_hdr[0] = cpu_to_le32((packed->nr_entries << 16) |
+						 (MMC_PACKED_CMD_WR << 8) |
+						 MMC_PACKED_CMD_VER);
+		list_for_each_entry(prq, &packed->list, queuelist) {
+			u32 addr = blk_rq_pos(prq);
+
+			if (!mmc_card_blockaddr(card))
+				addr <<= 9;
+			packed->cmd_hdr[i * 2] =
+				cpu_to_le32(blk_rq_sectors(prq));
+			packed->cmd_hdr[i * 2 + 1] = cpu_to_le32(addr);
+			i++;
 		}
+		brq->data.blocks++;
 
-		mmc_queue_bounce_pre(mq);
+		brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+		brq->sbc.arg = MMC_CMD23_ARG_PACKED | brq->data.blocks;
+		brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		brq->mrq.sbc = &brq->sbc;
+	}
 
-		mmc_wait_for_req(card->host, &brq.mrq);
+	mmc_set_data_timeout(&brq->data, card);
 
-		mmc_queue_bounce_post(mq);
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
 
-		/*
-		 * Check for errors here, but don't jump to cmd_err
-		 * until later as we need to wait for the card to leave
-		 * programming mode even when things go wrong.
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_err_check;
+}
+
+/*
+ * Complete a batched write.  On success every request on the list is
+ * finished.  Otherwise the first request is kept in the slot to be
+ * retried on its own and the others go back to the block layer.
+ * Returns 0 when nothing is left to do.
+ */
+static int mmc_blk_end_packed_req(struct mmc_queue *mq,
+				  struct mmc_queue_req *mq_rq, int status)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = &mq_rq->packed;
+	struct request *prq, *tmp;
+	int ret = 0;
+
+	if (status != MMC_BLK_SUCCESS && packed->type == MMC_PACKED_WRITE &&
+	    !(mq->flags & MMC_QUEUE_NO_PACKED)) {
+		printk(KERN_WARNING "%s: packed write failed, "
+		       "disabling packed commands\n",
+		       mq_rq->req->rq_disk->disk_name);
+		mq->flags |= MMC_QUEUE_NO_PACKED;
+	}
+
+	spin_lock_irq(&md->lock);
+	if (status == MMC_BLK_SUCCESS) {
+		list_for_each_entry_safe(prq, tmp, &packed->list, queuelist) {
+			list_del_init(&prq->queuelist);
+			__blk_end_request(prq, 0, blk_rq_bytes(prq));
+		}
+	} else {
+		prq = list_first_entry(&packed->list, struct request,
+				       queuelist);
+		list_del_init(&prq->queuelist);
+		mq_rq->req = prq;
+
+		/* requeue from the tail so the queue order is kept */
+		list_for_each_entry_safe_reverse(prq, tmp, &packed->list,
+						 queuelist) {
+			list_del_init(&prq->queuelist);
+			blk_requeue_request(mq->queue, prq);
+		}
+		ret = 1;
+	}
+	spin_unlock_irq(&md->lock);
+
+	packed->type = MMC_PACKED_NONE;
+	packed->nr_entries = 1;
+
+	return ret;
+}
+
+/*
+ * Build the MMC request for (the remainder of) mqrq->req and map its
+ * data.  This runs while the previous request may still be transferring.
+ */
+static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
+			       struct mmc_card *card,
+			       int disable_multi,
+			       struct mmc_queue *mq)
+{
+	u32 readcmd, writecmd;
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
+
+	if (mqrq->packed.type != MMC_PACKED_NONE) {
+		mmc_blk_packed_rq_prep(mqrq, card, mq);
+		return;
+	}
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq->data.blksz = 512;
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	brq->data.blocks = blk_rq_sectors(req);
+
+	/*
+	 * The block layer doesn't support all sector count
+	 * restrictions, so we need to be prepared for too big
+	 * requests.
+	 */
+	if (brq->data.blocks > card->host->max_blk_count)
+		brq->data.blocks = card->host->max_blk_count;
+
+	/*
+	 * After a read error, we redo the request one sector at a time
+	 * in order to accurately determine which sectors can be read
+	 * successfully.
+	 */
+	if (disable_multi && brq->data.blocks > 1)
+		brq->data.blocks = 1;
+
+	if (brq->data.blocks > 1) {
+		/* SPI multiblock writes terminate using a special
+		 * token, not a STOP_TRANSMISSION request.
 		 */
-		if (brq.cmd.error || brq.data.error || brq.stop.error) {
-			if (brq.data.blocks > 1 && rq_data_dir(req) == READ) {
-				/* Redo read one sector at a time */
-				printk(KERN_WARNING "%s: retrying using single "
-				       "block read\n", req->rq_disk->disk_name);
-				disable_multi = 1;
-				continue;
+		if (!mmc_host_is_spi(card->host)
+				|| rq_data_dir(req) == READ)
+			brq->mrq.stop = &brq->stop;
+		readcmd = MMC_READ_MULTIPLE_BLOCK;
+		writecmd = MMC_WRITE_MULTIPLE_BLOCK;
+	} else {
+		brq->mrq.stop = NULL;
+		readcmd = MMC_READ_SINGLE_BLOCK;
+		writecmd = MMC_WRITE_BLOCK;
+	}
+
+	if (rq_data_dir(req) == READ) {
+		brq->cmd.opcode = readcmd;
+		brq->data.flags |= MMC_DATA_READ;
+	} else {
+		brq->cmd.opcode = writecmd;
+		brq->data.flags |= MMC_DATA_WRITE;
+	}
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	/*
+	 * Adjust the sg list so it is the same size as the
+	 * request.
+	 */
+	if (brq->data.blocks != blk_rq_sectors(req)) {
+		int i, data_size = brq->data.blocks << 9;
+		struct scatterlist *sg;
+
+		for_each_sg(brq->data.sg, sg, brq->data.sg_len, i) {
+			data_size -= sg->length;
+			if (data_size <= 0) {
+				sg->length += data_size;
+				i++;
+				break;
 			}
-			status = get_card_status(card, req);
-		} else if (disable_multi == 1) {
-			disable_multi = 0;
 		}
+		brq->data.sg_len = i;
+	}
 
-		if (brq.cmd.error) {
-			printk(KERN_ERR "%s: error %d sending read/write "
-			       "command, response %#x, card status %#x\n",
-			       req->rq_disk->disk_name, brq.cmd.error,
-			       brq.cmd.resp[0], status);
-		}
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_err_check;
 
-		if (brq.data.error) {
-			if (brq.data.error == -ETIMEDOUT && brq.mrq.stop)
-				/* 'Stop' response contains card status */
-				status = brq.mrq.stop->resp[0];
-			printk(KERN_ERR "%s: error %d transferring data,"
-			       " sector %u, nr %u, card status %#x\n",
-			       req->rq_disk->disk_name, brq.data.error,
-			       (unsigned)blk_rq_pos(req),
-			       (unsigned)blk_rq_sectors(req), status);
-		}
+	mmc_queue_bounce_pre(mqrq);
+}
 
-		if (brq.stop.error) {
-			printk(KERN_ERR "%s: error %d sending stop command, "
-			       "response %#x, card status %#x\n",
-			       req->rq_disk->disk_name, brq.stop.error,
-			       brq.stop.resp[0], status);
-		}
+/*
+ * Issue @rqc and complete the request that was started before it.
+ *
+ * The new request is prepared (sg mapping, bounce copy and the host's
+ * pre_req hook) before waiting for the previous one, so that work
+ * overlaps with the previous transfer.  @rqc may be NULL, in which case
+ * only the outstanding request is waited for.
+ */
+static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_blk_request *brq = &mq->mqrq_cur->brq;
+	int ret = 1, disable_multi = 0;
+	int write_retry = 2;
+	int status;
+	struct mmc_queue_req *mq_rq;
+	struct request *req;
+	struct mmc_async_req *areq;
 
-		if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
-			do {
-				int err;
-
-				cmd.opcode = MMC_SEND_STATUS;
-				cmd.arg = card->rca << 16;
-				cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
-				err = mmc_wait_for_cmd(card->host, &cmd, 5);
-				if (err) {
-					printk(KERN_ERR "%s: error %d requesting status\n",
-					       req->rq_disk->disk_name, err);
-					goto cmd_err;
-				}
-				/*
-				 * Some cards mishandle the status bits,
-				 * so make sure to check both the busy
-				 * indication and the card state.
-				 */
-			} while (!(cmd.resp[0] & R1_READY_FOR_DATA) ||
-				(R1_CURRENT_STATE(cmd.resp[0]) == 7));
-
-			if( brq.data.error){
-				if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ && write_retry>0) {
-					printk(KERN_ERR "%s: write error and retry (%d)\n",
-					       req->rq_disk->disk_name, 3 - write_retry);
-
-					write_retry--;
-					continue;
-				}
-			}
+	if (!rqc && !mq->mqrq_prev->req)
+		return 0;
 
-#if 0
-			if (cmd.resp[0] & ~0x00000900)
-				printk(KERN_ERR "%s: status = %08x\n",
-				       req->rq_disk->disk_name, cmd.resp[0]);
-			if (mmc_decode_status(cmd.resp))
-				goto cmd_err;
-#endif
+	if (rqc)
+		mmc_blk_prep_packed_list(mq, rqc);
+
+	do {
+		if (rqc) {
+			mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+			areq = &mq->mqrq_cur->mmc_active;
+		} else
+			areq = NULL;
+		areq = mmc_start_req(card->host, areq, &status);
+		if (!areq)
+			return 0;
+
+		mq_rq = container_of(areq, struct mmc_queue_req, mmc_active);
+		brq = &mq_rq->brq;
+		req = mq_rq->req;
+		mmc_queue_bounce_post(mq_rq);
+
+		if (mq_rq->packed.type != MMC_PACKED_NONE) {
+			ret = mmc_blk_end_packed_req(mq, mq_rq, status);
+			if (ret) {
+				/* retry the first request alone */
+				disable_multi = 0;
+				mmc_blk_rw_rq_prep(mq_rq, card, 0, mq);
+				mmc_start_req(card->host, &mq_rq->mmc_active,
+					      NULL);
+			}
+			continue;
 		}
 
-		if (brq.cmd.error || brq.stop.error || brq.data.error) {
-			if (rq_data_dir(req) == READ) {
-				/*
-				 * After an error, we redo I/O one sector at a
-				 * time, so we only reach here after trying to
-				 * read a single sector.
-				 */
-				spin_lock_irq(&md->lock);
-				ret = __blk_end_request(req, -EIO, brq.data.blksz);
-				spin_unlock_irq(&md->lock);
-				continue;
+		switch (status) {
+		case MMC_BLK_SUCCESS:
+		case MMC_BLK_PARTIAL:
+			/*
+			 * A block was successfully transferred.
+			 */
+			disable_multi = 0;
+			spin_lock_irq(&md->lock);
+			ret = __blk_end_request(req, 0, brq->data.bytes_xfered);
+			spin_unlock_irq(&md->lock);
+			break;
+		case MMC_BLK_RETRY_SINGLE:
+			disable_multi = 1;
+			break;
+		case MMC_BLK_DATA_ERR:
+			/*
+			 * After an error, we redo I/O one sector at a
+			 * time, so we only reach here after trying to
+			 * read a single sector.
+			 */
+			spin_lock_irq(&md->lock);
+			ret = __blk_end_request(req, -EIO, brq->data.blksz);
+			spin_unlock_irq(&md->lock);
+			break;
+		case MMC_BLK_WRITE_RETRY:
+			if (write_retry > 0) {
+				printk(KERN_ERR "%s: write error and retry (%d)\n",
+				       req->rq_disk->disk_name, 3 - write_retry);
+				write_retry--;
+				break;
 			}
+			/* fall through */
+		case MMC_BLK_CMD_ERR:
+		default:
 			goto cmd_err;
 		}
 
 		/*
-		 * A block was successfully transferred.
+		 * On anything but full success the new request was not
+		 * started; start it now if the failed one is done with.
 		 */
-		spin_lock_irq(&md->lock);
-		ret = __blk_end_request(req, 0, brq.data.bytes_xfered);
-		spin_unlock_irq(&md->lock);
-	} while (ret);
+		if (!ret && status != MMC_BLK_SUCCESS)
+			goto start_new_req;
 
-	mmc_release_host(card->host);
+		if (ret) {
+			/*
+			 * In case of an incomplete request
+			 * prepare it again and resend.
+			 */
+			mmc_blk_rw_rq_prep(mq_rq, card, disable_multi, mq);
+			mmc_start_req(card->host, &mq_rq->mmc_active, NULL);
+		}
+	} while (ret);
 
 	return 1;
 
  cmd_err:
- 	/*
- 	 * If this is an SD card and we're writing, we can first
- 	 * mark the known good sectors as ok.
- 	 *
+	/*
+	 * If this is an SD card and we're writing, we can first
+	 * mark the known good sectors as ok.
+	 *
 	 * If the card is not SD, we can still ok written sectors
 	 * as reported by the controller (which might be less than
 	 * the real number of written sectors, but never more).
@@ -590,17 +907,21 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *req)
 		}
 	} else {
 		spin_lock_irq(&md->lock);
-		ret = __blk_end_request(req, 0, brq.data.bytes_xfered);
+		ret = __blk_end_request(req, 0, brq->data.bytes_xfered);
 		spin_unlock_irq(&md->lock);
 	}
 
-	mmc_release_host(card->host);
-
 	spin_lock_irq(&md->lock);
 	while (ret)
 		ret = __blk_end_request(req, -EIO, blk_rq_cur_bytes(req));
 	spin_unlock_irq(&md->lock);
 
+ start_new_req:
+	if (rqc) {
+		mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+		mmc_start_req(card->host, &mq->mqrq_cur->mmc_active, NULL);
+	}
+
 	return 0;
 }
 
@@ -609,24 +930,38 @@ mmc_blk_set_blksize(struct mmc_blk_data *md, struct mmc_card *card);
 
 static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 {
-#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
 	struct mmc_blk_data *md = mq->data;
 	struct mmc_card *card = md->queue.card;
+	int ret;
 
-	if (mmc_bus_needs_resume(card->host)) {
-		mmc_resume_bus(card->host);
-		mmc_blk_set_blksize(md, card);
-	}
+	if (req && !mq->mqrq_prev->req) {
+#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
+		if (mmc_bus_needs_resume(card->host)) {
+			mmc_resume_bus(card->host);
+			mmc_blk_set_blksize(md, card);
+		}
 #endif
+		/* claim host only for the first request */
+		mmc_claim_host(card->host);
+	}
 
-	if (req->cmd_flags & REQ_DISCARD) {
+	if (req && req->cmd_flags & REQ_DISCARD) {
+		/* complete ongoing async transfer before issuing discard */
+		if (card->host->areq)
+			mmc_blk_issue_rw_rq(mq, NULL);
 		if (req->cmd_flags & REQ_SECURE)
-			return mmc_blk_issue_secdiscard_rq(mq, req);
+			ret = mmc_blk_issue_secdiscard_rq(mq, req);
 		else
-			return mmc_blk_issue_discard_rq(mq, req);
+			ret = mmc_blk_issue_discard_rq(mq, req);
 	} else {
-		return mmc_blk_issue_rw_rq(mq, req);
+		ret = mmc_blk_issue_rw_rq(mq, req);
 	}
+
+	if (!req)
+		/* release host only when there are no more requests */
+		mmc_release_host(card->host);
+
+	return ret;
 }
 
 static inline int mmc_blk_readonly(struct mmc_card *card)
@@ -755,6 +1090,77 @@ static const struct mmc_fixup blk_fixups[] =
 	END_FIXUP
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int mmc_blk_packed_stats_show(struct seq_file *s, void *data)
+{
+	struct mmc_blk_data *md = s->private;
+	unsigned long (*cmds)[MMC_PACKED_MAX_ENTRIES + 1] =
+		md->queue.packed_stats.cmds;
+	int i;
+
+	seq_printf(s, "%-8s %10s %10s %10s\n",
+		   "requests", "single", "merged", "packed");
+	for (i = 1; i <= MMC_PACKED_MAX_ENTRIES; i++) {
+		if (!cmds[MMC_PACKED_NONE][i] && !cmds[MMC_PACKED_MERGE][i] &&
+		    !cmds[MMC_PACKED_WRITE][i])
+			continue;
+		seq_printf(s, "%-8d %10lu %10lu %10lu\n", i,
+			   cmds[MMC_PACKED_NONE][i], cmds[MMC_PACKED_MERGE][i],
+			   cmds[MMC_PACKED_WRITE][i]);
+	}
+
+	return 0;
+}
+
+static int mmc_blk_packed_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_blk_packed_stats_show, inode->i_private);
+}
+
+static ssize_t mmc_blk_packed_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct mmc_blk_data *md =
+		((struct seq_file *)file->private_data)->private;
+
+	memset(&md->queue.packed_stats, 0, sizeof(md->queue.packed_stats));
+	return count;
+}
+
+static const struct file_operations mmc_blk_packed_stats_fops = {
+	.open		= mmc_blk_packed_stats_open,
+	.read		= seq_read,
+	.write		= mmc_blk_packed_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * The card's own debugfs directory only appears after probe, so the
+ * statistics live in the host's directory.
+ */
+static void mmc_blk_add_debugfs(struct mmc_blk_data *md)
+{
+	struct mmc_host *host = md->queue.card->host;
+
+	if (!host->debugfs_root)
+		return;
+
+	md->packed_stats_dentry = debugfs_create_file("packed_stats",
+				S_IRUSR | S_IWUSR, host->debugfs_root, md,
+				&mmc_blk_packed_stats_fops);
+}
+
+static void mmc_blk_remove_debugfs(struct mmc_blk_data *md)
+{
+	debugfs_remove(md->packed_stats_dentry);
+	md->packed_stats_dentry = NULL;
+}
+#else
+static inline void mmc_blk_add_debugfs(struct mmc_blk_data *md) { }
+static inline void mmc_blk_remove_debugfs(struct mmc_blk_data *md) { }
+#endif
+
 static int mmc_blk_probe(struct mmc_card *card)
 {
 	struct mmc_blk_data *md;
@@ -788,6 +1194,7 @@ static int mmc_blk_probe(struct mmc_card *card)
 	mmc_set_bus_resume_policy(card->host, 1);
 #endif
 	add_disk(md->disk);
+	mmc_blk_add_debugfs(md);
 	return 0;
 
  out:
@@ -802,6 +1209,8 @@ static void mmc_blk_remove(struct mmc_card *card)
 	struct mmc_blk_data *md = mmc_get_drvdata(card);
 
 	if (md) {
+		mmc_blk_remove_debugfs(md);
+
 		/* Stop new requests from getting into the queue */
 		del_gendisk(md->disk);
 
@@ -1542,6 +1542,103 @@ static int mmc_test_profile_seq_read_perf(struct mmc_test_card *test)
 	return 0;
 }
 
+/*
+ * One slot of the double-buffered non-blocking transfer test.
+ */
+struct mmc_test_async_req {
+	struct mmc_async_req	areq;
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+	struct scatterlist	*sg;
+	struct mmc_test_card	*test;
+};
+
+static int mmc_test_async_check(struct mmc_card *card,
+				struct mmc_async_req *areq)
+{
+	struct mmc_test_async_req *rq =
+		container_of(areq, struct mmc_test_async_req, areq);
+
+	return mmc_test_check_result(rq->test, &rq->mrq);
+}
+
+/*
+ * Consecutive read performance by transfer size, keeping one request
+ * queued behind the one in flight with mmc_start_req().
+ */
+static int mmc_test_profile_seq_read_perf_nonblock(struct mmc_test_card *test)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_test_async_req *rq;
+	struct mmc_async_req *done;
+	unsigned long sz;
+	unsigned int dev_addr, i, cnt, sg_len;
+	struct timespec ts1, ts2;
+	int ret = 0, err;
+
+	rq = kzalloc(sizeof(*rq) * 2, GFP_KERNEL);
+	if (!rq)
+		return -ENOMEM;
+	for (i = 0; i < 2; i++) {
+		rq[i].sg = kmalloc(sizeof(struct scatterlist) * t->max_segs,
+				   GFP_KERNEL);
+		if (!rq[i].sg) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
+		rq[i].test = test;
+		rq[i].areq.mrq = &rq[i].mrq;
+		rq[i].areq.err_check = mmc_test_async_check;
+	}
+
+	for (sz = 512; sz <= t->max_sz; sz <<= 1) {
+		cnt = t->max_sz / sz;
+		dev_addr = t->dev_addr;
+		for (i = 0; i < 2; i++) {
+			ret = mmc_test_map_sg(t->mem, sz, rq[i].sg, 1,
+					      t->max_segs, &sg_len);
+			if (ret)
+				goto out_free;
+		}
+		getnstimeofday(&ts1);
+		for (i = 0; i < cnt; i++) {
+			struct mmc_test_async_req *cur = &rq[i & 1];
+
+			memset(&cur->cmd, 0, sizeof(struct mmc_command));
+			memset(&cur->stop, 0, sizeof(struct mmc_command));
+			memset(&cur->data, 0, sizeof(struct mmc_data));
+			memset(&cur->mrq, 0, sizeof(struct mmc_request));
+			cur->mrq.cmd = &cur->cmd;
+			cur->mrq.data = &cur->data;
+			cur->mrq.stop = &cur->stop;
+			mmc_test_prepare_mrq(test, &cur->mrq, cur->sg, sg_len,
+					     dev_addr, sz >> 9, 512, 0);
+
+			mmc_start_req(test->card->host, &cur->areq, &err);
+			if (err) {
+				ret = err;
+				goto out_free;
+			}
+			dev_addr += (sz >> 9);
+		}
+		done = mmc_start_req(test->card->host, NULL, &err);
+		if (done && err) {
+			ret = err;
+			goto out_free;
+		}
+		getnstimeofday(&ts2);
+		mmc_test_print_avg_rate(test, sz, cnt, &ts1, &ts2);
+	}
+
+out_free:
+	for (i = 0; i < 2; i++)
+		kfree(rq[i].sg);
+	kfree(rq);
+	return ret;
+}
+
 /*
  * Consecutive write performance by transfer size.
  */
@@ -1849,6 +1946,13 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.cleanup = mmc_test_area_cleanup,
 	},
 
+	{
+		.name = "Consecutive read performance with non-blocking requests",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_profile_seq_read_perf_nonblock,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -22,8 +22,6 @@
 
 #define MMC_QUEUE_BOUNCESZ	65536
 
-#define MMC_QUEUE_SUSPENDED	(1 << 0)
-
 /*
  * Prepare a MMC request. This just filters out odd stuff.
  */
@@ -52,15 +50,23 @@ static int mmc_queue_thread(void *d)
 	down(&mq->thread_sem);
 	do {
 		struct request *req = NULL;
+		struct mmc_queue_req *tmp;
 
 		spin_lock_irq(q->queue_lock);
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (!blk_queue_plugged(q))
 			req = blk_fetch_request(q);
-		mq->req = req;
+		mq->mqrq_cur->req = req;
 		spin_unlock_irq(q->queue_lock);
 
-		if (!req) {
+		if (req || mq->mqrq_prev->req) {
+			/*
+			 * Issue the new request, or with req == NULL just
+			 * wait for the one still in flight to complete.
+			 */
+			set_current_state(TASK_RUNNING);
+			mq->issue_fn(mq, req);
+		} else {
 			if (kthread_should_stop()) {
 				set_current_state(TASK_RUNNING);
 				break;
@@ -68,11 +74,14 @@ static int mmc_queue_thread(void *d)
 			up(&mq->thread_sem);
 			schedule();
 			down(&mq->thread_sem);
-			continue;
 		}
-		set_current_state(TASK_RUNNING);
 
-		mq->issue_fn(mq, req);
+		/* Current request becomes previous request and vice versa. */
+		mq->mqrq_prev->brq.mrq.data = NULL;
+		mq->mqrq_prev->req = NULL;
+		tmp = mq->mqrq_prev;
+		mq->mqrq_prev = mq->mqrq_cur;
+		mq->mqrq_cur = tmp;
 	} while (1);
 	up(&mq->thread_sem);
 
@@ -98,10 +107,34 @@ static void mmc_request(struct request_queue *q)
 		return;
 	}
 
-	if (!mq->req)
+	if (!mq->mqrq_cur->req && !mq->mqrq_prev->req)
 		wake_up_process(mq->thread);
 }
 
+/*
+ * Free the scatterlists and bounce buffers of both request slots.
+ */
+static void mmc_queue_free_reqs(struct mmc_queue *mq)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mq->mqrq); i++) {
+		struct mmc_queue_req *mqrq = &mq->mqrq[i];
+
+		kfree(mqrq->bounce_sg);
+		mqrq->bounce_sg = NULL;
+
+		kfree(mqrq->sg);
+		mqrq->sg = NULL;
+
+		kfree(mqrq->bounce_buf);
+		mqrq->bounce_buf = NULL;
+
+		kfree(mqrq->packed.cmd_hdr);
+		mqrq->packed.cmd_hdr = NULL;
+	}
+}
+
 /**
  * mmc_init_queue - initialise a queue structure.
  * @mq: mmc queue
@@ -114,7 +147,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 {
 	struct mmc_host *host = card->host;
 	u64 limit = BLK_BOUNCE_HIGH;
-	int ret;
+	int ret, i;
 
 	if (mmc_dev(host)->dma_mask && *mmc_dev(host)->dma_mask)
 		limit = *mmc_dev(host)->dma_mask;
@@ -124,8 +157,13 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 	if (!mq->queue)
 		return -ENOMEM;
 
+	memset(&mq->mqrq, 0, sizeof(mq->mqrq));
+	mq->mqrq_cur = &mq->mqrq[0];
+	mq->mqrq_prev = &mq->mqrq[1];
 	mq->queue->queuedata = mq;
-	mq->req = NULL;
+
+	for (i = 0; i < ARRAY_SIZE(mq->mqrq); i++)
+		INIT_LIST_HEAD(&mq->mqrq[i].packed.list);
 
 	blk_queue_prep_rq(mq->queue, mmc_prep_request);
 	blk_queue_ordered(mq->queue, QUEUE_ORDERED_DRAIN);
@@ -160,53 +198,79 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 			bouncesz = host->max_blk_count * 512;
 
 		if (bouncesz > 512) {
-			mq->bounce_buf = kmalloc(bouncesz, GFP_KERNEL);
-			if (!mq->bounce_buf) {
+			for (i = 0; i < ARRAY_SIZE(mq->mqrq); i++) {
+				mq->mqrq[i].bounce_buf = kmalloc(bouncesz,
+								 GFP_KERNEL);
+				if (!mq->mqrq[i].bounce_buf)
+					break;
+			}
+			if (i < ARRAY_SIZE(mq->mqrq)) {
 				printk(KERN_WARNING "%s: unable to "
 					"allocate bounce buffer\n",
 					mmc_card_name(card));
+				mmc_queue_free_reqs(mq);
 			}
 		}
 
-		if (mq->bounce_buf) {
+		if (mq->mqrq_cur->bounce_buf) {
 			blk_queue_bounce_limit(mq->queue, BLK_BOUNCE_ANY);
 			blk_queue_max_hw_sectors(mq->queue, bouncesz / 512);
 			blk_queue_max_segments(mq->queue, bouncesz / 512);
 			blk_queue_max_segment_size(mq->queue, bouncesz);
 
-			mq->sg = kmalloc(sizeof(struct scatterlist),
-				GFP_KERNEL);
-			if (!mq->sg) {
-				ret = -ENOMEM;
-				goto cleanup_queue;
+			for (i = 0; i < ARRAY_SIZE(mq->mqrq); i++) {
+				struct mmc_queue_req *mqrq = &mq->mqrq[i];
+
+				mqrq->sg = kmalloc(sizeof(struct scatterlist),
+					GFP_KERNEL);
+				if (!mqrq->sg) {
+					ret = -ENOMEM;
+					goto cleanup_queue;
+				}
+				sg_init_table(mqrq->sg, 1);
+
+				mqrq->bounce_sg = kmalloc(
+					sizeof(struct scatterlist) *
+					bouncesz / 512, GFP_KERNEL);
+				if (!mqrq->bounce_sg) {
+					ret = -ENOMEM;
+					goto cleanup_queue;
+				}
+				sg_init_table(mqrq->bounce_sg, bouncesz / 512);
 			}
-			sg_init_table(mq->sg, 1);
-
-			mq->bounce_sg = kmalloc(sizeof(struct scatterlist) *
-				bouncesz / 512, GFP_KERNEL);
-			if (!mq->bounce_sg) {
-				ret = -ENOMEM;
-				goto cleanup_queue;
-			}
-			sg_init_table(mq->bounce_sg, bouncesz / 512);
 		}
 	}
 #endif
 
-	if (!mq->bounce_buf) {
+	if (!mq->mqrq_cur->bounce_buf) {
 		blk_queue_bounce_limit(mq->queue, limit);
 		blk_queue_max_hw_sectors(mq->queue,
 			min(host->max_blk_count, host->max_req_size / 512));
 		blk_queue_max_segments(mq->queue, host->max_hw_segs);
 		blk_queue_max_segment_size(mq->queue, host->max_seg_size);
 
-		mq->sg = kmalloc(sizeof(struct scatterlist) *
-			host->max_phys_segs, GFP_KERNEL);
-		if (!mq->sg) {
-			ret = -ENOMEM;
-			goto cleanup_queue;
+		for (i = 0; i < ARRAY_SIZE(mq->mqrq); i++) {
+			struct mmc_queue_req *mqrq = &mq->mqrq[i];
+
+			mqrq->sg = kmalloc(sizeof(struct scatterlist) *
+				host->max_phys_segs, GFP_KERNEL);
+			if (!mqrq->sg) {
+				ret = -ENOMEM;
+				goto cleanup_queue;
+			}
+			sg_init_table(mqrq->sg, host->max_phys_segs);
+		}
+	}
+
+	if (mmc_card_mmc(card) && card->ext_csd.max_packed_writes &&
+	    (host->caps & MMC_CAP_CMD23) && !mq->mqrq_cur->bounce_buf) {
+		for (i = 0; i < ARRAY_SIZE(mq->mqrq); i++) {
+			mq->mqrq[i].packed.cmd_hdr = kzalloc(512, GFP_KERNEL);
+			if (!mq->mqrq[i].packed.cmd_hdr) {
+				ret = -ENOMEM;
+				goto cleanup_queue;
+			}
 		}
-		sg_init_table(mq->sg, host->max_phys_segs);
 	}
 
 	init_MUTEX(&mq->thread_sem);
@@ -214,21 +278,12 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 	mq->thread = kthread_run(mmc_queue_thread, mq, "mmcqd");
 	if (IS_ERR(mq->thread)) {
 		ret = PTR_ERR(mq->thread);
-		goto free_bounce_sg;
+		goto cleanup_queue;
 	}
 
 	return 0;
- free_bounce_sg:
- 	if (mq->bounce_sg)
- 		kfree(mq->bounce_sg);
- 	mq->bounce_sg = NULL;
  cleanup_queue:
- 	if (mq->sg)
-		kfree(mq->sg);
-	mq->sg = NULL;
-	if (mq->bounce_buf)
-		kfree(mq->bounce_buf);
-	mq->bounce_buf = NULL;
+	mmc_queue_free_reqs(mq);
 	blk_cleanup_queue(mq->queue);
 	return ret;
 }
@@ -250,16 +305,7 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	blk_start_queue(q);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
- 	if (mq->bounce_sg)
- 		kfree(mq->bounce_sg);
- 	mq->bounce_sg = NULL;
-
-	kfree(mq->sg);
-	mq->sg = NULL;
-
-	if (mq->bounce_buf)
-		kfree(mq->bounce_buf);
-	mq->bounce_buf = NULL;
+	mmc_queue_free_reqs(mq);
 
 	mq->card = NULL;
 }
@@ -312,27 +358,58 @@ void mmc_queue_resume(struct mmc_queue *mq)
 /*
  * Prepare the sg list(s) to be handed of to the host driver
  */
-unsigned int mmc_queue_map_sg(struct mmc_queue *mq)
+/*
+ * Map all requests of a batched write, preceded by the packed command
+ * header if there is one, into one scatterlist.  Batches are never built
+ * on queues using bounce buffers.
+ */
+static unsigned int mmc_queue_packed_map_sg(struct mmc_queue *mq,
+					    struct mmc_queue_req *mqrq)
+{
+	struct mmc_packed *packed = &mqrq->packed;
+	struct scatterlist *sg = mqrq->sg;
+	struct request *req;
+	unsigned int sg_len = 0;
+
+	if (packed->type == MMC_PACKED_WRITE) {
+		sg_set_buf(sg, packed->cmd_hdr, 512);
+		sg_len = 1;
+	}
+
+	list_for_each_entry(req, &packed->list, queuelist) {
+		if (sg_len)
+			sg_unmark_end(&sg[sg_len - 1]);
+		sg_len += blk_rq_map_sg(mq->queue, req, &sg[sg_len]);
+	}
+	sg_mark_end(&sg[sg_len - 1]);
+
+	return sg_len;
+}
+
+unsigned int mmc_queue_map_sg(struct mmc_queue *mq, struct mmc_queue_req *mqrq)
 {
 	unsigned int sg_len;
 	size_t buflen;
 	struct scatterlist *sg;
 	int i;
 
-	if (!mq->bounce_buf)
-		return blk_rq_map_sg(mq->queue, mq->req, mq->sg);
+	if (mqrq->packed.type != MMC_PACKED_NONE)
+		return mmc_queue_packed_map_sg(mq, mqrq);
 
-	BUG_ON(!mq->bounce_sg);
+	if (!mqrq->bounce_buf)
+		return blk_rq_map_sg(mq->queue, mqrq->req, mqrq->sg);
 
-	sg_len = blk_rq_map_sg(mq->queue, mq->req, mq->bounce_sg);
+	BUG_ON(!mqrq->bounce_sg);
 
-	mq->bounce_sg_len = sg_len;
+	sg_len = blk_rq_map_sg(mq->queue, mqrq->req, mqrq->bounce_sg);
+
+	mqrq->bounce_sg_len = sg_len;
 
 	buflen = 0;
-	for_each_sg(mq->bounce_sg, sg, sg_len, i)
+	for_each_sg(mqrq->bounce_sg, sg, sg_len, i)
 		buflen += sg->length;
 
-	sg_init_one(mq->sg, mq->bounce_buf, buflen);
+	sg_init_one(mqrq->sg, mqrq->bounce_buf, buflen);
 
 	return 1;
 }
@@ -341,19 +418,19 @@ unsigned int mmc_queue_map_sg(struct mmc_queue *mq)
  * If writing, bounce the data to the buffer before the request
  * is sent to the host driver
  */
-void mmc_queue_bounce_pre(struct mmc_queue *mq)
+void mmc_queue_bounce_pre(struct mmc_queue_req *mqrq)
 {
 	unsigned long flags;
 
-	if (!mq->bounce_buf)
+	if (!mqrq->bounce_buf)
 		return;
 
-	if (rq_data_dir(mq->req) != WRITE)
+	if (rq_data_dir(mqrq->req) != WRITE)
 		return;
 
 	local_irq_save(flags);
-	sg_copy_to_buffer(mq->bounce_sg, mq->bounce_sg_len,
-		mq->bounce_buf, mq->sg[0].length);
+	sg_copy_to_buffer(mqrq->bounce_sg, mqrq->bounce_sg_len,
+		mqrq->bounce_buf, mqrq->sg[0].length);
 	local_irq_restore(flags);
 }
 
@@ -361,19 +438,18 @@ void mmc_queue_bounce_pre(struct mmc_queue *mq)
  * If reading, bounce the data from the buffer after the request
  * has been handled by the host driver
  */
-void mmc_queue_bounce_post(struct mmc_queue *mq)
+void mmc_queue_bounce_post(struct mmc_queue_req *mqrq)
 {
 	unsigned long flags;
 
-	if (!mq->bounce_buf)
+	if (!mqrq->bounce_buf)
 		return;
 
-	if (rq_data_dir(mq->req) != READ)
+	if (rq_data_dir(mqrq->req) != READ)
 		return;
 
 	local_irq_save(flags);
-	sg_copy_from_buffer(mq->bounce_sg, mq->bounce_sg_len,
-		mq->bounce_buf, mq->sg[0].length);
+	sg_copy_from_buffer(mqrq->bounce_sg, mqrq->bounce_sg_len,
+		mqrq->bounce_buf, mqrq->sg[0].length);
 	local_irq_restore(flags);
 }
-
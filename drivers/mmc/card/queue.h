@@ -4,28 +4,82 @@
 struct request;
 struct task_struct;
 
+struct mmc_blk_request {
+	struct mmc_request	mrq;
+	struct mmc_command	sbc;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+};
+
+/*
+ * Several write requests can be sent to the card as one command: either
+ * as a single CMD25 when they are contiguous on the card, or as an eMMC
+ * 4.5 packed write.
+ */
+enum mmc_packed_type {
+	MMC_PACKED_NONE = 0,
+	MMC_PACKED_MERGE,
+	MMC_PACKED_WRITE,
+	MMC_PACKED_NR_TYPES,
+};
+
+#define MMC_PACKED_MAX_ENTRIES	64
+
+struct mmc_packed {
+	struct list_head	list;		/* requests, linked by queuelist */
+	__le32			*cmd_hdr;	/* header block for packed writes */
+	unsigned int		nr_entries;
+	unsigned int		blocks;		/* data blocks, header excluded */
+	enum mmc_packed_type	type;
+};
+
+/* Write commands issued, by type and number of requests they carried */
+struct mmc_packed_stats {
+	unsigned long		cmds[MMC_PACKED_NR_TYPES][MMC_PACKED_MAX_ENTRIES + 1];
+};
+
+/*
+ * One in-flight (or being prepared) request.  The queue keeps two of
+ * these so that the next request can be mapped while the previous one
+ * is still transferring.
+ */
+struct mmc_queue_req {
+	struct request		*req;
+	struct mmc_blk_request	brq;
+	struct scatterlist	*sg;
+	char			*bounce_buf;
+	struct scatterlist	*bounce_sg;
+	unsigned int		bounce_sg_len;
+	struct mmc_async_req	mmc_active;
+	struct mmc_packed	packed;
+};
+
 struct mmc_queue {
 	struct mmc_card		*card;
 	struct task_struct	*thread;
 	struct semaphore	thread_sem;
 	unsigned int		flags;
-	struct request		*req;
 	int			(*issue_fn)(struct mmc_queue *, struct request *);
 	void			*data;
 	struct request_queue	*queue;
-	struct scatterlist	*sg;
-	char			*bounce_buf;
-	struct scatterlist	*bounce_sg;
-	unsigned int		bounce_sg_len;
+	struct mmc_queue_req	mqrq[2];
+	struct mmc_queue_req	*mqrq_cur;
+	struct mmc_queue_req	*mqrq_prev;
+	struct mmc_packed_stats	packed_stats;
 };
 
+#define MMC_QUEUE_SUSPENDED	(1 << 0)
+#define MMC_QUEUE_NO_PACKED	(1 << 1)	/* packed writes failed, don't use */
+
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *);
 extern void mmc_cleanup_queue(struct mmc_queue *);
 extern void mmc_queue_suspend(struct mmc_queue *);
 extern void mmc_queue_resume(struct mmc_queue *);
 
-extern unsigned int mmc_queue_map_sg(struct mmc_queue *);
-extern void mmc_queue_bounce_pre(struct mmc_queue *);
-extern void mmc_queue_bounce_post(struct mmc_queue *);
+extern unsigned int mmc_queue_map_sg(struct mmc_queue *,
+				     struct mmc_queue_req *);
+extern void mmc_queue_bounce_pre(struct mmc_queue_req *);
+extern void mmc_queue_bounce_post(struct mmc_queue_req *);
 
 #endif
@@ -412,6 +412,48 @@ static void sdhci_set_adma_desc(u8 *desc, u32 addr, int len, unsigned cmd)
 	dataddr[0] = cpu_to_le32(addr);
 }
 
+/*
+ * Map @data for DMA, or pick up the mapping sdhci_pre_req() already made.
+ * With @next set the mapping is done ahead of time and tagged with a
+ * cookie so that sdhci_prepare_data() can recognise it later.
+ */
+static int sdhci_pre_dma_transfer(struct sdhci_host *host,
+				  struct mmc_data *data,
+				  struct sdhci_next *next)
+{
+	int sg_count;
+
+	if (!next && data->host_cookie &&
+	    data->host_cookie != host->next_data.cookie) {
+		printk(KERN_WARNING "%s: invalid cookie, data->host_cookie %d"
+		       " host->next_data.cookie %d\n", mmc_hostname(host->mmc),
+		       data->host_cookie, host->next_data.cookie);
+		data->host_cookie = 0;
+	}
+
+	/* Check if next job is already prepared */
+	if (next || data->host_cookie != host->next_data.cookie) {
+		sg_count = dma_map_sg(mmc_dev(host->mmc), data->sg,
+				      data->sg_len,
+				      (data->flags & MMC_DATA_READ) ?
+					DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	} else {
+		sg_count = host->next_data.sg_count;
+		host->next_data.sg_count = 0;
+	}
+
+	if (sg_count == 0)
+		return -EINVAL;
+
+	if (next) {
+		next->sg_count = sg_count;
+		data->host_cookie = ++next->cookie < 0 ? 1 : next->cookie;
+	} else
+		host->sg_count = sg_count;
+
+	return sg_count;
+}
+
 static int sdhci_adma_table_pre(struct sdhci_host *host,
 	struct mmc_data *data)
 {
@@ -449,9 +491,7 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		goto fail;
 	BUG_ON(host->align_addr & 0x3);
 
-	host->sg_count = dma_map_sg(mmc_dev(host->mmc),
-		data->sg, data->sg_len, direction);
-	if (host->sg_count == 0)
+	if (sdhci_pre_dma_transfer(host, data, NULL) < 0)
 		goto unmap_align;
 
 	desc = host->adma_desc;
@@ -540,8 +580,9 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	return 0;
 
 unmap_entries:
-	dma_unmap_sg(mmc_dev(host->mmc), data->sg,
-		data->sg_len, direction);
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+			data->sg_len, direction);
 unmap_align:
 	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
 		128 * 4, direction);
@@ -591,8 +632,9 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 		}
 	}
 
-	dma_unmap_sg(mmc_dev(host->mmc), data->sg,
-		data->sg_len, direction);
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+			data->sg_len, direction);
 }
 
 static u8 sdhci_calc_timeout(struct sdhci_host *host, struct mmc_data *data)
@@ -655,6 +697,54 @@ static void sdhci_set_transfer_irqs(struct sdhci_host *host)
 		sdhci_clear_set_irqs(host, dma_irqs, pio_irqs);
 }
 
+/*
+ * Check the transfer against the DMA size and alignment quirks of the
+ * controller.  Returns 0 if the request has to fall back to PIO.
+ */
+static int sdhci_can_dma(struct sdhci_host *host, struct mmc_data *data)
+{
+	struct scatterlist *sg;
+	int i;
+
+	/*
+	 * FIXME: This doesn't account for merging when mapping the
+	 * scatterlist.
+	 */
+	if ((host->flags & SDHCI_USE_ADMA) ?
+	    (host->quirks & SDHCI_QUIRK_32BIT_ADMA_SIZE) :
+	    (host->quirks & SDHCI_QUIRK_32BIT_DMA_SIZE)) {
+		for_each_sg(data->sg, sg, data->sg_len, i) {
+			if (sg->length & 0x3) {
+				DBG("Reverting to PIO because of "
+					"transfer size (%d)\n",
+					sg->length);
+				return 0;
+			}
+		}
+	}
+
+	/*
+	 * The assumption here being that alignment is the same after
+	 * translation to device address space.
+	 *
+	 * As ADMA uses 3 byte chunks to work around alignment problems,
+	 * it needs to check the size quirk here as well.
+	 */
+	if ((host->flags & SDHCI_USE_ADMA) ?
+	    (host->quirks & SDHCI_QUIRK_32BIT_ADMA_SIZE) :
+	    (host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR)) {
+		for_each_sg(data->sg, sg, data->sg_len, i) {
+			if (sg->offset & 0x3) {
+				DBG("Reverting to PIO because of "
+					"bad alignment\n");
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
 static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_data *data)
 {
 	u8 count;
@@ -685,69 +775,8 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_data *data)
 			host->flags |= SDHCI_REQ_USE_DMA;
 	}
 
-	/*
-	 * FIXME: This doesn't account for merging when mapping the
-	 * scatterlist.
-	 */
-	if (host->flags & SDHCI_REQ_USE_DMA) {
-		int broken, i;
-		struct scatterlist *sg;
-
-		broken = 0;
-		if (host->flags & SDHCI_USE_ADMA) {
-			if (host->quirks & SDHCI_QUIRK_32BIT_ADMA_SIZE)
-				broken = 1;
-		} else {
-			if (host->quirks & SDHCI_QUIRK_32BIT_DMA_SIZE)
-				broken = 1;
-		}
-
-		if (unlikely(broken)) {
-			for_each_sg(data->sg, sg, data->sg_len, i) {
-				if (sg->length & 0x3) {
-					DBG("Reverting to PIO because of "
-						"transfer size (%d)\n",
-						sg->length);
-					host->flags &= ~SDHCI_REQ_USE_DMA;
-					break;
-				}
-			}
-		}
-	}
-
-	/*
-	 * The assumption here being that alignment is the same after
-	 * translation to device address space.
-	 */
-	if (host->flags & SDHCI_REQ_USE_DMA) {
-		int broken, i;
-		struct scatterlist *sg;
-
-		broken = 0;
-		if (host->flags & SDHCI_USE_ADMA) {
-			/*
-			 * As we use 3 byte chunks to work around
-			 * alignment problems, we need to check this
-			 * quirk.
-			 */
-			if (host->quirks & SDHCI_QUIRK_32BIT_ADMA_SIZE)
-				broken = 1;
-		} else {
-			if (host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR)
-				broken = 1;
-		}
-
-		if (unlikely(broken)) {
-			for_each_sg(data->sg, sg, data->sg_len, i) {
-				if (sg->offset & 0x3) {
-					DBG("Reverting to PIO because of "
-						"bad alignment\n");
-					host->flags &= ~SDHCI_REQ_USE_DMA;
-					break;
-				}
-			}
-		}
-	}
+	if ((host->flags & SDHCI_REQ_USE_DMA) && !sdhci_can_dma(host, data))
+		host->flags &= ~SDHCI_REQ_USE_DMA;
 
 	if (host->flags & SDHCI_REQ_USE_DMA) {
 		if (host->flags & SDHCI_USE_ADMA) {
@@ -766,12 +795,8 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_data *data)
 		} else {
 			int sg_cnt;
 
-			sg_cnt = dma_map_sg(mmc_dev(host->mmc),
-					data->sg, data->sg_len,
-					(data->flags & MMC_DATA_READ) ?
-						DMA_FROM_DEVICE :
-						DMA_TO_DEVICE);
-			if (sg_cnt == 0) {
+			sg_cnt = sdhci_pre_dma_transfer(host, data, NULL);
+			if (sg_cnt <= 0) {
 				/*
 				 * This only happens when someone fed
 				 * us an invalid request.
@@ -833,7 +858,8 @@ static void sdhci_set_transfer_mode(struct sdhci_host *host,
 
 	mode = SDHCI_TRNS_BLK_CNT_EN;
 	if (data->blocks > 1) {
-		if (host->quirks & SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12)
+		if (!host->mrq->sbc &&
+		    (host->quirks & SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12))
 			mode |= SDHCI_TRNS_MULTI | SDHCI_TRNS_ACMD12;
 		else
 			mode |= SDHCI_TRNS_MULTI;
@@ -858,7 +884,7 @@ static void sdhci_finish_data(struct sdhci_host *host)
 	if (host->flags & SDHCI_REQ_USE_DMA) {
 		if (host->flags & SDHCI_USE_ADMA)
 			sdhci_adma_table_post(host, data);
-		else {
+		else if (!data->host_cookie) {
 			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
 				data->sg_len, (data->flags & MMC_DATA_READ) ?
 					DMA_FROM_DEVICE : DMA_TO_DEVICE);
@@ -877,7 +903,11 @@ static void sdhci_finish_data(struct sdhci_host *host)
 	else
 		data->bytes_xfered = data->blksz * data->blocks;
 
-	if (data->stop) {
+	/*
+	 * With CMD23 the card stops on its own after the block count, so
+	 * the stop command is only needed to abort a failed transfer.
+	 */
+	if (data->stop && (data->error || !host->mrq->sbc)) {
 		/*
 		 * The controller needs a reset of internal state machines
 		 * upon error conditions.
@@ -986,6 +1016,13 @@ static void sdhci_finish_command(struct sdhci_host *host)
 
 	host->cmd->error = 0;
 
+	/* Finished CMD23, now send the actual command */
+	if (host->cmd == host->mrq->sbc) {
+		host->cmd = NULL;
+		sdhci_send_command(host, host->mrq->cmd);
+		return;
+	}
+
 	if (host->data && host->data_early)
 		sdhci_finish_data(host);
 
@@ -1143,7 +1180,7 @@ static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 #ifndef SDHCI_USE_LEDS_CLASS
 	sdhci_activate_led(host);
 #endif
-	if (host->quirks & SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12) {
+	if ((host->quirks & SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12) && !mrq->sbc) {
 		if (mrq->stop) {
 			mrq->data->stop = NULL;
 			mrq->stop = NULL;
@@ -1166,7 +1203,9 @@ static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	if (!present || host->flags & SDHCI_DEVICE_DEAD) {
 		host->mrq->cmd->error = -ENOMEDIUM;
 		tasklet_schedule(&host->finish_tasklet);
-	} else
+	} else if (mrq->sbc)
+		sdhci_send_command(host, mrq->sbc);
+	else
 		sdhci_send_command(host, mrq->cmd);
 
 	mmiowb();
@@ -1349,6 +1388,36 @@ out:
 	spin_unlock_irqrestore(&host->lock, host->spinlock_flags);
 }
 
+static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			  bool is_first_req)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data || data->host_cookie)
+		return;
+
+	if ((host->flags & (SDHCI_USE_SDMA | SDHCI_USE_ADMA)) &&
+	    sdhci_can_dma(host, data)) {
+		if (sdhci_pre_dma_transfer(host, data, &host->next_data) < 0)
+			data->host_cookie = 0;
+	}
+}
+
+static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			   int err)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (data && data->host_cookie) {
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     (data->flags & MMC_DATA_READ) ?
+				DMA_FROM_DEVICE : DMA_TO_DEVICE);
+		data->host_cookie = 0;
+	}
+}
+
 static int sdhci_get_ro(struct mmc_host *mmc)
 {
 	struct sdhci_host *host;
@@ -1433,6 +1502,8 @@ int sdhci_disable(struct mmc_host *mmc, int lazy)
 }
 
 static const struct mmc_host_ops sdhci_ops = {
+	.pre_req	= sdhci_pre_req,
+	.post_req	= sdhci_post_req,
 	.request	= sdhci_request,
 	.set_ios	= sdhci_set_ios,
 	.get_ro		= sdhci_get_ro,
@@ -1507,7 +1578,7 @@ static void sdhci_tasklet_finish(unsigned long param)
 	 * upon error conditions.
 	 */
 	if (!(host->flags & SDHCI_DEVICE_DEAD) &&
-		(mrq->cmd->error ||
+		(mrq->cmd->error || (mrq->sbc && mrq->sbc->error) ||
 		 (mrq->data && (mrq->data->error ||
 		  (mrq->data->stop && mrq->data->stop->error))) ||
 		   (host->quirks & SDHCI_QUIRK_RESET_AFTER_REQUEST))) {
@@ -2031,7 +2102,7 @@ int sdhci_add_host(struct sdhci_host *host)
 		mmc->f_min = host->max_clk / 256;
 
 	mmc->f_max = host->max_clk;
-	mmc->caps = 0;
+	mmc->caps = MMC_CAP_CMD23;
 
 	if (host->quirks & SDHCI_QUIRK_8_BIT_DATA)
 		mmc->caps |= MMC_CAP_8_BIT_DATA;
@@ -355,6 +355,7 @@ struct binder_transaction {
 	long	priority;
 	long	saved_priority;
 	uid_t	sender_euid;
+	unsigned long	boost_stamp;
 };
 
 static void
@@ -1562,6 +1563,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->code = tr->code;
 	t->flags = tr->flags;
 	t->priority = task_nice(current);
+	t->boost_stamp = task_boost_stamp(current);
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
 	if (t->buffer == NULL) {
@@ -2467,6 +2469,9 @@ retry:
 			else if (!(t->flags & TF_ONE_WAY) ||
 				 t->saved_priority > target_node->min_priority)
 				binder_set_nice(target_node->min_priority);
+			/* the work of a task handling input is input work */
+			if (t->boost_stamp)
+				sched_boost_task(current, t->boost_stamp);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = NULL;
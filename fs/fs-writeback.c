@@ -617,6 +617,7 @@ static long wb_writeback(struct bdi_writeback *wb,
 	unsigned long oldest_jif;
 	long wrote = 0;
 	struct inode *inode;
+	struct blk_plug plug;
 
 	if (wbc.for_kupdate) {
 		wbc.older_than_this = &oldest_jif;
@@ -628,6 +629,8 @@ static long wb_writeback(struct bdi_writeback *wb,
 		wbc.range_end = LLONG_MAX;
 	}
 
+	blk_start_plug(&plug);
+
 	wbc.wb_start = jiffies; /* livelock avoidance */
 	for (;;) {
 		/*
@@ -687,6 +690,8 @@ static long wb_writeback(struct bdi_writeback *wb,
 		spin_unlock(&inode_lock);
 	}
 
+	blk_finish_plug(&plug);
+
 	return wrote;
 }
 
@@ -294,6 +294,7 @@ void end_writeback(struct inode *inode)
 {
 	might_sleep();
 	BUG_ON(inode->i_data.nrpages);
+	BUG_ON(inode->i_data.nrshadows);
 	BUG_ON(!list_empty(&inode->i_data.private_list));
 	BUG_ON(!(inode->i_state & I_FREEING));
 	BUG_ON(inode->i_state & I_CLEAR);
@@ -306,10 +307,19 @@ static void evict(struct inode *inode)
 {
 	const struct super_operations *op = inode->i_sb->s_op;
 
+	/*
+	 * Keep reclaim from leaving new shadow entries behind, and wait
+	 * for any that is doing so right now: the final truncate below
+	 * has to see them all.
+	 */
+	mapping_set_exiting(&inode->i_data);
+	spin_lock_irq(&inode->i_data.tree_lock);
+	spin_unlock_irq(&inode->i_data.tree_lock);
+
 	if (op->evict_inode) {
 		op->evict_inode(inode);
 	} else {
-		if (inode->i_data.nrpages)
+		if (inode->i_data.nrpages || inode->i_data.nrshadows)
 			truncate_inode_pages(&inode->i_data, 0);
 		end_writeback(inode);
 	}
@@ -436,6 +436,11 @@ repeat:
 			smap->nrpages--;
 			spin_unlock_irq(&smap->tree_lock);
 
+			/* drop the shadow entry of an evicted page, if any */
+			if (dmap->nrshadows)
+				invalidate_inode_pages2_range(dmap, offset,
+							      offset);
+
 			spin_lock_irq(&dmap->tree_lock);
 			err = radix_tree_insert(&dmap->page_tree, offset, page);
 			if (unlikely(err < 0)) {
@@ -452,6 +452,98 @@ const struct file_operations proc_smaps_operations = {
 	.release	= seq_release_private,
 };
 
+/*
+ * smaps_rollup: the smaps counters summed over all the vmas of a process,
+ * for tools that only want the totals and would otherwise have to format
+ * and parse one smaps record per vma.
+ */
+static int show_smaps_rollup(struct seq_file *m, void *v)
+{
+	struct inode *inode = m->private;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	struct mem_size_stats mss;
+	struct mm_walk smaps_walk = {
+		.pmd_entry = smaps_pte_range,
+		.private = &mss,
+	};
+	unsigned long start = 0, end = 0;
+	u64 pss_locked = 0;
+	int len;
+
+	task = get_proc_task(inode);
+	if (!task)
+		return -ESRCH;
+
+	mm = mm_for_maps(task);
+	if (!mm) {
+		put_task_struct(task);
+		return 0;
+	}
+
+	memset(&mss, 0, sizeof mss);
+	smaps_walk.mm = mm;
+
+	down_read(&mm->mmap_sem);
+	if (mm->mmap)
+		start = mm->mmap->vm_start;
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		u64 pss = mss.pss;
+
+		end = vma->vm_end;
+		if (is_vm_hugetlb_page(vma))
+			continue;
+		mss.vma = vma;
+		walk_page_range(vma->vm_start, vma->vm_end, &smaps_walk);
+		if (vma->vm_flags & VM_LOCKED)
+			pss_locked += mss.pss - pss;
+	}
+	up_read(&mm->mmap_sem);
+	mmput(mm);
+	put_task_struct(task);
+
+	/* Same layout as an smaps record, so that parsers can be reused */
+	seq_printf(m, "%08lx-%08lx ---p %08llx %02x:%02x %lu %n",
+		   start, end, 0ULL, 0, 0, 0UL, &len);
+	pad_len_spaces(m, len);
+	seq_printf(m, "[rollup]\n");
+
+	seq_printf(m,
+		   "Rss:            %8lu kB\n"
+		   "Pss:            %8lu kB\n"
+		   "Shared_Clean:   %8lu kB\n"
+		   "Shared_Dirty:   %8lu kB\n"
+		   "Private_Clean:  %8lu kB\n"
+		   "Private_Dirty:  %8lu kB\n"
+		   "Referenced:     %8lu kB\n"
+		   "Swap:           %8lu kB\n"
+		   "Locked:         %8lu kB\n",
+		   mss.resident >> 10,
+		   (unsigned long)(mss.pss >> (10 + PSS_SHIFT)),
+		   mss.shared_clean  >> 10,
+		   mss.shared_dirty  >> 10,
+		   mss.private_clean >> 10,
+		   mss.private_dirty >> 10,
+		   mss.referenced >> 10,
+		   mss.swap >> 10,
+		   (unsigned long)(pss_locked >> (10 + PSS_SHIFT)));
+
+	return 0;
+}
+
+static int smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_smaps_rollup, inode);
+}
+
+const struct file_operations proc_smaps_rollup_operations = {
+	.open		= smaps_rollup_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int clear_refs_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
@@ -544,6 +636,124 @@ const struct file_operations proc_clear_refs_operations = {
 	.write		= clear_refs_write,
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->private;
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	LIST_HEAD(page_list);
+	int isolated = 0;
+
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		/* Pages shared with other processes are left alone. */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		if (isolate_lru_page(page))
+			continue;
+
+		list_add(&page->lru, &page_list);
+		if (++isolated < SWAP_CLUSTER_MAX)
+			continue;
+
+		/* Reclaim in batches, without holding the page table lock. */
+		pte_unmap_unlock(orig_pte, ptl);
+		reclaim_pages_from_list(&page_list);
+		isolated = 0;
+		cond_resched();
+		orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+	if (isolated)
+		reclaim_pages_from_list(&page_list);
+	cond_resched();
+	return 0;
+}
+
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[PROC_NUMBUF];
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	char *type_buf;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+
+	type_buf = strstrip(buffer);
+	if (!strcmp(type_buf, "file"))
+		type = RECLAIM_FILE;
+	else if (!strcmp(type_buf, "anon"))
+		type = RECLAIM_ANON;
+	else if (!strcmp(type_buf, "all"))
+		type = RECLAIM_ALL;
+	else
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+
+	/* Pages still in the per-cpu LRU add vectors cannot be isolated. */
+	lru_add_drain_all();
+
+	mm = get_task_mm(task);
+	if (mm) {
+		struct mm_walk reclaim_walk = {
+			.pmd_entry = reclaim_pte_range,
+			.mm = mm,
+		};
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			reclaim_walk.private = vma;
+			if (is_vm_hugetlb_page(vma))
+				continue;
+			if (vma->vm_flags & VM_LOCKED)
+				continue;
+			if (type == RECLAIM_ANON && vma->vm_file)
+				continue;
+			if (type == RECLAIM_FILE && !vma->vm_file)
+				continue;
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&reclaim_walk);
+		}
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.write		= reclaim_write,
+};
+#endif
+
 struct pagemapread {
 	int pos, len;
 	u64 *buffer;
@@ -30,6 +30,7 @@ struct request_pm_state;
 struct blk_trace;
 struct request;
 struct sg_io_hdr;
+struct blk_latency_hist;
 
 #define BLKDEV_MIN_RQ	4
 #define BLKDEV_MAX_RQ	128	/* Default maximum */
@@ -160,7 +161,7 @@ struct request {
 
 	struct gendisk *rq_disk;
 	unsigned long start_time;
-#ifdef CONFIG_BLK_CGROUP
+#if defined(CONFIG_BLK_CGROUP) || defined(CONFIG_BLK_DEV_LATENCY_HIST)
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
 #endif
@@ -411,6 +412,9 @@ struct request_queue
 #if defined(CONFIG_BLK_DEV_BSG)
 	struct bsg_class_device bsg_dev;
 #endif
+#ifdef CONFIG_BLK_DEV_LATENCY_HIST
+	struct blk_latency_hist __percpu *latency_hist;
+#endif
 };
 
 #define QUEUE_FLAG_QUEUED	1	/* uses generic tag queueing */
@@ -1178,7 +1182,58 @@ static inline void put_dev_sector(Sector p)
 struct work_struct;
 int kblockd_schedule_work(struct request_queue *q, struct work_struct *work);
 
-#ifdef CONFIG_BLK_CGROUP
+/*
+ * blk_plug allows a task to build a batch of related requests on its own
+ * stack, without touching the queue lock for every bio.  The batch is
+ * handed to the queue(s) in one go when the plug is finished, or when the
+ * task blocks.
+ *
+ *	struct blk_plug plug;
+ *
+ *	blk_start_plug(&plug);
+ *	submit_bio(...);
+ *	...
+ *	blk_finish_plug(&plug);
+ *
+ * Plugs can be nested; only the outermost one collects requests.
+ */
+#define BLK_MAX_REQUEST_COUNT	16
+
+struct blk_plug {
+	unsigned long magic;
+	struct list_head list;		/* requests waiting to be queued */
+	unsigned int count;		/* number of requests on ->list */
+	unsigned int should_sort;	/* ->list spans several queues */
+};
+
+extern void blk_start_plug(struct blk_plug *);
+extern void blk_finish_plug(struct blk_plug *);
+extern void blk_flush_plug_list(struct blk_plug *, bool);
+
+static inline void blk_flush_plug(struct task_struct *tsk)
+{
+	struct blk_plug *plug = tsk->plug;
+
+	if (plug)
+		blk_flush_plug_list(plug, false);
+}
+
+static inline void blk_schedule_flush_plug(struct task_struct *tsk)
+{
+	struct blk_plug *plug = tsk->plug;
+
+	if (plug)
+		blk_flush_plug_list(plug, true);
+}
+
+static inline bool blk_needs_flush_plug(struct task_struct *tsk)
+{
+	struct blk_plug *plug = tsk->plug;
+
+	return plug && !list_empty(&plug->list);
+}
+
+#if defined(CONFIG_BLK_CGROUP) || defined(CONFIG_BLK_DEV_LATENCY_HIST)
 /*
  * This should not be using sched_clock(). A real patch is in progress
  * to fix this up, until that is in place we need to disable preemption
@@ -1327,6 +1382,30 @@ static inline long nr_blockdev_pages(void)
 	return 0;
 }
 
+struct blk_plug {
+};
+
+static inline void blk_start_plug(struct blk_plug *plug)
+{
+}
+
+static inline void blk_finish_plug(struct blk_plug *plug)
+{
+}
+
+static inline void blk_flush_plug(struct task_struct *task)
+{
+}
+
+static inline void blk_schedule_flush_plug(struct task_struct *task)
+{
+}
+
+static inline bool blk_needs_flush_plug(struct task_struct *tsk)
+{
+	return false;
+}
+
 #endif /* CONFIG_BLOCK */
 
 #endif
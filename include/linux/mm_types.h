@@ -177,6 +177,10 @@ struct vm_area_struct {
 	void * vm_private_data;		/* was vm_pte (shared mem) */
 	unsigned long vm_truncate_count;/* truncate_count or restart_addr */
 
+#ifdef CONFIG_SWAP
+	atomic_long_t swap_readahead_info; /* last swap fault, window, hits */
+#endif
+
 #ifndef CONFIG_MMU
 	struct vm_region *vm_region;	/* NOMMU mapping region */
 #endif
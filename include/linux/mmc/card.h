@@ -55,6 +55,7 @@ struct mmc_ext_csd {
 	unsigned int		sec_erase_mult;	/* Secure erase multiplier */
 	unsigned int		trim_timeout;		/* In milliseconds */
 	unsigned int		card_type;
+	unsigned int		max_packed_writes;	/* 0 if unsupported */
 };
 
 struct sd_scr {
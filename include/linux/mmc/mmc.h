@@ -267,6 +267,7 @@ struct _mmc_csd {
 #define EXT_CSD_SEC_ERASE_MULT		230	/* RO */
 #define EXT_CSD_SEC_FEATURE_SUPPORT	231	/* RO */
 #define EXT_CSD_TRIM_MULT		232	/* RO */
+#define EXT_CSD_MAX_PACKED_WRITES	500	/* RO */
 
 /*
  * EXT_CSD field definitions
@@ -291,6 +292,21 @@ struct _mmc_csd {
 #define EXT_CSD_SEC_BD_BLK_EN	BIT(2)
 #define EXT_CSD_SEC_GB_CL_EN	BIT(4)
 
+/*
+ * SET_BLOCK_COUNT (CMD23) argument bits
+ */
+
+#define MMC_CMD23_ARG_REL_WR	(1 << 31)	/* Reliable write */
+#define MMC_CMD23_ARG_PACKED	(1 << 30)	/* Packed command follows */
+
+/*
+ * Packed command header (first data block of a packed command)
+ */
+
+#define MMC_PACKED_CMD_VER	0x01
+#define MMC_PACKED_CMD_WR	0x02
+#define MMC_PACKED_CMD_MAX	63	/* entries fitting in one header block */
+
 /*
  * MMC_SWITCH access modes
  */
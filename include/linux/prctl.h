@@ -102,4 +102,11 @@
 
 #define PR_MCE_KILL_GET 34
 
+/*
+ * Join the scheduler autogroup of that id among the processes of the
+ * caller's uid, 0 to leave it.  Only when kernel.sched_autogroup_key is 2.
+ */
+#define PR_SET_AUTOGROUP 35
+#define PR_GET_AUTOGROUP 36
+
 #endif /* _LINUX_PRCTL_H */
@@ -42,6 +42,21 @@ static inline int radix_tree_is_indirect_ptr(void *ptr)
 	return (int)((unsigned long)ptr & RADIX_TREE_INDIRECT_PTR);
 }
 
+/*
+ * An exceptional entry is a data item with bit 1 set: rather than a
+ * pointer, the remaining bits (above RADIX_TREE_EXCEPTIONAL_SHIFT) hold
+ * a value chosen by the user.  The page cache uses these to remember
+ * recently evicted pages.  Like other items, exceptional entries are
+ * returned by the lookup functions and callers must be prepared for them.
+ */
+#define RADIX_TREE_EXCEPTIONAL_ENTRY	2
+#define RADIX_TREE_EXCEPTIONAL_SHIFT	2
+
+static inline int radix_tree_exceptional_entry(void *arg)
+{
+	return (int)((unsigned long)arg & RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
 /*** radix-tree API starts here ***/
 
 #define RADIX_TREE_MAX_TAGS 3
@@ -173,6 +188,7 @@ radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
 			unsigned long first_index, unsigned int max_items);
 unsigned int
 radix_tree_gang_lookup_slot(struct radix_tree_root *root, void ***results,
+			unsigned long *indices,
 			unsigned long first_index, unsigned int max_items);
 unsigned long radix_tree_next_hole(struct radix_tree_root *root,
 				unsigned long index, unsigned long max_scan);
@@ -38,6 +38,13 @@ struct res_counter {
 	 * the limit that usage can be exceed
 	 */
 	unsigned long long soft_limit;
+	/*
+	 * usage above which the controller should start reclaiming the
+	 * resource in the background, and the usage it should bring it
+	 * back down to (low_wmark <= high_wmark)
+	 */
+	unsigned long long high_wmark;
+	unsigned long long low_wmark;
 	/*
 	 * the number of unsuccessful attempts to consume the resource
 	 */
@@ -92,6 +99,8 @@ enum {
 	RES_LIMIT,
 	RES_FAILCNT,
 	RES_SOFT_LIMIT,
+	RES_HIGH_WMARK,
+	RES_LOW_WMARK,
 };
 
 /*
@@ -193,6 +202,28 @@ static inline bool res_counter_check_under_soft_limit(struct res_counter *cnt)
 	return ret;
 }
 
+static inline bool res_counter_check_over_high_wmark(struct res_counter *cnt)
+{
+	bool ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	ret = cnt->usage > cnt->high_wmark;
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return ret;
+}
+
+static inline bool res_counter_check_under_low_wmark(struct res_counter *cnt)
+{
+	bool ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	ret = cnt->usage <= cnt->low_wmark;
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return ret;
+}
+
 static inline void res_counter_reset_max(struct res_counter *cnt)
 {
 	unsigned long flags;
@@ -238,4 +269,38 @@ res_counter_set_soft_limit(struct res_counter *cnt,
 	return 0;
 }
 
+/*
+ * Lowering the high watermark below the low one drags the low one down
+ * with it; the low watermark can't be set above the high one.
+ */
+static inline int
+res_counter_set_high_wmark(struct res_counter *cnt,
+				unsigned long long wmark)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	cnt->high_wmark = wmark;
+	if (cnt->low_wmark > wmark)
+		cnt->low_wmark = wmark;
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return 0;
+}
+
+static inline int
+res_counter_set_low_wmark(struct res_counter *cnt,
+				unsigned long long wmark)
+{
+	unsigned long flags;
+	int ret = -EINVAL;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	if (wmark <= cnt->high_wmark) {
+		cnt->low_wmark = wmark;
+		ret = 0;
+	}
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return ret;
+}
+
 #endif
@@ -98,6 +98,7 @@ struct exec_domain;
 struct futex_pi_state;
 struct robust_list_head;
 struct bio_list;
+struct blk_plug;
 struct fs_struct;
 struct perf_event_context;
 
@@ -1122,6 +1123,19 @@ struct sched_statistics {
 };
 #endif
 
+/*
+ * Decayed averages of the time an entity spent runnable and running: the
+ * sums add up the time, in ~1ms periods, each period weighing y times the
+ * following one, with y^32 = 0.5.  avg_period sums all the time the same
+ * way, to scale them.
+ */
+struct sched_avg {
+	u64			last_update_time;
+	u32			runnable_avg_sum;
+	u32			running_avg_sum;
+	u32			avg_period;
+};
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1135,6 +1149,12 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+	struct sched_avg	avg;
+
+	/* average time run per wakeup, from sum_exec_runtime at wakeup */
+	u64			burst_start;
+	u64			avg_burst;
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1187,6 +1207,11 @@ struct task_struct {
 	struct sched_entity se;
 	struct sched_rt_entity rt;
 
+#ifdef CONFIG_CPU_FREQ
+	/* jiffies of the user input this task handles, see sched_boost_task */
+	unsigned long boost_stamp;
+#endif
+
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
 	struct hlist_head preempt_notifiers;
@@ -1401,6 +1426,11 @@ struct task_struct {
 /* stacked block device info */
 	struct bio_list *bio_list;
 
+#ifdef CONFIG_BLOCK
+/* stack plugging */
+	struct blk_plug *plug;
+#endif
+
 /* VM state */
 	struct reclaim_state *reclaim_state;
 
@@ -1864,6 +1894,12 @@ extern void wake_up_idle_cpu(int cpu);
 static inline void wake_up_idle_cpu(int cpu) { }
 #endif
 
+#if defined(CONFIG_CPU_IDLE) && defined(CONFIG_SMP)
+extern void sched_set_idle_exit_latency(unsigned int latency);
+#else
+static inline void sched_set_idle_exit_latency(unsigned int latency) { }
+#endif
+
 extern void force_cpu_resched(int cpu);
 
 extern unsigned int sysctl_sched_latency;
@@ -1884,6 +1920,7 @@ extern enum sched_tunable_scaling sysctl_sched_tunable_scaling;
 #ifdef CONFIG_SCHED_DEBUG
 extern unsigned int sysctl_sched_migration_cost;
 extern unsigned int sysctl_sched_nr_migrate;
+extern unsigned int sysctl_sched_wake_idle_scan;
 extern unsigned int sysctl_sched_time_avg;
 extern unsigned int sysctl_timer_migration;
 
@@ -1911,14 +1948,27 @@ int sched_rt_handler(struct ctl_table *table, int write,
 
 extern unsigned int sysctl_sched_compat_yield;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+extern unsigned int sysctl_sched_cfs_bandwidth_slice;
+#endif
+
+#define AUTOGROUP_KEY_SESSION	0
+#define AUTOGROUP_KEY_UID	1
+#define AUTOGROUP_KEY_PRCTL	2
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 extern unsigned int sysctl_sched_autogroup_enabled;
+extern unsigned int sysctl_sched_autogroup_key;
 extern int sysctl_sched_autogroup_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos);
 
 extern void sched_autogroup_create_attach(struct task_struct *p);
 extern void sched_autogroup_detach(struct task_struct *p);
+extern void sched_autogroup_setsid(struct task_struct *p);
+extern void sched_autogroup_setuid(struct task_struct *p, uid_t uid);
+extern int sched_autogroup_set_key(unsigned long key);
+extern long sched_autogroup_get_key(void);
 extern void sched_autogroup_fork(struct signal_struct *sig);
 extern void sched_autogroup_exit(struct signal_struct *sig);
 #ifdef CONFIG_PROC_FS
@@ -1928,6 +1978,10 @@ extern int proc_sched_autogroup_set_nice(struct task_struct *p, int *nice);
 #else
 static inline void sched_autogroup_create_attach(struct task_struct *p) { }
 static inline void sched_autogroup_detach(struct task_struct *p) { }
+static inline void sched_autogroup_setsid(struct task_struct *p) { }
+static inline void sched_autogroup_setuid(struct task_struct *p, uid_t uid) { }
+static inline int sched_autogroup_set_key(unsigned long key) { return -EINVAL; }
+static inline long sched_autogroup_get_key(void) { return -EINVAL; }
 static inline void sched_autogroup_fork(struct signal_struct *sig) { }
 static inline void sched_autogroup_exit(struct signal_struct *sig) { }
 #endif
@@ -2492,6 +2546,43 @@ extern int sched_rt_can_attach(struct task_group *tg, struct task_struct *tsk);
 #endif
 #endif
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Called by the scheduler, with the runqueue of the cpu locked, whenever
+ * the utilization of the cpu by CFS tasks is updated: on enqueue, dequeue
+ * and every tick.  @util is out of @max.
+ */
+struct update_util_data {
+	void (*func)(struct update_util_data *data, u64 time,
+		     unsigned long util, unsigned long max);
+};
+
+extern void cpufreq_set_update_util_data(int cpu,
+					 struct update_util_data *data);
+
+/*
+ * Tasks handling user input are tagged with the time of that input, so
+ * that cpufreq governors can speed up the cpus running them for a while.
+ * The boost notifiers are called with the stamp and the task.
+ */
+struct notifier_block;
+extern void sched_boost_task(struct task_struct *p, unsigned long stamp);
+extern int register_sched_boost_notifier(struct notifier_block *nb);
+extern int unregister_sched_boost_notifier(struct notifier_block *nb);
+extern void sched_set_boost_lifetime(unsigned long lifetime);
+extern unsigned long task_boost_stamp(struct task_struct *p);
+#else
+static inline void sched_boost_task(struct task_struct *p,
+				    unsigned long stamp)
+{
+}
+
+static inline unsigned long task_boost_stamp(struct task_struct *p)
+{
+	return 0;
+}
+#endif
+
 extern int task_can_switch_user(struct user_struct *up,
 					struct task_struct *tsk);
 
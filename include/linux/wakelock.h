@@ -39,6 +39,7 @@ struct wake_lock {
 	const char         *name;
 	unsigned long       expires;
 #ifdef CONFIG_WAKELOCK_STAT
+	struct list_head    stat_link;
 	struct {
 		int             count;
 		int             expire_count;
@@ -55,6 +56,7 @@ struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 
 void wake_lock_init(struct wake_lock *lock, int type, const char *name);
+/* wake_lock_destroy may sleep, waiting for stats readers to drop the lock */
 void wake_lock_destroy(struct wake_lock *lock);
 void wake_lock(struct wake_lock *lock);
 void wake_lock_timeout(struct wake_lock *lock, long timeout);
@@ -69,7 +71,8 @@ int wake_lock_active(struct wake_lock *lock);
 /* has_wake_lock returns 0 if no wake locks of the specified type are active,
  * and non-zero if one or more wake locks are held. Specifically it returns
  * -1 if one or more wake locks with no timeout are active or the
- * number of jiffies until all active wake locks time out.
+ * number of jiffies until all active wake locks time out. It does not depend
+ * on the number of wake locks held.
  */
 long has_wake_lock(int type);
 
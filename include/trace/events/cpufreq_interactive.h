@@ -0,0 +1,53 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_interactive
+
+#if !defined(_TRACE_CPUFREQ_INTERACTIVE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_INTERACTIVE_H
+
+#include <linux/sched.h>
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(task_boost,
+
+	TP_PROTO(unsigned int cpu, struct task_struct *p, unsigned int freq),
+
+	TP_ARGS(cpu, p, freq),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,		pid		)
+		__field(	unsigned int,	freq		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid = p->pid;
+		__entry->freq = freq;
+	),
+
+	TP_printk("cpu=%u comm=%s pid=%d freq=%u", __entry->cpu,
+		  __entry->comm, __entry->pid, __entry->freq)
+);
+
+/* A cpu running a task handling input is kept at least at hispeed_freq */
+DEFINE_EVENT(task_boost, cpufreq_interactive_boost_start,
+
+	TP_PROTO(unsigned int cpu, struct task_struct *p, unsigned int freq),
+
+	TP_ARGS(cpu, p, freq)
+);
+
+/* That task got to sleep, moved or was done with the input */
+DEFINE_EVENT(task_boost, cpufreq_interactive_boost_end,
+
+	TP_PROTO(unsigned int cpu, struct task_struct *p, unsigned int freq),
+
+	TP_ARGS(cpu, p, freq)
+);
+
+#endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -524,6 +524,8 @@ int commit_creds(struct cred *new)
 	    new->suid  != old->suid ||
 	    new->fsuid != old->fsuid)
 		proc_id_connector(task, PROC_EVENT_UID);
+	if (new->uid != old->uid)
+		sched_autogroup_setuid(task, new->uid);
 
 	if (new->gid   != old->gid  ||
 	    new->egid  != old->egid ||
@@ -34,11 +34,20 @@
 /*
  * This RCU maintains three callback lists: the current batch (per cpu),
  * the previous batch (also per cpu), and the pending list (global).
+ *
+ * Callbacks whose batch has ended are then invoked from the ready list
+ * (global), at most rcu_cb_limit of them per pass, the rest being carried
+ * over to the next pass.  Or, when offloading, from per cpu lists by per
+ * cpu kernel threads which may be bound to housekeeping cpus.
  */
 
 #include <linux/bug.h>
 #include <linux/smp.h>
+#include <linux/wait.h>
 #include <linux/ctype.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/types.h>
 #include <linux/kernel.h>
@@ -46,7 +55,9 @@
 #include <linux/percpu.h>
 #include <linux/stddef.h>
 #include <linux/string.h>
+#include <linux/cpumask.h>
 #include <linux/preempt.h>
+#include <linux/spinlock.h>
 #include <linux/compiler.h>
 #include <linux/irqflags.h>
 #include <linux/rcupdate.h>
@@ -103,6 +114,20 @@ static inline void rcu_list_join(struct rcu_list *to, struct rcu_list *from)
 	}
 }
 
+/*
+ * A list of callbacks ready to be invoked, with the statistics of their
+ * invocation.  The counts of callbacks queued and invoked only ever go up,
+ * rcu_barrier() waits on them.
+ */
+struct rcu_cbq {
+	struct rcu_list list;
+	unsigned long nqueued;	/* #callbacks ever queued */
+	unsigned long ndone;	/* #callbacks ever invoked */
+	unsigned nlimited;	/* #passes which hit rcu_cb_limit */
+	unsigned max_cbs;	/* most callbacks invoked in one pass */
+	u64 max_ns;		/* longest time spent invoking them */
+};
+
 /*
  * selects, in ->cblist[] below, which is the current callback list and which
  * is the previous.
@@ -113,10 +138,38 @@ struct rcu_data {
 	u8 wait;		/* goes false when this cpu consents to
 				 * the retirement of the current batch */
 	struct rcu_list cblist[2]; /* current & previous callback lists */
+	spinlock_t offload_lock; /* protects offload.list */
+	struct rcu_cbq offload;	/* ended batches left to offload_task */
+	struct task_struct *offload_task;
+	unsigned long barrier_snap; /* offload.nqueued at rcu_barrier() */
 } ____cacheline_aligned_in_smp;
 
 static struct rcu_data rcu_data[NR_CPUS];
 
+/* Ended batches to be invoked by the batch-ending cpu itself */
+static struct rcu_cbq rcu_ready;
+static unsigned long rcu_ready_snap;
+
+/*
+ * The most callbacks invoked by one pass (0 for no limit), and whether
+ * the per cpu kernel threads invoke them.  See "jrcu_limit=" and
+ * "jrcu_offload=" in Documentation/kernel-parameters.txt.
+ */
+static int rcu_cb_limit;
+static int rcu_offload;
+static cpumask_t rcu_offload_cpus;
+
+static DEFINE_MUTEX(rcu_barrier_mutex);
+static DECLARE_WAIT_QUEUE_HEAD(rcu_barrier_wq);
+
+/* Serializes the passes, see rcu_pass() */
+static DEFINE_SPINLOCK(rcu_delimit_lock);
+
+/* Expedited passes made before synchronize_sched_expedited() gives up */
+static int rcu_expedited_tries = 1000;
+/* Longest busy wait between two expedited passes that ended no batch */
+#define RCU_EXPEDITE_MAX_BACKOFF_US 64
+
 /* debug & statistics stuff */
 static struct rcu_stats {
 	unsigned npasses;	/* #passes made */
@@ -125,7 +178,8 @@ static struct rcu_stats {
 	unsigned nmis;		/* #passes discarded due to NMI */
 	atomic_t nbarriers;	/* #rcu barriers processed */
 	atomic_t nsyncs;	/* #rcu syncs processed */
-	u64 ninvoked;		/* #invoked (ie, finished) callbacks */
+	atomic_t nexpedited;	/* #expedited rcu syncs processed */
+	unsigned nexp_passes;	/* #passes made to expedite them */
 	atomic_t nleft;		/* #callbacks left (ie, not yet invoked) */
 	unsigned nforced;	/* #forced eobs (should be zero) */
 } rcu_stats;
@@ -225,10 +279,45 @@ void synchronize_sched(void)
 }
 EXPORT_SYMBOL_GPL(synchronize_sched);
 
+/*
+ * Once their batch has ended, callbacks may still wait on the ready list
+ * or on the lists of the offload threads.  Those lists are FIFO, so every
+ * callback queued so far has been invoked once as many callbacks have
+ * been invoked from each of them as had been queued on it.
+ */
+static int rcu_barrier_done(void)
+{
+	int cpu;
+
+	if ((long)(ACCESS_ONCE(rcu_ready.ndone) - rcu_ready_snap) < 0)
+		return 0;
+	for_each_present_cpu(cpu) {
+		struct rcu_data *rd = &rcu_data[cpu];
+
+		if ((long)(ACCESS_ONCE(rd->offload.ndone) -
+			   rd->barrier_snap) < 0)
+			return 0;
+	}
+	return 1;
+}
+
 void rcu_barrier(void)
 {
+	int cpu;
+
 	synchronize_sched();
 	synchronize_sched();
+
+	mutex_lock(&rcu_barrier_mutex);
+	rcu_ready_snap = ACCESS_ONCE(rcu_ready.nqueued);
+	for_each_present_cpu(cpu) {
+		struct rcu_data *rd = &rcu_data[cpu];
+
+		rd->barrier_snap = ACCESS_ONCE(rd->offload.nqueued);
+	}
+	wait_event(rcu_barrier_wq, rcu_barrier_done());
+	mutex_unlock(&rcu_barrier_mutex);
+
 	atomic_inc(&rcu_stats.nbarriers);
 }
 EXPORT_SYMBOL_GPL(rcu_barrier);
@@ -270,19 +359,63 @@ void call_rcu(struct rcu_head *cb, void (*func)(struct rcu_head *rcu))
 EXPORT_SYMBOL_GPL(call_rcu);
 
 /*
- * Invoke all callbacks on the passed-in list.
+ * Invoke the callbacks at the head of the passed-in list, at most
+ * rcu_cb_limit of them, leaving the rest on the list.  Accounts them
+ * to q, whose list it may be.
  */
-static void rcu_invoke_callbacks(struct rcu_list *pending)
+static void rcu_invoke_callbacks(struct rcu_list *pending, struct rcu_cbq *q)
 {
 	struct rcu_head *curr, *next;
+	int limit = ACCESS_ONCE(rcu_cb_limit);
+	unsigned n = 0;
+	ktime_t start;
+	u64 ns;
 
-	for (curr = pending->head; curr;) {
+	start = ktime_get();
+	for (curr = pending->head; curr && (!limit || n < limit);) {
 		next = curr->next;
 		curr->func(curr);
 		curr = next;
-		rcu_stats.ninvoked++;
+		n++;
 		atomic_dec(&rcu_stats.nleft);
 	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (curr) {
+		pending->head = curr;
+		pending->count -= n;
+		q->nlimited++;
+	} else
+		rcu_list_init(pending);
+
+	if (n > q->max_cbs)
+		q->max_cbs = n;
+	if (ns > q->max_ns)
+		q->max_ns = ns;
+
+	smp_wmb(); /* callbacks done before they are seen to be */
+	q->ndone += n;
+	smp_mb();
+	if (waitqueue_active(&rcu_barrier_wq))
+		wake_up(&rcu_barrier_wq);
+}
+
+/*
+ * Hand a batch of callbacks of this cpu over to its offload thread.
+ * Returns 0 if there is no such thread, the caller must invoke them.
+ */
+static int rcu_offload_callbacks(struct rcu_data *rd, struct rcu_list *plist)
+{
+	if (!rcu_offload || !rd->offload_task)
+		return 0;
+
+	spin_lock(&rd->offload_lock);
+	rcu_list_join(&rd->offload.list, plist);
+	rd->offload.nqueued += plist->count;
+	spin_unlock(&rd->offload_lock);
+
+	wake_up_process(rd->offload_task);
+	return 1;
 }
 
 /*
@@ -296,15 +429,17 @@ static void rcu_invoke_callbacks(struct rcu_list *pending)
  *
  * "Quiescent" means the owning cpu is no longer appending callbacks
  * and has completed execution of a trailing write-memory-barrier insn.
+ *
+ * Returns 1 if the batch was ended.
  */
-static void __rcu_delimit_batches(struct rcu_list *pending)
+static int __rcu_delimit_batches(struct rcu_list *pending, int expedited)
 {
 	struct rcu_data *rd;
 	struct rcu_list *plist;
 	int cpu, eob, prev;
 
 	if (!rcu_scheduler_active)
-		return;
+		return 0;
 
 	rcu_stats.nlast++;
 
@@ -314,7 +449,7 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
 	if (rcu_nmi_seen) {
 		rcu_nmi_seen = 0;
 		rcu_stats.nmis++;
-		return;
+		return 0;
 	}
 
 	/*
@@ -338,6 +473,8 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
 	 * CPUs if enough time has passed.
 	 */
 	if (eob == 0) {
+		if (expedited)
+			return 0;
 		if (rcu_wdog_ctr >= rcu_wdog_lim) {
 			rcu_wdog_ctr = 0;
 			rcu_stats.nforced++;
@@ -347,7 +484,7 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
 			}
 		}
 		rcu_wdog_ctr += rcu_hz_period_us;
-		return;
+		return 0;
 	}
 
 	/*
@@ -369,7 +506,8 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
 		plist = &rd->cblist[prev];
 		/* Chain previous batch of callbacks, if any, to the pending list */
 		if (plist->head) {
-			rcu_list_join(pending, plist);
+			if (!rcu_offload_callbacks(rd, plist))
+				rcu_list_join(pending, plist);
 			rcu_list_init(plist);
 		}
 		if (cpu_online(cpu)) /* wins race with offlining every time */
@@ -391,26 +529,138 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
 	rcu_stats.nbatches++;
 	rcu_stats.nlast = 0;
 	rcu_wdog_ctr = 0;
+	return 1;
 }
 
-static void rcu_delimit_batches(void)
+static void rcu_expedite_ipi(void *unused)
+{
+	smp_mb(); /* done appending callbacks, and sees the new rcu_which */
+	if (rcu_data[smp_processor_id()].wait)
+		set_need_resched();
+}
+
+/*
+ * One pass, periodic or expedited.  Passes are serialized by
+ * rcu_delimit_lock, which also covers the ready list.
+ */
+static int rcu_pass(int expedited)
 {
 	unsigned long flags;
 	struct rcu_list pending;
+	int eob;
 
 	rcu_list_init(&pending);
 	rcu_stats.npasses++;
 
 	raw_local_irq_save(flags);
 	smp_rmb();
-	__rcu_delimit_batches(&pending);
+	eob = __rcu_delimit_batches(&pending, expedited);
 	smp_wmb();
 	raw_local_irq_restore(flags);
 
-	if (pending.head)
-		rcu_invoke_callbacks(&pending);
+	/*
+	 * An expedited batch end is not followed by an RCU_HZ period
+	 * before the next pass, make the previous batch quiescent now.
+	 */
+	if (eob && expedited)
+		smp_call_function(rcu_expedite_ipi, NULL, 1);
+
+	/* Callbacks left over by the previous passes go first */
+	if (pending.head) {
+		rcu_list_join(&rcu_ready.list, &pending);
+		rcu_ready.nqueued += pending.count;
+	}
+	if (rcu_ready.list.head)
+		rcu_invoke_callbacks(&rcu_ready.list, &rcu_ready);
+
+	return eob;
 }
 
+static void rcu_delimit_batches(void)
+{
+	/* an expedited pass is under way, it does the job */
+	if (!spin_trylock_bh(&rcu_delimit_lock))
+		return;
+	rcu_pass(0);
+	spin_unlock_bh(&rcu_delimit_lock);
+}
+
+/*
+ * One expedited pass: IPI the cpus, so that those holding up the batch
+ * reschedule and so consent to its end, then try to end it.  The IPI
+ * also stands in for the RCU_HZ period between passes: once every cpu
+ * has taken it, none can still be appending to a list which has become
+ * the previous one.  So no pass is made if a batch ended after the IPI
+ * was sent.
+ *
+ * The IPI skips the calling cpu, and the pass runs on it with bh
+ * disabled, so each batch end leaves it waited for.  The caller may
+ * sleep and is outside any read-side section: it consents here, before
+ * every pass.
+ *
+ * Returns 1 if a batch ended since the IPI was sent.
+ */
+static int rcu_expedite(void)
+{
+	unsigned nbatches = ACCESS_ONCE(rcu_stats.nbatches);
+	int eob = 1;
+
+	rcu_note_might_resched();
+	smp_mb(); /* sample nbatches before sending the IPI */
+	smp_call_function(rcu_expedite_ipi, NULL, 1);
+
+	if (!spin_trylock_bh(&rcu_delimit_lock))
+		return 0;
+	if (rcu_stats.nbatches == nbatches) {
+		rcu_stats.nexp_passes++;
+		eob = rcu_pass(1);
+	}
+	spin_unlock_bh(&rcu_delimit_lock);
+	return eob;
+}
+
+/*
+ * Wait for an rcu-sched grace period, ending batches as fast as the cpus
+ * allow instead of at the RCU_HZ rate: the callback waited for needs two
+ * batch ends.  Costs an IPI to every cpu per attempt, so is for the rare
+ * paths which cannot sleep through a few RCU_HZ periods (module unload,
+ * network device unregistration, cgroup changes).  After
+ * rcu_expedited_tries attempts, e.g. because of a long non-preemptible
+ * section, it falls back to waiting for the periodic passes.
+ */
+void synchronize_sched_expedited(void)
+{
+	struct rcu_synchronize rcu;
+	unsigned start, backoff = 1;
+	int tries;
+
+	if (!rcu_scheduler_active)
+		return;
+
+	init_completion(&rcu.completion);
+	call_rcu(&rcu.head, wakeme_after_rcu);
+
+	start = ACCESS_ONCE(rcu_stats.nbatches);
+	for (tries = 0; tries < rcu_expedited_tries; tries++) {
+		if (try_wait_for_completion(&rcu.completion))
+			goto done;
+		/* handed to an offload thread, ending batches won't help */
+		if (rcu_offload && ACCESS_ONCE(rcu_stats.nbatches) - start > 2)
+			break;
+		if (rcu_expedite()) {
+			backoff = 1;
+			continue;
+		}
+		/* let the holdouts, and the periodic passes, get on with it */
+		udelay(backoff);
+		backoff = min(backoff * 2, (unsigned)RCU_EXPEDITE_MAX_BACKOFF_US);
+	}
+	wait_for_completion(&rcu.completion);
+done:
+	atomic_inc(&rcu_stats.nexpedited);
+}
+EXPORT_SYMBOL_GPL(synchronize_sched_expedited);
+
 /* ------------------ interrupt driver section ------------------ */
 
 /*
@@ -576,6 +826,100 @@ late_initcall(jrcud_start);
 
 #endif /* CONFIG_JRCU_DAEMON */
 
+/* ------------------ callback offload section ------------------ */
+
+/*
+ * A burst of call_rcu()s, say from a process closing thousands of files,
+ * has all of its callbacks invoked by whichever context ends the batch.
+ * rcu_cb_limit bounds the time spent doing that in one pass.  Offloading
+ * moves the invocation out of that context altogether, to one kernel
+ * thread per cpu, "jrcuc/<cpu>", invoking the callbacks posted on that
+ * cpu.  The threads are not bound to their cpu: "jrcu_offload=<cpulist>"
+ * binds them to housekeeping cpus, or they can be moved with
+ * sched_setaffinity() like any other thread.
+ */
+#include <linux/err.h>
+#include <linux/kthread.h>
+
+static int __init rcu_cb_limit_setup(char *str)
+{
+	get_option(&str, &rcu_cb_limit);
+	if (rcu_cb_limit < 0)
+		rcu_cb_limit = 0;
+	return 1;
+}
+__setup("jrcu_limit=", rcu_cb_limit_setup);
+
+static int __init rcu_offload_setup(char *str)
+{
+	if (cpulist_parse(str, &rcu_offload_cpus) < 0) {
+		pr_warn("JRCU: bad jrcu_offload= cpu list '%s'\n", str);
+		return 1;
+	}
+	rcu_offload = 1;
+	return 1;
+}
+__setup("jrcu_offload=", rcu_offload_setup);
+
+static int jrcuc_func(void *arg)
+{
+	struct rcu_data *rd = arg;
+	struct rcu_list list;
+
+	current->flags |= PF_NOFREEZE;
+
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irq(&rd->offload_lock);
+		if (!rd->offload.list.head) {
+			spin_unlock_irq(&rd->offload_lock);
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+		list = rd->offload.list;
+		rcu_list_init(&rd->offload.list);
+		spin_unlock_irq(&rd->offload_lock);
+
+		/* callbacks may expect to run in softirq context */
+		while (list.head) {
+			local_bh_disable();
+			rcu_invoke_callbacks(&list, &rd->offload);
+			local_bh_enable();
+			cond_resched();
+		}
+	}
+	return 0;
+}
+
+static __init int jrcuc_start(void)
+{
+	struct task_struct *p;
+	int cpu;
+
+	for_each_present_cpu(cpu) {
+		struct rcu_data *rd = &rcu_data[cpu];
+
+		spin_lock_init(&rd->offload_lock);
+		p = kthread_create(jrcuc_func, rd, "jrcuc/%d", cpu);
+		if (IS_ERR(p)) {
+			pr_warn("JRCU: offload thread for cpu %d not started\n",
+				cpu);
+			continue;
+		}
+		if (!cpumask_empty(&rcu_offload_cpus))
+			set_cpus_allowed_ptr(p, &rcu_offload_cpus);
+		rd->offload_task = p;
+		smp_wmb();
+		wake_up_process(p);
+	}
+
+	if (rcu_offload)
+		pr_info("JRCU: offloading callbacks to jrcuc threads\n");
+	return 0;
+}
+late_initcall(jrcuc_start);
+
 /* ------------------ debug and statistics section -------------- */
 
 #ifdef CONFIG_RCU_TRACE
@@ -585,6 +929,7 @@ late_initcall(jrcud_start);
 
 static int rcu_debugfs_show(struct seq_file *m, void *unused)
 {
+	unsigned long ndone;
 	int cpu, q;
 
 	seq_printf(m, "%14u: hz, %s\n",
@@ -592,6 +937,8 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
 		rcu_hz_precise ? "precise" : "sloppy");
 
 	seq_printf(m, "%14u: watchdog (secs)\n", rcu_wdog_lim / (int)USEC_PER_SEC);
+	seq_printf(m, "%14d: expedited passes before giving up\n",
+		rcu_expedited_tries);
 	seq_printf(m, "%14d: #secs left on watchdog\n",
 		(rcu_wdog_lim - rcu_wdog_ctr) / (int)USEC_PER_SEC);
 
@@ -601,6 +948,9 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
 	else
 		seq_printf(m, "%14s: daemon priority\n", "none, no daemon");
 #endif
+	seq_printf(m, "%14d: callback limit per pass (0 is none)\n",
+		rcu_cb_limit);
+	seq_printf(m, "%14s: callback offload\n", rcu_offload ? "on" : "off");
 
 	seq_printf(m, "\n");
 	seq_printf(m, "%14u: #passes\n",
@@ -621,10 +971,25 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
 		atomic_read(&rcu_stats.nbarriers));
 	seq_printf(m, "%14u: #syncs\n",
 		atomic_read(&rcu_stats.nsyncs));
-	seq_printf(m, "%14llu: #callbacks invoked\n",
-		rcu_stats.ninvoked);
+	seq_printf(m, "%14u: #expedited syncs\n",
+		atomic_read(&rcu_stats.nexpedited));
+	seq_printf(m, "%14u: #passes made to expedite them\n",
+		rcu_stats.nexp_passes);
+	ndone = rcu_ready.ndone;
+	for_each_present_cpu(cpu)
+		ndone += rcu_data[cpu].offload.ndone;
+	seq_printf(m, "%14lu: #callbacks invoked\n",
+		ndone);
 	seq_printf(m, "%14u: #callbacks left to invoke\n",
 		atomic_read(&rcu_stats.nleft));
+	seq_printf(m, "%14d: #callbacks carried over to the next pass\n",
+		rcu_ready.list.count);
+	seq_printf(m, "%14u: #passes which hit the callback limit\n",
+		rcu_ready.nlimited);
+	seq_printf(m, "%14u: most callbacks invoked in one pass\n",
+		rcu_ready.max_cbs);
+	seq_printf(m, "%14llu: longest time invoking them (usecs)\n",
+		rcu_ready.max_ns / NSEC_PER_USEC);
 	seq_printf(m, "\n");
 
 	for_each_online_cpu(cpu)
@@ -648,9 +1013,23 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
 		}
 		seq_printf(m, "  Q%d%c\n", q, " *"[q == w]);
 	}
+	for_each_online_cpu(cpu)
+		seq_printf(m, "%4d ", rcu_data[cpu].offload.list.count);
+	seq_printf(m, "  OQ\n");
+	for_each_online_cpu(cpu)
+		seq_printf(m, "%4u ", rcu_data[cpu].offload.max_cbs);
+	seq_printf(m, "  OMAX\n");
+	for_each_online_cpu(cpu) {
+		u64 us = rcu_data[cpu].offload.max_ns / NSEC_PER_USEC;
+		seq_printf(m, "%4llu ", min_t(u64, us, 9999));
+	}
+	seq_printf(m, "  OUS\n");
 	seq_printf(m, "\nFLAGS:\n");
 	seq_printf(m, "  I - cpu idle, W - cpu waiting for end-of-batch,\n");
 	seq_printf(m, "  * - the current Q, other is the previous Q.\n");
+	seq_printf(m, "  OQ - callbacks waiting for the offload thread,\n");
+	seq_printf(m, "  OMAX, OUS - most callbacks it invoked in one go,\n");
+	seq_printf(m, "  and the longest time that took (usecs).\n");
 
 	return 0;
 }
@@ -709,6 +1088,24 @@ next:
 		if (wdog < 3 || wdog > 1000)
 			return -EINVAL;
 		rcu_wdog_lim = wdog * USEC_PER_SEC;
+	} else if (!strncmp(token, "expedite=", 9)) {
+		int tries = -1;
+		sscanf(&token[9], "%d", &tries);
+		if (tries < 0)
+			return -EINVAL;
+		rcu_expedited_tries = tries;
+	} else if (!strncmp(token, "limit=", 6)) {
+		int limit = -1;
+		sscanf(&token[6], "%d", &limit);
+		if (limit < 0)
+			return -EINVAL;
+		rcu_cb_limit = limit;
+	} else if (!strncmp(token, "offload=", 8)) {
+		int offload = -1;
+		sscanf(&token[8], "%d", &offload);
+		if (offload < 0 || offload > 1)
+			return -EINVAL;
+		rcu_offload = offload;
 	} else
 		return -EINVAL;
 	goto next;
@@ -134,6 +134,8 @@ extern int swsusp_swap_in_use(void);
  * the image header.
  */
 #define SF_PLATFORM_MODE	1
+#define SF_NOCOMPRESS_MODE	2
+#define SF_CRC32_MODE		4
 
 /* kernel/power/hibernate.c */
 extern int swsusp_check(void);
@@ -21,6 +21,8 @@
 #include <linux/wakelock.h>
 #ifdef CONFIG_WAKELOCK_STAT
 #include <linux/proc_fs.h>
+#include <linux/rculist.h>
+#include <linux/seqlock.h>
 #endif
 #include "power.h"
 
@@ -40,9 +42,16 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 #define WAKE_LOCK_AUTO_EXPIRE            (1U << 10)
 #define WAKE_LOCK_PREVENTING_SUSPEND     (1U << 11)
 
+/*
+ * Active wake locks are kept on the list of their type, the ones without a
+ * timeout first, then the ones with a timeout in the order they expire in.
+ * The ones without a timeout are counted, so that has_wake_lock_locked() only
+ * has to look at the first and last of the others.  Inactive wake locks are
+ * not on any list.
+ */
 static DEFINE_SPINLOCK(list_lock);
-static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+static int held_wake_locks[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct workqueue_struct *sync_work_queue;
@@ -52,10 +61,29 @@ suspend_state_t requested_suspend_state = PM_SUSPEND_MEM;
 static struct wake_lock unknown_wakeup;
 
 #ifdef CONFIG_WAKELOCK_STAT
+/*
+ * All the wake locks, for the stats.  Readers walk the list under RCU and
+ * copy the stats of each lock under stat_seq, which writers bump while holding
+ * list_lock, so that dumping them never keeps wake locks from being taken.
+ * wake_lock_destroy() only waits for a grace period while there are readers.
+ */
+static LIST_HEAD(all_wake_locks);
+static seqcount_t stat_seq = SEQCNT_ZERO;
+static atomic_t stat_readers = ATOMIC_INIT(0);
 static struct wake_lock deleted_wake_locks;
 static ktime_t last_sleep_time_update;
 static int wait_for_wakeup;
 
+static inline void stat_write_begin(void)
+{
+	write_seqcount_begin(&stat_seq);
+}
+
+static inline void stat_write_end(void)
+{
+	write_seqcount_end(&stat_seq);
+}
+
 int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 {
 	struct timespec ts;
@@ -83,61 +111,72 @@ int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 }
 
 
+/* Called under rcu_read_lock(), works on a consistent copy of the lock */
 static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 {
-	int lock_count = lock->stat.count;
-	int expire_count = lock->stat.expire_count;
+	struct wake_lock snap;
+	ktime_t last_update;
+	unsigned seq;
+	int lock_count;
+	int expire_count;
 	ktime_t active_time = ktime_set(0, 0);
-	ktime_t total_time = lock->stat.total_time;
-	ktime_t max_time = lock->stat.max_time;
+	ktime_t total_time;
+	ktime_t max_time;
+	ktime_t prevent_suspend_time;
 
-	ktime_t prevent_suspend_time = lock->stat.prevent_suspend_time;
-	if (lock->flags & WAKE_LOCK_ACTIVE) {
+	do {
+		seq = read_seqcount_begin(&stat_seq);
+		snap = *lock;
+		last_update = last_sleep_time_update;
+	} while (read_seqcount_retry(&stat_seq, seq));
+
+	lock_count = snap.stat.count;
+	expire_count = snap.stat.expire_count;
+	total_time = snap.stat.total_time;
+	max_time = snap.stat.max_time;
+	prevent_suspend_time = snap.stat.prevent_suspend_time;
+	if (snap.flags & WAKE_LOCK_ACTIVE) {
 		ktime_t now, add_time;
-		int expired = get_expired_time(lock, &now);
+		int expired = get_expired_time(&snap, &now);
 		if (!expired)
 			now = ktime_get();
-		add_time = ktime_sub(now, lock->stat.last_time);
+		add_time = ktime_sub(now, snap.stat.last_time);
 		lock_count++;
 		if (!expired)
 			active_time = add_time;
 		else
 			expire_count++;
 		total_time = ktime_add(total_time, add_time);
-		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND)
+		if (snap.flags & WAKE_LOCK_PREVENTING_SUSPEND)
 			prevent_suspend_time = ktime_add(prevent_suspend_time,
-					ktime_sub(now, last_sleep_time_update));
+					ktime_sub(now, last_update));
 		if (add_time.tv64 > max_time.tv64)
 			max_time = add_time;
 	}
 
 	return seq_printf(m,
 		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
-		     lock->name, lock_count, expire_count,
-		     lock->stat.wakeup_count, ktime_to_ns(active_time),
+		     snap.name, lock_count, expire_count,
+		     snap.stat.wakeup_count, ktime_to_ns(active_time),
 		     ktime_to_ns(total_time),
 		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
-		     ktime_to_ns(lock->stat.last_time));
+		     ktime_to_ns(snap.stat.last_time));
 }
 
 static int wakelock_stats_show(struct seq_file *m, void *unused)
 {
-	unsigned long irqflags;
 	struct wake_lock *lock;
 	int ret;
-	int type;
-
-	spin_lock_irqsave(&list_lock, irqflags);
 
 	ret = seq_puts(m, "name\tcount\texpire_count\twake_count\tactive_since"
 			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
-	list_for_each_entry(lock, &inactive_locks, link)
+	atomic_inc(&stat_readers);
+	smp_mb__after_atomic_inc();
+	rcu_read_lock();
+	list_for_each_entry_rcu(lock, &all_wake_locks, stat_link)
 		ret = print_lock_stat(m, lock);
-	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
-		list_for_each_entry(lock, &active_wake_locks[type], link)
-			ret = print_lock_stat(m, lock);
-	}
-	spin_unlock_irqrestore(&list_lock, irqflags);
+	rcu_read_unlock();
+	atomic_dec(&stat_readers);
 	return 0;
 }
 
@@ -192,6 +231,9 @@ static void update_sleep_wait_stats_locked(int done)
 	}
 	last_sleep_time_update = now;
 }
+#else
+static inline void stat_write_begin(void) {}
+static inline void stat_write_end(void) {}
 #endif
 
 
@@ -201,12 +243,33 @@ static void expire_wake_lock(struct wake_lock *lock)
 	wake_unlock_stat_locked(lock, 1);
 #endif
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
-	list_add(&lock->link, &inactive_locks);
+	list_del_init(&lock->link);
 	if (debug_mask & (DEBUG_WAKE_LOCK | DEBUG_EXPIRE))
 		pr_info("expired wake lock %s\n", lock->name);
 }
 
+/* Active and without a timeout, counted in held_wake_locks */
+static inline bool wake_lock_held(struct wake_lock *lock)
+{
+	return (lock->flags & (WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE)) ==
+		WAKE_LOCK_ACTIVE;
+}
+
+/* Inserts a lock with a timeout in expiry order, new ones mostly go last */
+static void add_timed_wake_lock(struct wake_lock *lock, int type)
+{
+	struct list_head *pos;
+	struct wake_lock *prev;
+
+	list_for_each_prev(pos, &active_wake_locks[type]) {
+		prev = list_entry(pos, struct wake_lock, link);
+		if (!(prev->flags & WAKE_LOCK_AUTO_EXPIRE) ||
+		    (long)(lock->expires - prev->expires) >= 0)
+			break;
+	}
+	list_add(&lock->link, pos);
+}
+
 /* Caller must acquire the list_lock spinlock */
 static void print_active_locks(int type)
 {
@@ -233,20 +296,21 @@ static void print_active_locks(int type)
 static long has_wake_lock_locked(int type)
 {
 	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	unsigned long now = jiffies;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
+	if (held_wake_locks[type])
+		return -1;
+	/* Only locks with a timeout left, the first ones to expire first */
 	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+		if ((long)(lock->expires - now) > 0)
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	if (list_empty(&active_wake_locks[type]))
+		return 0;
+	lock = list_entry(active_wake_locks[type].prev, struct wake_lock, link);
+	return lock->expires - now;
 }
 
 long has_wake_lock(int type)
@@ -254,12 +318,15 @@ long has_wake_lock(int type)
 	long ret;
 	unsigned long irqflags;
 	spin_lock_irqsave(&list_lock, irqflags);
+	stat_write_begin();
 	ret = has_wake_lock_locked(type);
+	stat_write_end();
 	if (ret && (debug_mask & DEBUG_SUSPEND) && type == WAKE_LOCK_SUSPEND)
 		print_active_locks(type);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 	return ret;
 }
+EXPORT_SYMBOL(has_wake_lock);
 
 static void suspend(struct work_struct *work)
 {
@@ -304,7 +371,9 @@ static void expire_wake_locks(unsigned long data)
 	spin_lock_irqsave(&list_lock, irqflags);
 	if (debug_mask & DEBUG_SUSPEND)
 		print_active_locks(WAKE_LOCK_SUSPEND);
+	stat_write_begin();
 	has_lock = has_wake_lock_locked(WAKE_LOCK_SUSPEND);
+	stat_write_end();
 	if (debug_mask & DEBUG_EXPIRE)
 		pr_info("expire_wake_locks: done, has_lock %ld\n", has_lock);
 	if (has_lock == 0)
@@ -338,7 +407,9 @@ static struct platform_device power_device = {
 
 void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 {
-	unsigned long irqflags = 0;
+#ifdef CONFIG_WAKELOCK_STAT
+	unsigned long irqflags;
+#endif
 
 	if (name)
 		lock->name = name;
@@ -358,18 +429,25 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
 	INIT_LIST_HEAD(&lock->link);
+#ifdef CONFIG_WAKELOCK_STAT
 	spin_lock_irqsave(&list_lock, irqflags);
-	list_add(&lock->link, &inactive_locks);
+	list_add_tail_rcu(&lock->stat_link, &all_wake_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
+#endif
 }
 EXPORT_SYMBOL(wake_lock_init);
 
 void wake_lock_destroy(struct wake_lock *lock)
 {
 	unsigned long irqflags;
+
+	might_sleep();
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
+	stat_write_begin();
+	if (wake_lock_held(lock))
+		held_wake_locks[lock->flags & WAKE_LOCK_TYPE_MASK]--;
 	lock->flags &= ~WAKE_LOCK_INITIALIZED;
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
@@ -385,9 +463,20 @@ void wake_lock_destroy(struct wake_lock *lock)
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
 	}
+	list_del_rcu(&lock->stat_link);
 #endif
-	list_del(&lock->link);
+	list_del_init(&lock->link);
+	stat_write_end();
 	spin_unlock_irqrestore(&list_lock, irqflags);
+#ifdef CONFIG_WAKELOCK_STAT
+	/*
+	 * A reader either was counted by now, or will not find the lock on the
+	 * list: only the counted ones may still be looking at it.
+	 */
+	smp_mb();
+	if (atomic_read(&stat_readers))
+		synchronize_rcu();
+#endif
 }
 EXPORT_SYMBOL(wake_lock_destroy);
 
@@ -399,6 +488,7 @@ static void wake_lock_internal(
 	long expire_in;
 
 	spin_lock_irqsave(&list_lock, irqflags);
+	stat_write_begin();
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
 	BUG_ON(!(lock->flags & WAKE_LOCK_INITIALIZED));
@@ -420,6 +510,8 @@ static void wake_lock_internal(
 #ifdef CONFIG_WAKELOCK_STAT
 		lock->stat.last_time = ktime_get();
 #endif
+	} else if (wake_lock_held(lock)) {
+		held_wake_locks[type]--;
 	}
 	list_del(&lock->link);
 	if (has_timeout) {
@@ -429,12 +521,13 @@ static void wake_lock_internal(
 				(timeout % HZ) * MSEC_PER_SEC / HZ);
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
-		list_add_tail(&lock->link, &active_wake_locks[type]);
+		add_timed_wake_lock(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
+		held_wake_locks[type]++;
 		list_add(&lock->link, &active_wake_locks[type]);
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
@@ -463,6 +556,7 @@ static void wake_lock_internal(
 				queue_work(suspend_work_queue, &suspend_work);
 		}
 	}
+	stat_write_end();
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
@@ -483,15 +577,17 @@ void wake_unlock(struct wake_lock *lock)
 	int type;
 	unsigned long irqflags;
 	spin_lock_irqsave(&list_lock, irqflags);
+	stat_write_begin();
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 0);
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	if (wake_lock_held(lock))
+		held_wake_locks[type]--;
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
-	list_add(&lock->link, &inactive_locks);
+	list_del_init(&lock->link);
 	if (type == WAKE_LOCK_SUSPEND) {
 		long has_lock = has_wake_lock_locked(type);
 		if (has_lock > 0) {
@@ -515,6 +611,7 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 		}
 	}
+	stat_write_end();
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_unlock);
@@ -525,6 +622,7 @@ int wake_lock_active(struct wake_lock *lock)
 }
 EXPORT_SYMBOL(wake_lock_active);
 
+#ifdef CONFIG_WAKELOCK_STAT
 static int wakelock_stats_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, wakelock_stats_show, NULL);
@@ -537,6 +635,7 @@ static const struct file_operations wakelock_stats_fops = {
 	.llseek = seq_lseek,
 	.release = single_release,
 };
+#endif
 
 static int __init wakelocks_init(void)
 {
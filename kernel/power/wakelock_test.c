@@ -0,0 +1,215 @@
+/* kernel/power/wakelock_test.c
+ *
+ * Stress test for wake locks.  Threads take and release thousands of wake
+ * locks, with and without timeouts, each thread working on its own share of
+ * them.  After every operation the thread checks that has_wake_lock() agrees
+ * with the locks it holds, and times it.  The results are printed when the
+ * module is removed.  Reading /proc/wakelocks while it runs exercises the
+ * stats as well.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/wakelock.h>
+
+static int nr_locks = 4096;
+module_param(nr_locks, int, 0444);
+MODULE_PARM_DESC(nr_locks, "Number of wake locks to use");
+static int nthreads;
+module_param(nthreads, int, 0444);
+MODULE_PARM_DESC(nthreads, "Number of threads (default: one per cpu)");
+static int lock_type = WAKE_LOCK_SUSPEND;
+module_param(lock_type, int, 0444);
+MODULE_PARM_DESC(lock_type, "Type of the wake locks (0: suspend, 1: idle)");
+static int untimed_pct = 10;
+module_param(untimed_pct, int, 0444);
+MODULE_PARM_DESC(untimed_pct, "Percentage of locks taken without a timeout");
+static int max_timeout = HZ;
+module_param(max_timeout, int, 0444);
+MODULE_PARM_DESC(max_timeout, "Longest timeout of the other locks (jiffies)");
+
+#define NAME_LEN	24
+
+struct test_thread {
+	struct task_struct *task;
+	struct wake_lock *locks;
+	unsigned long *held;	/* taken without a timeout */
+	int nr;
+	int nr_held;
+	unsigned long ops;
+	unsigned long errors;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+static struct wake_lock *locks;
+static char (*names)[NAME_LEN];
+static struct test_thread *threads;
+
+static void test_op(struct test_thread *t)
+{
+	u32 rnd = random32();
+	int i = rnd % t->nr;
+	int op = (rnd >> 16) % 100;
+	ktime_t start;
+	long ret;
+	u64 ns;
+
+	if (op < untimed_pct) {
+		wake_lock(&t->locks[i]);
+		if (!test_and_set_bit(i, t->held))
+			t->nr_held++;
+	} else {
+		/* the others are taken with a timeout or released evenly */
+		if (op < (100 + untimed_pct) / 2)
+			wake_lock_timeout(&t->locks[i],
+					  1 + random32() % max_timeout);
+		else
+			wake_unlock(&t->locks[i]);
+		if (test_and_clear_bit(i, t->held))
+			t->nr_held--;
+	}
+
+	start = ktime_get();
+	ret = has_wake_lock(lock_type);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	t->total_ns += ns;
+	if (ns > t->max_ns)
+		t->max_ns = ns;
+	if (t->nr_held && ret != -1)
+		t->errors++;
+	if (test_bit(i, t->held) && !wake_lock_active(&t->locks[i]))
+		t->errors++;
+	t->ops++;
+}
+
+static int wakelock_test_thread(void *arg)
+{
+	struct test_thread *t = arg;
+	int i;
+
+	/* Start out holding all of them */
+	for (i = 0; i < t->nr; i++)
+		wake_lock_timeout(&t->locks[i], 1 + random32() % max_timeout);
+
+	while (!kthread_should_stop()) {
+		test_op(t);
+		if (!(t->ops % 256))
+			cond_resched();
+	}
+
+	for (i = 0; i < t->nr; i++)
+		wake_unlock(&t->locks[i]);
+	return 0;
+}
+
+static void wakelock_test_cleanup(void)
+{
+	unsigned long ops = 0, errors = 0;
+	u64 total_ns = 0, max_ns = 0;
+	int i;
+
+	for (i = 0; i < nthreads; i++) {
+		struct test_thread *t = &threads[i];
+
+		if (t->task)
+			kthread_stop(t->task);
+		kfree(t->held);
+		ops += t->ops;
+		errors += t->errors;
+		total_ns += t->total_ns;
+		if (t->max_ns > max_ns)
+			max_ns = t->max_ns;
+	}
+	for (i = 0; i < nr_locks; i++)
+		wake_lock_destroy(&locks[i]);
+
+	pr_info("wakelock_test: %d locks, %d threads, %lu ops, "
+		"has_wake_lock avg %llu ns max %llu ns, %lu errors\n",
+		nr_locks, nthreads, ops,
+		ops ? div64_u64(total_ns, ops) : 0ULL, max_ns, errors);
+
+	kfree(threads);
+	kfree(names);
+	kfree(locks);
+}
+
+static int __init wakelock_test_init(void)
+{
+	int i, per_thread;
+
+	if (nr_locks <= 0 || nthreads < 0 || lock_type < 0 ||
+	    lock_type >= WAKE_LOCK_TYPE_COUNT || untimed_pct < 0 ||
+	    untimed_pct > 100 || max_timeout <= 0)
+		return -EINVAL;
+	if (!nthreads)
+		nthreads = num_online_cpus();
+	if (nthreads > nr_locks)
+		nthreads = nr_locks;
+
+	locks = kcalloc(nr_locks, sizeof(*locks), GFP_KERNEL);
+	names = kcalloc(nr_locks, NAME_LEN, GFP_KERNEL);
+	threads = kcalloc(nthreads, sizeof(*threads), GFP_KERNEL);
+	if (!locks || !names || !threads)
+		goto err_alloc;
+
+	for (i = 0; i < nr_locks; i++) {
+		snprintf(names[i], NAME_LEN, "wakelock_test%d", i);
+		wake_lock_init(&locks[i], lock_type, names[i]);
+	}
+
+	per_thread = nr_locks / nthreads;
+	for (i = 0; i < nthreads; i++) {
+		struct test_thread *t = &threads[i];
+
+		t->locks = &locks[i * per_thread];
+		t->nr = i == nthreads - 1 ? nr_locks - i * per_thread :
+					      per_thread;
+		t->held = kcalloc(BITS_TO_LONGS(t->nr), sizeof(long),
+				  GFP_KERNEL);
+		if (!t->held)
+			goto err;
+	}
+	for (i = 0; i < nthreads; i++) {
+		struct task_struct *task;
+
+		task = kthread_run(wakelock_test_thread, &threads[i],
+				   "wakelock_test/%d", i);
+		if (IS_ERR(task))
+			goto err;
+		threads[i].task = task;
+	}
+	return 0;
+
+err:
+	wakelock_test_cleanup();
+	return -ENOMEM;
+err_alloc:
+	kfree(threads);
+	kfree(names);
+	kfree(locks);
+	return -ENOMEM;
+}
+
+static void __exit wakelock_test_exit(void)
+{
+	wakelock_test_cleanup();
+}
+
+module_init(wakelock_test_init);
+module_exit(wakelock_test_exit);
+MODULE_LICENSE("GPL");
@@ -46,6 +46,7 @@
 #include <linux/stat.h>
 #include <linux/srcu.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <asm/byteorder.h>
 #include <linux/sched.h>
 
@@ -68,6 +69,8 @@ static int fqs_stutter = 3;	/* Wait time between bursts (s). */
 static int test_boost = 1;	/* Test RCU prio boost: 0=no, 1=maybe, 2=yes. */
 static int test_boost_interval = 7; /* Interval between boost tests, seconds. */
 static int test_boost_duration = 4; /* Duration of each boost test, seconds. */
+static int cbflood_n;		/* Callbacks per flood, 0 to disable. */
+static int cbflood_interval = 3; /* Interval between floods (s). */
 static char *torture_type = "rcu"; /* What RCU implementation to torture. */
 
 module_param(nreaders, int, 0444);
@@ -98,6 +101,10 @@ module_param(test_boost_interval, int, 0444);
 MODULE_PARM_DESC(test_boost_interval, "Interval between boost tests, seconds.");
 module_param(test_boost_duration, int, 0444);
 MODULE_PARM_DESC(test_boost_duration, "Duration of each boost test, seconds.");
+module_param(cbflood_n, int, 0444);
+MODULE_PARM_DESC(cbflood_n, "Number of callbacks per flood, 0 to disable");
+module_param(cbflood_interval, int, 0444);
+MODULE_PARM_DESC(cbflood_interval, "Interval between callback floods (s)");
 module_param(torture_type, charp, 0444);
 MODULE_PARM_DESC(torture_type, "Type of RCU to torture (rcu, rcu_bh, srcu)");
 
@@ -119,6 +126,7 @@ static struct task_struct *stats_task;
 static struct task_struct *shuffler_task;
 static struct task_struct *stutter_task;
 static struct task_struct *fqs_task;
+static struct task_struct *cbflood_task;
 static struct task_struct *boost_tasks[NR_CPUS];
 
 #define RCU_TORTURE_PIPE_LEN 10
@@ -299,6 +307,7 @@ struct rcu_torture_ops {
 	void (*readunlock)(int idx);
 	int (*completed)(void);
 	void (*deferred_free)(struct rcu_torture *p);
+	void (*call)(struct rcu_head *head, void (*func)(struct rcu_head *rcu));
 	void (*sync)(void);
 	void (*cb_barrier)(void);
 	void (*fqs)(void);
@@ -385,6 +394,7 @@ static struct rcu_torture_ops rcu_ops = {
 	.readunlock	= rcu_torture_read_unlock,
 	.completed	= rcu_torture_completed,
 	.deferred_free	= rcu_torture_deferred_free,
+	.call		= call_rcu,
 	.sync		= synchronize_rcu,
 	.cb_barrier	= rcu_barrier,
 	.fqs		= rcu_force_quiescent_state,
@@ -511,6 +521,7 @@ static struct rcu_torture_ops rcu_bh_ops = {
 	.readunlock	= rcu_bh_torture_read_unlock,
 	.completed	= rcu_bh_torture_completed,
 	.deferred_free	= rcu_bh_torture_deferred_free,
+	.call		= call_rcu_bh,
 	.sync		= rcu_bh_torture_synchronize,
 	.cb_barrier	= rcu_barrier_bh,
 	.fqs		= rcu_bh_force_quiescent_state,
@@ -669,6 +680,7 @@ static struct rcu_torture_ops sched_ops = {
 	.readunlock	= sched_torture_read_unlock,
 	.completed	= rcu_no_completed,
 	.deferred_free	= rcu_sched_torture_deferred_free,
+	.call		= call_rcu_sched,
 	.sync		= sched_torture_synchronize,
 	.cb_barrier	= rcu_barrier_sched,
 	.fqs		= rcu_sched_force_quiescent_state,
@@ -844,6 +856,64 @@ rcu_torture_fqs(void *arg)
 	return 0;
 }
 
+/*
+ * RCU torture callback-flood kthread.  Every cbflood_interval seconds,
+ * posts cbflood_n callbacks at once, the way closing a great many files
+ * does, then waits for them with ->cb_barrier() and checks that every
+ * one of them was invoked.  The time each flood took to drain is kept,
+ * the longest is in the statistics.
+ */
+static atomic_t n_cbflood_invoked;
+static long n_cbflood_floods;
+static long n_cbflood_errors;
+static unsigned long cbflood_max_ms;
+
+static void rcu_torture_cbflood_cb(struct rcu_head *rhp)
+{
+	atomic_inc(&n_cbflood_invoked);
+}
+
+static int
+rcu_torture_cbflood(void *arg)
+{
+	struct rcu_head *rhp;
+	unsigned long start, ms;
+	int i;
+
+	VERBOSE_PRINTK_STRING("rcu_torture_cbflood task started");
+	rhp = vmalloc(sizeof(*rhp) * cbflood_n);
+	if (rhp == NULL) {
+		VERBOSE_PRINTK_ERRSTRING("out of memory");
+		n_cbflood_errors++;
+		atomic_inc(&n_rcu_torture_error);
+		goto out;
+	}
+	do {
+		schedule_timeout_interruptible(cbflood_interval * HZ);
+		atomic_set(&n_cbflood_invoked, 0);
+		start = jiffies;
+		for (i = 0; i < cbflood_n; i++)
+			cur_ops->call(&rhp[i], rcu_torture_cbflood_cb);
+		cur_ops->cb_barrier();
+		ms = jiffies_to_msecs(jiffies - start);
+		if (atomic_read(&n_cbflood_invoked) != cbflood_n) {
+			n_cbflood_errors++;
+			atomic_inc(&n_rcu_torture_error);
+		}
+		n_cbflood_floods++;
+		if (ms > cbflood_max_ms)
+			cbflood_max_ms = ms;
+		rcu_stutter_wait("rcu_torture_cbflood");
+	} while (!kthread_should_stop() && fullstop == FULLSTOP_DONTSTOP);
+	vfree(rhp);
+out:
+	VERBOSE_PRINTK_STRING("rcu_torture_cbflood task stopping");
+	rcutorture_shutdown_absorb("rcu_torture_cbflood");
+	while (!kthread_should_stop())
+		schedule_timeout_uninterruptible(1);
+	return 0;
+}
+
 /*
  * RCU torture writer kthread.  Repeatedly substitutes a new structure
  * for that pointed to by rcu_torture_current, freeing the old structure
@@ -896,10 +966,17 @@ rcu_torture_writer(void *arg)
  * RCU torture fake writer kthread.  Repeatedly calls sync, with a random
  * delay between calls.
  */
+static DEFINE_SPINLOCK(rcu_torture_sync_lock);
+static long n_rcu_torture_syncs;
+static u64 rcu_torture_sync_ns;		/* Total time spent in ->sync(). */
+static u64 rcu_torture_sync_max_ns;
+
 static int
 rcu_torture_fakewriter(void *arg)
 {
 	DEFINE_RCU_RANDOM(rand);
+	ktime_t start;
+	u64 ns;
 
 	VERBOSE_PRINTK_STRING("rcu_torture_fakewriter task started");
 	set_user_nice(current, 19);
@@ -907,7 +984,15 @@ rcu_torture_fakewriter(void *arg)
 	do {
 		schedule_timeout_uninterruptible(1 + rcu_random(&rand)%10);
 		udelay(rcu_random(&rand) & 0x3ff);
+		start = ktime_get();
 		cur_ops->sync();
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		spin_lock(&rcu_torture_sync_lock);
+		n_rcu_torture_syncs++;
+		rcu_torture_sync_ns += ns;
+		if (ns > rcu_torture_sync_max_ns)
+			rcu_torture_sync_max_ns = ns;
+		spin_unlock(&rcu_torture_sync_lock);
 		rcu_stutter_wait("rcu_torture_fakewriter");
 	} while (!kthread_should_stop() && fullstop == FULLSTOP_DONTSTOP);
 
@@ -1104,6 +1189,25 @@ rcu_torture_printk(char *page)
 		cnt += sprintf(&page[cnt], " %d",
 			       atomic_read(&rcu_torture_wcount[i]));
 	}
+	if (n_rcu_torture_syncs) {
+		cnt += sprintf(&page[cnt], "\n%s%s ", torture_type,
+			       TORTURE_FLAG);
+		cnt += sprintf(&page[cnt], "Sync latency: %ld syncs "
+			       "avg: %llu us max: %llu us", n_rcu_torture_syncs,
+			       div_u64(div64_u64(rcu_torture_sync_ns,
+						 n_rcu_torture_syncs),
+				       NSEC_PER_USEC),
+			       div_u64(rcu_torture_sync_max_ns, NSEC_PER_USEC));
+	}
+	if (cbflood_n) {
+		cnt += sprintf(&page[cnt], "\n%s%s ", torture_type,
+			       TORTURE_FLAG);
+		cnt += sprintf(&page[cnt], "Callback floods: %ld errors: %ld "
+			       "max drain: %lu ms", n_cbflood_floods,
+			       n_cbflood_errors, cbflood_max_ms);
+		if (n_cbflood_errors != 0)
+			cnt += sprintf(&page[cnt], " !!!");
+	}
 	cnt += sprintf(&page[cnt], "\n");
 	if (cur_ops->stats)
 		cnt += cur_ops->stats(&page[cnt]);
@@ -1243,12 +1347,13 @@ rcu_torture_print_module_parms(struct rcu_torture_ops *cur_ops, char *tag)
 		"shuffle_interval=%d stutter=%d irqreader=%d "
 		"fqs_duration=%d fqs_holdoff=%d fqs_stutter=%d "
 		"test_boost=%d/%d test_boost_interval=%d "
-		"test_boost_duration=%d\n",
+		"test_boost_duration=%d cbflood_n=%d cbflood_interval=%d\n",
 		torture_type, tag, nrealreaders, nfakewriters,
 		stat_interval, verbose, test_no_idle_hz, shuffle_interval,
 		stutter, irqreader, fqs_duration, fqs_holdoff, fqs_stutter,
 		test_boost, cur_ops->can_boost,
-		test_boost_interval, test_boost_duration);
+		test_boost_interval, test_boost_duration,
+		cbflood_n, cbflood_interval);
 }
 
 static struct notifier_block rcutorture_shutdown_nb = {
@@ -1394,6 +1499,12 @@ rcu_torture_cleanup(void)
 		kthread_stop(fqs_task);
 	}
 	fqs_task = NULL;
+
+	if (cbflood_task) {
+		VERBOSE_PRINTK_STRING("Stopping rcu_torture_cbflood task");
+		kthread_stop(cbflood_task);
+	}
+	cbflood_task = NULL;
 	if ((test_boost == 1 && cur_ops->can_boost) ||
 	    test_boost == 2) {
 		unregister_cpu_notifier(&rcutorture_cpu_nb);
@@ -1451,6 +1562,12 @@ rcu_torture_init(void)
 				  "fqs_duration, fqs disabled.\n");
 		fqs_duration = 0;
 	}
+	if ((cur_ops->call == NULL || cur_ops->cb_barrier == NULL) &&
+	    cbflood_n != 0) {
+		printk(KERN_ALERT "rcu-torture: ->call or ->cb_barrier NULL "
+				  "and non-zero cbflood_n, cbflood disabled.\n");
+		cbflood_n = 0;
+	}
 	if (cur_ops->init)
 		cur_ops->init(); /* no "goto unwind" prior to this point!!! */
 
@@ -1598,6 +1715,21 @@ rcu_torture_init(void)
 			goto unwind;
 		}
 	}
+	if (cbflood_n < 0)
+		cbflood_n = 0;
+	if (cbflood_interval < 1)
+		cbflood_interval = 1;
+	if (cbflood_n) {
+		/* Create the callback-flood thread */
+		cbflood_task = kthread_run(rcu_torture_cbflood, NULL,
+					   "rcu_torture_cbflood");
+		if (IS_ERR(cbflood_task)) {
+			firsterr = PTR_ERR(cbflood_task);
+			VERBOSE_PRINTK_ERRSTRING("Failed to create cbflood");
+			cbflood_task = NULL;
+			goto unwind;
+		}
+	}
 	if (test_boost_interval < 1)
 		test_boost_interval = 1;
 	if (test_boost_duration < 2)
@@ -245,6 +245,32 @@ struct cfs_rq;
 
 static LIST_HEAD(task_groups);
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * The cpu time a group's tasks may use per period, over all cpus: the
+ * cfs_rqs of the group take it from the pool in slices, and get throttled
+ * when there is none left until the period timer refills it.
+ */
+struct cfs_bandwidth {
+	/* nests inside the rq lock: */
+	raw_spinlock_t		lock;
+	ktime_t			period;
+	u64			quota;
+	u64			runtime;
+	/* bumped on each refill, so that slices from before expire */
+	unsigned int		gen;
+	int			idle;
+	int			timer_active;
+	struct hrtimer		period_timer;
+	struct list_head	throttled_cfs_rq;
+
+	/* statistics */
+	int			nr_periods;
+	int			nr_throttled;
+	u64			throttled_time;
+};
+#endif
+
 /* task group related information */
 struct task_group {
 	struct cgroup_subsys_state css;
@@ -255,6 +281,10 @@ struct task_group {
 	/* runqueue "owned" by this group on each cpu */
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
+
+#ifdef CONFIG_CFS_BANDWIDTH
+	struct cfs_bandwidth cfs_bandwidth;
+#endif
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -313,12 +343,97 @@ static int init_task_group_load = INIT_TASK_GROUP_LOAD;
  */
 struct task_group init_task_group;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun);
+
+static enum hrtimer_restart sched_cfs_period_timer(struct hrtimer *timer)
+{
+	struct cfs_bandwidth *cfs_b =
+		container_of(timer, struct cfs_bandwidth, period_timer);
+	ktime_t now;
+	int overrun;
+	int idle = 0;
+
+	for (;;) {
+		now = hrtimer_cb_get_time(timer);
+		overrun = hrtimer_forward(timer, now, cfs_b->period);
+
+		if (!overrun)
+			break;
+
+		idle = do_sched_cfs_period_timer(cfs_b, overrun);
+	}
+
+	return idle ? HRTIMER_NORESTART : HRTIMER_RESTART;
+}
+
+static void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	raw_spin_lock_init(&cfs_b->lock);
+	cfs_b->runtime = 0;
+	cfs_b->quota = RUNTIME_INF;
+	cfs_b->period = ns_to_ktime(NSEC_PER_SEC / 10);
+
+	INIT_LIST_HEAD(&cfs_b->throttled_cfs_rq);
+	hrtimer_init(&cfs_b->period_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cfs_b->period_timer.function = sched_cfs_period_timer;
+}
+
+/*
+ * Starts the period timer of a group which had it stopped when idle, with
+ * a full pool.  Called with cfs_b->lock held.
+ */
+static void __start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	ktime_t now;
+
+	/*
+	 * The callback may be on its way out after finding the group idle:
+	 * wait for it to return, letting it take the lock meanwhile.  It
+	 * does not take any rq lock on that way.
+	 */
+	while (unlikely(hrtimer_active(&cfs_b->period_timer))) {
+		raw_spin_unlock(&cfs_b->lock);
+		cpu_relax();
+		raw_spin_lock(&cfs_b->lock);
+		if (cfs_b->timer_active)
+			return;
+	}
+
+	cfs_b->timer_active = 1;
+	cfs_b->runtime = cfs_b->quota;
+	cfs_b->gen++;
+
+	for (;;) {
+		unsigned long delta;
+		ktime_t soft, hard;
+
+		if (hrtimer_active(&cfs_b->period_timer))
+			break;
+
+		now = hrtimer_cb_get_time(&cfs_b->period_timer);
+		hrtimer_forward(&cfs_b->period_timer, now, cfs_b->period);
+
+		soft = hrtimer_get_softexpires(&cfs_b->period_timer);
+		hard = hrtimer_get_expires(&cfs_b->period_timer);
+		delta = ktime_to_ns(ktime_sub(hard, soft));
+		__hrtimer_start_range_ns(&cfs_b->period_timer, soft, delta,
+				HRTIMER_MODE_ABS_PINNED, 0);
+	}
+}
+
+static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	hrtimer_cancel(&cfs_b->period_timer);
+}
+#endif
+
 #endif	/* CONFIG_CGROUP_SCHED */
 
 /* CFS-related fields in a runqueue */
 struct cfs_rq {
 	struct load_weight load;
-	unsigned long nr_running;
+	unsigned long nr_running, h_nr_running;
 
 	u64 exec_clock;
 	u64 min_vruntime;
@@ -337,6 +452,9 @@ struct cfs_rq {
 
 	unsigned int nr_spread_over;
 
+	/* time spent running entities of this cfs_rq, see struct sched_avg */
+	struct sched_avg avg;
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	struct rq *rq;	/* cpu runqueue to which this cfs_rq is attached */
 
@@ -351,6 +469,18 @@ struct cfs_rq {
 	struct list_head leaf_cfs_rq_list;
 	struct task_group *tg;	/* group that "owns" this runqueue */
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	/* runtime taken from the group's pool and not used yet */
+	int runtime_enabled;
+	unsigned int runtime_gen;
+	s64 runtime_remaining;
+
+	/* off the parent's queue for the rest of the period */
+	int throttled;
+	u64 throttled_timestamp;
+	struct list_head throttled_list;
+#endif
+
 #ifdef CONFIG_SMP
 	/*
 	 * the part of load.weight contributed by tasks
@@ -524,6 +654,9 @@ struct rq {
 	u64 age_stamp;
 	u64 idle_stamp;
 	u64 avg_idle;
+
+	/* exit latency of the cpuidle state the cpu is in, in usecs */
+	unsigned int idle_exit_latency;
 #endif
 
 	/* calc_load related fields */
@@ -1881,6 +2014,108 @@ static const struct sched_class rt_sched_class;
 
 #include "sched_stats.h"
 
+#ifdef CONFIG_CPU_FREQ
+static DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_set_update_util_data - hook a governor to scheduler updates
+ * @cpu: the cpu whose utilization updates are wanted
+ * @data: the callback, or NULL to unhook
+ *
+ * The callback is called under the runqueue lock of @cpu, with interrupts
+ * disabled, and not necessarily from @cpu itself: it must not sleep nor
+ * wake up tasks.  Once it is unhooked, synchronize_sched() waits for the
+ * callers still running it.
+ */
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data)
+{
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_set_update_util_data);
+
+static ATOMIC_NOTIFIER_HEAD(sched_boost_notifier_list);
+
+/* How long boosts last for, in jiffies, as set by the governor using them */
+static unsigned long sched_boost_lifetime;
+
+/**
+ * sched_set_boost_lifetime - set how long a boost lasts after its input
+ * @lifetime: in jiffies, 0 if boosts are not used
+ *
+ * Older stamps are not passed on by task_boost_stamp().
+ */
+void sched_set_boost_lifetime(unsigned long lifetime)
+{
+	sched_boost_lifetime = lifetime;
+}
+EXPORT_SYMBOL_GPL(sched_set_boost_lifetime);
+
+/**
+ * task_boost_stamp - stamp of the input a task handles, to be passed on
+ * @p: the task
+ *
+ * Returns 0 if @p handles no input, or if the boost of that input is over.
+ */
+unsigned long task_boost_stamp(struct task_struct *p)
+{
+	unsigned long stamp = p->boost_stamp;
+
+	if (!stamp ||
+	    time_after_eq(jiffies, stamp + ACCESS_ONCE(sched_boost_lifetime)))
+		return 0;
+	return stamp;
+}
+EXPORT_SYMBOL_GPL(task_boost_stamp);
+
+/**
+ * sched_boost_task - tag a task as handling user input
+ * @p: the task, usually current
+ * @stamp: jiffies of the input, passed on when @p hands the work over
+ *
+ * Ignored if @p already handles more recent input.  May be called from
+ * atomic context.
+ */
+void sched_boost_task(struct task_struct *p, unsigned long stamp)
+{
+	/* 0 means no input */
+	if (!stamp)
+		stamp = 1;
+	if (p->boost_stamp && time_after_eq(p->boost_stamp, stamp))
+		return;
+
+	p->boost_stamp = stamp;
+	atomic_notifier_call_chain(&sched_boost_notifier_list, stamp, p);
+}
+EXPORT_SYMBOL_GPL(sched_boost_task);
+
+int register_sched_boost_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&sched_boost_notifier_list, nb);
+}
+EXPORT_SYMBOL_GPL(register_sched_boost_notifier);
+
+int unregister_sched_boost_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&sched_boost_notifier_list,
+						nb);
+}
+EXPORT_SYMBOL_GPL(unregister_sched_boost_notifier);
+
+static inline void cpufreq_update_util(struct rq *rq, unsigned long util)
+{
+	struct update_util_data *data;
+
+	data = rcu_dereference_sched(per_cpu(cpufreq_update_util_data,
+					     cpu_of(rq)));
+	if (data)
+		data->func(data, rq->clock, util, SCHED_LOAD_SCALE);
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq, unsigned long util)
+{
+}
+#endif
+
 static void inc_nr_running(struct rq *rq)
 {
 	rq->nr_running++;
@@ -1931,7 +2166,6 @@ static void activate_task(struct rq *rq, struct task_struct *p, int flags)
 		rq->nr_uninterruptible--;
 
 	enqueue_task(rq, p, flags);
-	inc_nr_running(rq);
 }
 
 /*
@@ -1943,7 +2177,6 @@ static void deactivate_task(struct rq *rq, struct task_struct *p, int flags)
 		rq->nr_uninterruptible++;
 
 	dequeue_task(rq, p, flags);
-	dec_nr_running(rq);
 }
 
 #include "sched_idletask.c"
@@ -2529,6 +2762,12 @@ static void __sched_fork(struct task_struct *p)
 	p->se.sum_exec_runtime		= 0;
 	p->se.prev_sum_exec_runtime	= 0;
 	p->se.nr_migrations		= 0;
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+	p->se.burst_start		= 0;
+	p->se.avg_burst			= sysctl_sched_migration_cost;
+#ifdef CONFIG_CPU_FREQ
+	p->boost_stamp = 0;
+#endif
 
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
@@ -3892,7 +4131,7 @@ pick_next_task(struct rq *rq)
 	 * Optimization: we know that if all tasks are in
 	 * the fair class we can call that function directly:
 	 */
-	if (likely(rq->nr_running == rq->cfs.nr_running)) {
+	if (likely(rq->nr_running == rq->cfs.h_nr_running)) {
 		p = fair_sched_class.pick_next_task(rq);
 		if (likely(p))
 			return p;
@@ -3921,6 +4160,14 @@ asmlinkage void __sched schedule(void)
 	struct rq *rq;
 	int cpu;
 
+	/*
+	 * If we are going to sleep and we have plugged IO queued, make
+	 * sure to submit it to avoid deadlocks.
+	 */
+	if (current->state && !(preempt_count() & PREEMPT_ACTIVE) &&
+	    blk_needs_flush_plug(current))
+		blk_schedule_flush_plug(current);
+
 need_resched:
 	preempt_disable();
 	cpu = smp_processor_id();
@@ -4700,6 +4947,20 @@ int idle_cpu(int cpu)
 	return cpu_curr(cpu) == cpu_rq(cpu)->idle;
 }
 
+#if defined(CONFIG_CPU_IDLE) && defined(CONFIG_SMP)
+/**
+ * sched_set_idle_exit_latency - tell which idle state this cpu enters
+ * @latency: the exit latency of the state, in usecs, 0 when leaving it
+ *
+ * Called by cpuidle with interrupts disabled, so that wakeups can avoid
+ * the cpus which would take long to come out of idle.
+ */
+void sched_set_idle_exit_latency(unsigned int latency)
+{
+	this_rq()->idle_exit_latency = latency;
+}
+#endif
+
 /**
  * idle_task - return the idle task for a given cpu.
  * @cpu: the processor in question.
@@ -7961,6 +8222,9 @@ void __init sched_init(void)
 	init_rt_bandwidth(&init_task_group.rt_bandwidth,
 			global_rt_period(), global_rt_runtime());
 #endif /* CONFIG_RT_GROUP_SCHED */
+#ifdef CONFIG_CFS_BANDWIDTH
+	init_cfs_bandwidth(&init_task_group.cfs_bandwidth);
+#endif
 
 #ifdef CONFIG_CGROUP_SCHED
 	list_add(&init_task_group.list, &task_groups);
@@ -8263,6 +8527,10 @@ static void free_fair_sched_group(struct task_group *tg)
 {
 	int i;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	destroy_cfs_bandwidth(&tg->cfs_bandwidth);
+#endif
+
 	for_each_possible_cpu(i) {
 		if (tg->cfs_rq)
 			kfree(tg->cfs_rq[i]);
@@ -8282,6 +8550,10 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 	struct rq *rq;
 	int i;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	init_cfs_bandwidth(&tg->cfs_bandwidth);
+#endif
+
 	tg->cfs_rq = kzalloc(sizeof(cfs_rq) * nr_cpu_ids, GFP_KERNEL);
 	if (!tg->cfs_rq)
 		goto err;
@@ -9022,6 +9294,168 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 
 	return (u64) tg->shares;
 }
+
+/*
+ * The decayed fractions of the time the group had tasks runnable and
+ * running, summed over the cpus: SCHED_LOAD_SCALE for each cpu it kept
+ * busy.  Those of the children groups are included.
+ */
+static int cpu_load_avg_show(struct cgroup *cgrp, struct cftype *cft,
+		struct cgroup_map_cb *cb)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	u64 runnable = 0, running = 0;
+	struct sched_avg avg;
+	unsigned long flags;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		raw_spin_lock_irqsave(&rq->lock, flags);
+		update_rq_clock(rq);
+		cfs_rq_avg_now(tg->cfs_rq[cpu], &avg);
+		raw_spin_unlock_irqrestore(&rq->lock, flags);
+
+		runnable += sched_avg_runnable(&avg);
+		running += sched_avg_util(&avg);
+	}
+
+	cb->fill(cb, "runnable_avg", runnable);
+	cb->fill(cb, "running_avg", running);
+	return 0;
+}
+
+#ifdef CONFIG_CFS_BANDWIDTH
+static DEFINE_MUTEX(cfs_constraints_mutex);
+
+static const u64 max_cfs_quota_period = 1 * NSEC_PER_SEC; /* 1s */
+static const u64 min_cfs_quota_period = 1 * NSEC_PER_MSEC; /* 1ms */
+
+static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
+{
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+	int i, runtime_enabled = quota != RUNTIME_INF;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	/*
+	 * Too small a quota would be overrun many times over before the tick
+	 * gets the group throttled, and too long a period makes for long
+	 * stalls once it is.
+	 */
+	if (quota < min_cfs_quota_period || period < min_cfs_quota_period ||
+	    period > max_cfs_quota_period)
+		return -EINVAL;
+
+	mutex_lock(&cfs_constraints_mutex);
+	raw_spin_lock_irq(&cfs_b->lock);
+	cfs_b->period = ns_to_ktime(period);
+	cfs_b->quota = quota;
+	cfs_b->runtime = quota;
+	cfs_b->gen++;
+	raw_spin_unlock_irq(&cfs_b->lock);
+
+	for_each_possible_cpu(i) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+		struct rq *rq = cpu_rq(i);
+
+		raw_spin_lock_irq(&rq->lock);
+		update_rq_clock(rq);
+		cfs_rq->runtime_enabled = runtime_enabled;
+		cfs_rq->runtime_remaining = 0;
+
+		if (cfs_rq_throttled(cfs_rq))
+			unthrottle_cfs_rq(cfs_rq);
+		raw_spin_unlock_irq(&rq->lock);
+	}
+	mutex_unlock(&cfs_constraints_mutex);
+
+	return 0;
+}
+
+static int tg_set_cfs_quota(struct task_group *tg, long cfs_quota_us)
+{
+	u64 quota, period;
+
+	period = ktime_to_ns(tg_cfs_bandwidth(tg)->period);
+	if (cfs_quota_us < 0)
+		quota = RUNTIME_INF;
+	else
+		quota = (u64)cfs_quota_us * NSEC_PER_USEC;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long tg_get_cfs_quota(struct task_group *tg)
+{
+	u64 quota_us;
+
+	if (tg_cfs_bandwidth(tg)->quota == RUNTIME_INF)
+		return -1;
+
+	quota_us = tg_cfs_bandwidth(tg)->quota;
+	do_div(quota_us, NSEC_PER_USEC);
+
+	return quota_us;
+}
+
+static int tg_set_cfs_period(struct task_group *tg, long cfs_period_us)
+{
+	u64 quota, period;
+
+	period = (u64)cfs_period_us * NSEC_PER_USEC;
+	quota = tg_cfs_bandwidth(tg)->quota;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long tg_get_cfs_period(struct task_group *tg)
+{
+	u64 cfs_period_us;
+
+	cfs_period_us = ktime_to_ns(tg_cfs_bandwidth(tg)->period);
+	do_div(cfs_period_us, NSEC_PER_USEC);
+
+	return cfs_period_us;
+}
+
+static s64 cpu_cfs_quota_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return tg_get_cfs_quota(cgroup_tg(cgrp));
+}
+
+static int cpu_cfs_quota_write_s64(struct cgroup *cgrp, struct cftype *cftype,
+				s64 cfs_quota_us)
+{
+	return tg_set_cfs_quota(cgroup_tg(cgrp), cfs_quota_us);
+}
+
+static u64 cpu_cfs_period_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return tg_get_cfs_period(cgroup_tg(cgrp));
+}
+
+static int cpu_cfs_period_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+				u64 cfs_period_us)
+{
+	return tg_set_cfs_period(cgroup_tg(cgrp), cfs_period_us);
+}
+
+static int cpu_stats_show(struct cgroup *cgrp, struct cftype *cft,
+		struct cgroup_map_cb *cb)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+
+	cb->fill(cb, "nr_periods", cfs_b->nr_periods);
+	cb->fill(cb, "nr_throttled", cfs_b->nr_throttled);
+	cb->fill(cb, "throttled_time", cfs_b->throttled_time);
+
+	return 0;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -9055,6 +9489,26 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "load_avg",
+		.read_map = cpu_load_avg_show,
+	},
+#endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		.name = "cfs_quota_us",
+		.read_s64 = cpu_cfs_quota_read_s64,
+		.write_s64 = cpu_cfs_quota_write_s64,
+	},
+	{
+		.name = "cfs_period_us",
+		.read_u64 = cpu_cfs_period_read_u64,
+		.write_u64 = cpu_cfs_period_write_u64,
+	},
+	{
+		.name = "stat",
+		.read_map = cpu_stats_show,
+	},
 #endif
 #ifdef CONFIG_RT_GROUP_SCHED
 	{
@@ -9433,7 +9887,11 @@ struct cgroup_subsys cpuacct_subsys = {
 };
 #endif	/* CONFIG_CGROUP_CPUACCT */
 
-#ifndef CONFIG_SMP
+#if defined(CONFIG_JRCU)
+
+/* JRCU ends its batches by itself, see kernel/jrcu.c */
+
+#elif !defined(CONFIG_SMP)
 
 void synchronize_sched_expedited(void)
 {
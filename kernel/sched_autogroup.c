@@ -4,11 +4,24 @@
 #include <linux/seq_file.h>
 #include <linux/kallsyms.h>
 #include <linux/utsname.h>
+#include <linux/hash.h>
 
 unsigned int __read_mostly sysctl_sched_autogroup_enabled = 1;
 static struct autogroup autogroup_default;
 static atomic_t autogroup_seq_nr;
 
+/*
+ * What a process gets its autogroup by: a new one on setsid() for the
+ * session key, the one shared by the processes of its real uid for the
+ * uid key, or the one it joined with prctl(PR_SET_AUTOGROUP) for the prctl
+ * key.  The last two live in the hash below while anything uses them.
+ */
+unsigned int __read_mostly sysctl_sched_autogroup_key = AUTOGROUP_KEY_SESSION;
+
+#define AUTOGROUP_HASH_BITS	6
+static struct hlist_head autogroup_hash[1 << AUTOGROUP_HASH_BITS];
+static DEFINE_SPINLOCK(autogroup_hash_lock);
+
 static void __init autogroup_init(struct task_struct *init_task)
 {
 	autogroup_default.tg = &init_task_group;
@@ -26,6 +39,12 @@ static inline void autogroup_free(struct task_group *tg)
 static inline void autogroup_destroy(struct kref *kref)
 {
 	struct autogroup *ag = container_of(kref, struct autogroup, kref);
+	unsigned long flags;
+
+	spin_lock_irqsave(&autogroup_hash_lock, flags);
+	if (!hlist_unhashed(&ag->hash_node))
+		hlist_del(&ag->hash_node);
+	spin_unlock_irqrestore(&autogroup_hash_lock, flags);
 
 	sched_destroy_group(ag->tg);
 }
@@ -165,6 +184,132 @@ void sched_autogroup_detach(struct task_struct *p)
 }
 EXPORT_SYMBOL(sched_autogroup_detach);
 
+static inline struct hlist_head *
+autogroup_hash_head(int key_type, unsigned long key, uid_t uid)
+{
+	return &autogroup_hash[hash_long(key ^ uid ^ key_type,
+					 AUTOGROUP_HASH_BITS)];
+}
+
+/*
+ * Returns a reference to the hashed autogroup of that key, NULL if there is
+ * none.  A group whose last reference is gone is on its way out of the
+ * hash, it cannot be revived.  Called with autogroup_hash_lock held.
+ */
+static struct autogroup *
+autogroup_lookup(int key_type, unsigned long key, uid_t uid)
+{
+	struct hlist_head *head = autogroup_hash_head(key_type, key, uid);
+	struct hlist_node *node;
+	struct autogroup *ag;
+
+	hlist_for_each_entry(ag, node, head, hash_node) {
+		if (ag->key_type == key_type && ag->key == key &&
+		    ag->uid == uid && atomic_inc_not_zero(&ag->kref.refcount))
+			return ag;
+	}
+	return NULL;
+}
+
+/* Allocates GFP_KERNEL, cannot be called under any spinlock */
+static struct autogroup *
+autogroup_find_create(int key_type, unsigned long key, uid_t uid)
+{
+	struct autogroup *ag, *found;
+	unsigned long flags;
+
+	spin_lock_irqsave(&autogroup_hash_lock, flags);
+	ag = autogroup_lookup(key_type, key, uid);
+	spin_unlock_irqrestore(&autogroup_hash_lock, flags);
+	if (ag)
+		return ag;
+
+	ag = autogroup_create();
+	if (ag == &autogroup_default)
+		return ag;
+
+	ag->key_type = key_type;
+	ag->key = key;
+	ag->uid = uid;
+
+	/* someone may have created it meanwhile, there can only be one */
+	spin_lock_irqsave(&autogroup_hash_lock, flags);
+	found = autogroup_lookup(key_type, key, uid);
+	if (!found)
+		hlist_add_head(&ag->hash_node,
+			       autogroup_hash_head(key_type, key, uid));
+	spin_unlock_irqrestore(&autogroup_hash_lock, flags);
+
+	if (found) {
+		autogroup_kref_put(ag);
+		ag = found;
+	}
+	return ag;
+}
+
+static void autogroup_key_attach(struct task_struct *p, int key_type,
+				 unsigned long key, uid_t uid)
+{
+	struct autogroup *ag = autogroup_find_create(key_type, key, uid);
+
+	autogroup_move_group(p, ag);
+	autogroup_kref_put(ag);
+}
+
+void sched_autogroup_setsid(struct task_struct *p)
+{
+	if (ACCESS_ONCE(sysctl_sched_autogroup_key) == AUTOGROUP_KEY_SESSION)
+		sched_autogroup_create_attach(p);
+}
+
+/*
+ * The real uid of p, which must be current, changed to uid.  That is how
+ * zygote turns a child into an app: move it to the group of the app's uid,
+ * leaving the processes of root in the default group.
+ */
+void sched_autogroup_setuid(struct task_struct *p, uid_t uid)
+{
+	if (ACCESS_ONCE(sysctl_sched_autogroup_key) != AUTOGROUP_KEY_UID)
+		return;
+
+	if (!uid)
+		autogroup_move_group(p, &autogroup_default);
+	else
+		autogroup_key_attach(p, AUTOGROUP_KEY_UID, uid, 0);
+}
+
+/*
+ * prctl(PR_SET_AUTOGROUP): the ids are private to each uid, a process can
+ * only share a group with the processes of its own uid.
+ */
+int sched_autogroup_set_key(unsigned long key)
+{
+	if (ACCESS_ONCE(sysctl_sched_autogroup_key) != AUTOGROUP_KEY_PRCTL)
+		return -EINVAL;
+	if ((long)key < 0)
+		return -EINVAL;
+
+	if (!key)
+		autogroup_move_group(current, &autogroup_default);
+	else
+		autogroup_key_attach(current, AUTOGROUP_KEY_PRCTL, key,
+				     current_uid());
+	return 0;
+}
+
+/* prctl(PR_GET_AUTOGROUP): the id the caller joined, 0 if none */
+long sched_autogroup_get_key(void)
+{
+	struct autogroup *ag = autogroup_task_get(current);
+	long key = 0;
+
+	if (ag->key_type == AUTOGROUP_KEY_PRCTL)
+		key = ag->key;
+	autogroup_kref_put(ag);
+
+	return key;
+}
+
 void sched_autogroup_fork(struct signal_struct *sig)
 {
 	sig->autogroup = autogroup_task_get(current);
@@ -259,7 +404,12 @@ void proc_sched_autogroup_show_task(struct task_struct *p, struct seq_file *m)
 	struct autogroup *ag = autogroup_task_get(p);
 
 	down_read(&ag->lock);
-	seq_printf(m, "/autogroup-%ld nice %d\n", ag->id, ag->nice);
+	seq_printf(m, "/autogroup-%ld nice %d", ag->id, ag->nice);
+	if (ag->key_type == AUTOGROUP_KEY_UID)
+		seq_printf(m, " uid %lu", ag->key);
+	else if (ag->key_type == AUTOGROUP_KEY_PRCTL)
+		seq_printf(m, " uid %u key %lu", ag->uid, ag->key);
+	seq_putc(m, '\n');
 	up_read(&ag->lock);
 
 	autogroup_kref_put(ag);
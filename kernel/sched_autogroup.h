@@ -11,6 +11,11 @@ struct autogroup {
 	struct rw_semaphore	lock;
 	unsigned long		id;
 	int			nice;
+	/* what the group is found by, see sysctl_sched_autogroup_key */
+	struct hlist_node	hash_node;
+	int			key_type;
+	unsigned long		key;
+	uid_t			uid;
 };
 
 static inline struct task_group *
@@ -167,6 +167,7 @@ void print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq)
 		spread, rq0_min_vruntime, spread0;
 	struct rq *rq = cpu_rq(cpu);
 	struct sched_entity *last;
+	struct sched_avg avg;
 	unsigned long flags;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -185,6 +186,8 @@ void print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq)
 		max_vruntime = last->vruntime;
 	min_vruntime = cfs_rq->min_vruntime;
 	rq0_min_vruntime = cpu_rq(0)->cfs.min_vruntime;
+	update_rq_clock(rq);
+	cfs_rq_avg_now(cfs_rq, &avg);
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 	SEQ_printf(m, "  .%-30s: %Ld.%06ld\n", "MIN_vruntime",
 			SPLIT_NS(MIN_vruntime));
@@ -200,6 +203,9 @@ void print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq)
 			SPLIT_NS(spread0));
 	SEQ_printf(m, "  .%-30s: %ld\n", "nr_running", cfs_rq->nr_running);
 	SEQ_printf(m, "  .%-30s: %ld\n", "load", cfs_rq->load.weight);
+	SEQ_printf(m, "  .%-30s: %lu\n", "runnable_avg",
+			sched_avg_runnable(&avg));
+	SEQ_printf(m, "  .%-30s: %lu\n", "running_avg", sched_avg_util(&avg));
 
 	SEQ_printf(m, "  .%-30s: %d\n", "nr_spread_over",
 			cfs_rq->nr_spread_over);
@@ -454,6 +460,30 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 		   "nr_involuntary_switches", (long long)p->nivcsw);
 
 	P(se.load.weight);
+	if (p->sched_class == &fair_sched_class) {
+		unsigned long runnable_avg, running_avg, load_avg;
+		struct sched_avg avg;
+		unsigned long flags;
+		struct rq *rq;
+
+		rq = task_rq_lock(p, &flags);
+		update_rq_clock(rq);
+		entity_avg_now(&p->se, &avg);
+		task_rq_unlock(rq, &flags);
+
+		__P(avg.runnable_avg_sum);
+		__P(avg.running_avg_sum);
+		__P(avg.avg_period);
+
+		/* out of SCHED_LOAD_SCALE, and the weight it was runnable with */
+		runnable_avg = sched_avg_runnable(&avg);
+		running_avg = sched_avg_util(&avg);
+		load_avg = runnable_avg * p->se.load.weight >>
+			SCHED_LOAD_SHIFT;
+		__P(runnable_avg);
+		__P(running_avg);
+		__P(load_avg);
+	}
 	P(policy);
 	P(prio);
 #undef PN
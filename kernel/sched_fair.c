@@ -89,6 +89,19 @@ unsigned int normalized_sysctl_sched_wakeup_granularity = 1000000UL;
 
 const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
 
+/*
+ * The number of cpus looked at for an idle one to wake a task up on.
+ */
+const_debug unsigned int sysctl_sched_wake_idle_scan = 8;
+
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * The amount of runtime a cfs_rq takes from its group's pool at once.
+ * (default: 5 msec, units: microseconds)
+ */
+unsigned int sysctl_sched_cfs_bandwidth_slice = 5000UL;
+#endif
+
 static const struct sched_class fair_sched_class;
 
 /**************************************************************
@@ -495,6 +508,48 @@ static u64 sched_vslice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	return calc_delta_fair(sched_slice(cfs_rq, se), se);
 }
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static inline int cfs_rq_throttled(struct cfs_rq *cfs_rq)
+{
+	return cfs_rq->throttled;
+}
+
+/* Whether the cfs_rq or one of its parents is throttled */
+static inline int throttled_hierarchy(struct cfs_rq *cfs_rq)
+{
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq_of(cfs_rq))];
+
+	if (cfs_rq_throttled(cfs_rq))
+		return 1;
+
+	for_each_sched_entity(se) {
+		if (cfs_rq_throttled(cfs_rq_of(se)))
+			return 1;
+	}
+	return 0;
+}
+
+static void account_cfs_rq_runtime(struct cfs_rq *cfs_rq,
+				   unsigned long delta_exec);
+static void check_enqueue_throttle(struct cfs_rq *cfs_rq);
+static void check_cfs_rq_runtime(struct cfs_rq *cfs_rq);
+#else
+static inline int cfs_rq_throttled(struct cfs_rq *cfs_rq)
+{
+	return 0;
+}
+
+static inline int throttled_hierarchy(struct cfs_rq *cfs_rq)
+{
+	return 0;
+}
+
+static inline void account_cfs_rq_runtime(struct cfs_rq *cfs_rq,
+					  unsigned long delta_exec) {}
+static inline void check_enqueue_throttle(struct cfs_rq *cfs_rq) {}
+static inline void check_cfs_rq_runtime(struct cfs_rq *cfs_rq) {}
+#endif
+
 /*
  * Update the current task's runtime statistics. Skip current tasks that
  * are not in our scheduling class.
@@ -544,6 +599,210 @@ static void update_curr(struct cfs_rq *cfs_rq)
 		cpuacct_charge(curtask, delta_exec);
 		account_group_exec_runtime(curtask, delta_exec);
 	}
+
+	account_cfs_rq_runtime(cfs_rq, delta_exec);
+}
+
+/*
+ * Decayed running time averages, see struct sched_avg.
+ *
+ * Time is accounted in 1us (1024ns) units and 1024us periods; the sums
+ * of a period are multiplied by y = 0.5^(1/32) at the start of each
+ * following one, so they converge to SCHED_AVG_MAX when always running.
+ */
+#define SCHED_AVG_PERIOD	32	/* number of periods to halve the sums */
+#define SCHED_AVG_MAX		47742	/* maximum possible sum */
+#define SCHED_AVG_MAX_N		345	/* periods to reach SCHED_AVG_MAX */
+
+/* y^n scaled to 2^32, for n < SCHED_AVG_PERIOD */
+static const u32 sched_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2da, 0xf5257d14, 0xefe4b99a, 0xeac0c6e6, 0xe5b906e6,
+	0xe0ccdeeb, 0xdbfbb796, 0xd744fcc9, 0xd2a81d91, 0xce248c14, 0xc9b9bd85,
+	0xc5672a10, 0xc12c4cc9, 0xbd08a39e, 0xb8fbaf46, 0xb504f333, 0xb123f581,
+	0xad583ee9, 0xa9a15ab4, 0xa5fed6a9, 0xa2704302, 0x9ef5325f, 0x9b8d39b9,
+	0x9837f050, 0x94f3efe5, 0x91c3d373, 0x8ea4398a, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
+
+/* sum of 1024*y^1 ... 1024*y^n, for n <= SCHED_AVG_PERIOD */
+static const u32 sched_avg_yN_sum[] = {
+	    0, 1002, 1982, 2941, 3880, 4798, 5697, 6576, 7437, 8279, 9103,
+	 9909, 10698, 11470, 12226, 12966, 13690, 14398, 15091, 15769, 16433,
+	17082, 17718, 18340, 18949, 19545, 20128, 20698, 21256, 21802, 22336,
+	22859, 23371,
+};
+
+/* Returns val * y^n */
+static u64 decay_sched_avg(u64 val, u64 n)
+{
+	unsigned int local_n;
+
+	if (!n)
+		return val;
+	else if (unlikely(n > SCHED_AVG_PERIOD * 63))
+		return 0;
+
+	local_n = n;
+	if (unlikely(local_n >= SCHED_AVG_PERIOD)) {
+		val >>= local_n / SCHED_AVG_PERIOD;
+		local_n %= SCHED_AVG_PERIOD;
+	}
+
+	val *= sched_avg_yN_inv[local_n];
+	return val >> 32;
+}
+
+/* Returns the sum of n full periods: 1024*y^1 + ... + 1024*y^n */
+static u32 sched_avg_contrib(u64 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= SCHED_AVG_PERIOD))
+		return sched_avg_yN_sum[n];
+	else if (unlikely(n >= SCHED_AVG_MAX_N))
+		return SCHED_AVG_MAX;
+
+	do {
+		contrib /= 2;
+		contrib += sched_avg_yN_sum[SCHED_AVG_PERIOD];
+		n -= SCHED_AVG_PERIOD;
+	} while (n > SCHED_AVG_PERIOD);
+
+	contrib = decay_sched_avg(contrib, n);
+	return contrib + sched_avg_yN_sum[n];
+}
+
+/*
+ * Accounts the time since the last update as runnable and running or not,
+ * which the caller must make sure it was the whole time.
+ */
+static void __update_sched_avg(u64 now, struct sched_avg *sa, int runnable,
+			       int running)
+{
+	u64 delta, periods;
+	u32 contrib;
+	unsigned int delta_w;
+
+	if (unlikely(!sa->last_update_time)) {
+		sa->last_update_time = now;
+		return;
+	}
+
+	delta = now - sa->last_update_time;
+	if ((s64)delta < 0) {
+		sa->last_update_time = now;
+		return;
+	}
+
+	delta >>= 10;
+	if (!delta)
+		return;
+	sa->last_update_time += delta << 10;
+
+	/* complete the period in progress, then decay it with the others */
+	delta_w = sa->avg_period % 1024;
+	if (delta + delta_w >= 1024) {
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		if (running)
+			sa->running_avg_sum += delta_w;
+		sa->avg_period += delta_w;
+		delta -= delta_w;
+
+		periods = delta / 1024;
+		delta %= 1024;
+
+		sa->runnable_avg_sum = decay_sched_avg(sa->runnable_avg_sum,
+						       periods + 1);
+		sa->running_avg_sum = decay_sched_avg(sa->running_avg_sum,
+						      periods + 1);
+		sa->avg_period = decay_sched_avg(sa->avg_period, periods + 1);
+
+		contrib = sched_avg_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += contrib;
+		if (running)
+			sa->running_avg_sum += contrib;
+		sa->avg_period += contrib;
+	}
+
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	if (running)
+		sa->running_avg_sum += delta;
+	sa->avg_period += delta;
+}
+
+/* Returns the fraction of the time it was running, out of SCHED_LOAD_SCALE */
+static inline unsigned long sched_avg_util(struct sched_avg *sa)
+{
+	return (unsigned long)sa->running_avg_sum * SCHED_LOAD_SCALE /
+		(sa->avg_period + 1);
+}
+
+/* Returns the fraction of the time it was runnable, out of SCHED_LOAD_SCALE */
+static inline unsigned long sched_avg_runnable(struct sched_avg *sa)
+{
+	return (unsigned long)sa->runnable_avg_sum * SCHED_LOAD_SCALE /
+		(sa->avg_period + 1);
+}
+
+/*
+ * To be called before the entity is enqueued, dequeued, gets or stops being
+ * the current one of its cfs_rq, and whenever its averages are to be up to
+ * date.  Those of the cfs_rq are updated along: a cfs_rq is runnable while
+ * it has entities queued, and those of a group entity are the same as the
+ * ones of the cfs_rq it owns, so the averages of a group add up those of
+ * all its tasks and subgroups.
+ */
+static void update_entity_avg(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	u64 now = rq_of(cfs_rq)->clock;
+	int running = cfs_rq->curr == se;
+
+	__update_sched_avg(now, &se->avg, se->on_rq || running, running);
+	__update_sched_avg(now, &cfs_rq->avg, cfs_rq->nr_running,
+			   cfs_rq->curr != NULL);
+}
+
+/*
+ * Return the averages as of the rq clock, for reporting: they may have gone
+ * without update for as long as the entity or the cfs_rq has been sleeping.
+ * The rq lock must be held.
+ */
+#ifdef CONFIG_SCHED_DEBUG
+static void entity_avg_now(struct sched_entity *se, struct sched_avg *sa)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	int running = cfs_rq->curr == se;
+
+	*sa = se->avg;
+	__update_sched_avg(rq_of(cfs_rq)->clock, sa, se->on_rq || running,
+			   running);
+}
+#endif
+
+#if defined(CONFIG_SCHED_DEBUG) || defined(CONFIG_FAIR_GROUP_SCHED)
+static void cfs_rq_avg_now(struct cfs_rq *cfs_rq, struct sched_avg *sa)
+{
+	*sa = cfs_rq->avg;
+	__update_sched_avg(rq_of(cfs_rq)->clock, sa, cfs_rq->nr_running,
+			   cfs_rq->curr != NULL);
+}
+#endif
+
+/*
+ * Reports the utilization of the cpu by CFS tasks to cpufreq: that is the
+ * decayed running time of the cpu, or of @p when it has run more lately.
+ */
+static void update_cpufreq_fair(struct rq *rq, struct task_struct *p)
+{
+	unsigned long util = sched_avg_util(&rq->cfs.avg);
+
+	if (p)
+		util = max(util, sched_avg_util(&p->se.avg));
+	cpufreq_update_util(rq, min_t(unsigned long, util, SCHED_LOAD_SCALE));
 }
 
 static inline void
@@ -771,17 +1030,22 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_entity_avg(cfs_rq, se);
 	account_entity_enqueue(cfs_rq, se);
 
 	if (flags & ENQUEUE_WAKEUP) {
 		place_entity(cfs_rq, se, 0);
 		enqueue_sleeper(cfs_rq, se);
+		se->burst_start = se->sum_exec_runtime;
 	}
 
 	update_stats_enqueue(cfs_rq, se);
 	check_spread(cfs_rq, se);
 	if (se != cfs_rq->curr)
 		__enqueue_entity(cfs_rq, se);
+
+	if (cfs_rq->nr_running == 1)
+		check_enqueue_throttle(cfs_rq);
 }
 
 static void __clear_buddies(struct cfs_rq *cfs_rq, struct sched_entity *se)
@@ -808,9 +1072,13 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_entity_avg(cfs_rq, se);
 
 	update_stats_dequeue(cfs_rq, se);
 	if (flags & DEQUEUE_SLEEP) {
+		s64 diff = se->sum_exec_runtime - se->burst_start - se->avg_burst;
+
+		se->avg_burst += diff >> 3;
 #ifdef CONFIG_SCHEDSTATS
 		if (entity_is_task(se)) {
 			struct task_struct *tsk = task_of(se);
@@ -899,6 +1167,7 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	}
 
 	update_stats_curr_start(cfs_rq, se);
+	update_entity_avg(cfs_rq, se);
 	cfs_rq->curr = se;
 #ifdef CONFIG_SCHEDSTATS
 	/*
@@ -945,12 +1214,16 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 	if (prev->on_rq)
 		update_curr(cfs_rq);
 
+	/* throttle cfs_rqs exceeding runtime */
+	check_cfs_rq_runtime(cfs_rq);
+
 	check_spread(cfs_rq, prev);
 	if (prev->on_rq) {
 		update_stats_wait_start(cfs_rq, prev);
 		/* Put 'current' back into the tree. */
 		__enqueue_entity(cfs_rq, prev);
 	}
+	update_entity_avg(cfs_rq, prev);
 	cfs_rq->curr = NULL;
 }
 
@@ -961,6 +1234,7 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_entity_avg(cfs_rq, curr);
 
 #ifdef CONFIG_SCHED_HRTICK
 	/*
@@ -983,6 +1257,245 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 		check_preempt_tick(cfs_rq, curr);
 }
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/**************************************************
+ * CFS bandwidth control:
+ */
+
+static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
+{
+	return &tg->cfs_bandwidth;
+}
+
+static inline u64 sched_cfs_bandwidth_slice(void)
+{
+	return (u64)sysctl_sched_cfs_bandwidth_slice * NSEC_PER_USEC;
+}
+
+/*
+ * Takes a slice from the pool, and what the cfs_rq overran.  Returns
+ * whether it has runtime left.
+ */
+static int assign_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	u64 amount = 0, min_amount;
+
+	min_amount = sched_cfs_bandwidth_slice() - cfs_rq->runtime_remaining;
+
+	raw_spin_lock(&cfs_b->lock);
+	if (cfs_b->quota == RUNTIME_INF) {
+		amount = min_amount;
+	} else {
+		if (!cfs_b->timer_active)
+			__start_cfs_bandwidth(cfs_b);
+
+		if (cfs_b->runtime > 0) {
+			amount = min(cfs_b->runtime, min_amount);
+			cfs_b->runtime -= amount;
+			cfs_b->idle = 0;
+		}
+	}
+	cfs_rq->runtime_gen = cfs_b->gen;
+	raw_spin_unlock(&cfs_b->lock);
+
+	cfs_rq->runtime_remaining += amount;
+
+	return cfs_rq->runtime_remaining > 0;
+}
+
+static void account_cfs_rq_runtime(struct cfs_rq *cfs_rq,
+				   unsigned long delta_exec)
+{
+	if (!cfs_rq->runtime_enabled)
+		return;
+
+	/* what is left of a slice from an earlier period is not carried over */
+	if (cfs_rq->runtime_gen != ACCESS_ONCE(cfs_rq->tg->cfs_bandwidth.gen) &&
+	    cfs_rq->runtime_remaining > 0)
+		cfs_rq->runtime_remaining = 0;
+
+	cfs_rq->runtime_remaining -= delta_exec;
+	if (likely(cfs_rq->runtime_remaining > 0))
+		return;
+
+	/*
+	 * Out of runtime: reschedule, for put_prev_entity() to throttle the
+	 * cfs_rq.
+	 */
+	if (!assign_cfs_rq_runtime(cfs_rq) && likely(cfs_rq->curr))
+		resched_task(rq_of(cfs_rq)->curr);
+}
+
+/*
+ * Takes the group entity of the cfs_rq, and the parents it leaves empty,
+ * off their queues until the period timer gives it runtime again.  Its
+ * tasks stop counting as runnable, up to the rq unless a parent is
+ * throttled as well.
+ */
+static void throttle_cfs_rq(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq)];
+	unsigned long task_delta = cfs_rq->h_nr_running;
+	int dequeue = 1;
+
+	for_each_sched_entity(se) {
+		struct cfs_rq *qcfs_rq = cfs_rq_of(se);
+
+		/* already dequeued, as an empty parent of a sleeping task */
+		if (!se->on_rq)
+			break;
+
+		if (dequeue)
+			dequeue_entity(qcfs_rq, se, DEQUEUE_SLEEP);
+		qcfs_rq->h_nr_running -= task_delta;
+
+		if (qcfs_rq->load.weight)
+			dequeue = 0;
+	}
+
+	if (!se)
+		rq->nr_running -= task_delta;
+
+	cfs_rq->throttled = 1;
+	cfs_rq->throttled_timestamp = rq->clock;
+
+	raw_spin_lock(&cfs_b->lock);
+	list_add_tail_rcu(&cfs_rq->throttled_list, &cfs_b->throttled_cfs_rq);
+	raw_spin_unlock(&cfs_b->lock);
+}
+
+static void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq)];
+	unsigned long task_delta;
+	int enqueue = 1;
+
+	cfs_rq->throttled = 0;
+
+	raw_spin_lock(&cfs_b->lock);
+	cfs_b->throttled_time += rq->clock - cfs_rq->throttled_timestamp;
+	list_del_rcu(&cfs_rq->throttled_list);
+	raw_spin_unlock(&cfs_b->lock);
+
+	if (!cfs_rq->load.weight)
+		return;
+
+	task_delta = cfs_rq->h_nr_running;
+	for_each_sched_entity(se) {
+		if (se->on_rq)
+			enqueue = 0;
+
+		cfs_rq = cfs_rq_of(se);
+		if (enqueue)
+			enqueue_entity(cfs_rq, se, ENQUEUE_WAKEUP);
+		cfs_rq->h_nr_running += task_delta;
+
+		if (cfs_rq_throttled(cfs_rq))
+			break;
+	}
+
+	if (!se)
+		rq->nr_running += task_delta;
+
+	/* determine whether we need to wake up a potentially idle cpu */
+	if (rq->curr == rq->idle && rq->nr_running)
+		resched_task(rq->curr);
+}
+
+static void check_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	if (likely(!cfs_rq->runtime_enabled || cfs_rq->runtime_remaining > 0))
+		return;
+
+	if (cfs_rq_throttled(cfs_rq))
+		return;
+
+	throttle_cfs_rq(cfs_rq);
+}
+
+/*
+ * A cfs_rq getting its first entity, which is not running, may have run
+ * out of runtime earlier: take some or throttle it right away.
+ */
+static void check_enqueue_throttle(struct cfs_rq *cfs_rq)
+{
+	if (!cfs_rq->runtime_enabled || cfs_rq->curr)
+		return;
+
+	/* already waiting for the period timer, don't take runtime for it */
+	if (cfs_rq_throttled(cfs_rq))
+		return;
+
+	if (cfs_rq->runtime_remaining <= 0)
+		assign_cfs_rq_runtime(cfs_rq);
+	check_cfs_rq_runtime(cfs_rq);
+}
+
+/* Hands the refilled pool out to the throttled cfs_rqs */
+static void distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
+{
+	struct cfs_rq *cfs_rq;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(cfs_rq, &cfs_b->throttled_cfs_rq,
+				throttled_list) {
+		struct rq *rq = rq_of(cfs_rq);
+
+		raw_spin_lock(&rq->lock);
+		if (cfs_rq_throttled(cfs_rq)) {
+			update_rq_clock(rq);
+			if (assign_cfs_rq_runtime(cfs_rq))
+				unthrottle_cfs_rq(cfs_rq);
+		}
+		raw_spin_unlock(&rq->lock);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Refills the pool of the group at the start of a period.  Returns whether
+ * the timer can be stopped, the group having used no runtime for a period.
+ */
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun)
+{
+	int throttled;
+
+	raw_spin_lock(&cfs_b->lock);
+	/* stopped on the previous run of this callback, or bandwidth lifted */
+	if (!cfs_b->timer_active || cfs_b->quota == RUNTIME_INF)
+		goto out_deactivate;
+
+	throttled = !list_empty(&cfs_b->throttled_cfs_rq);
+	cfs_b->nr_periods += overrun;
+
+	if (cfs_b->idle && !throttled)
+		goto out_deactivate;
+
+	if (throttled)
+		cfs_b->nr_throttled += overrun;
+
+	cfs_b->runtime = cfs_b->quota;
+	cfs_b->gen++;
+	cfs_b->idle = 1;
+	raw_spin_unlock(&cfs_b->lock);
+
+	if (throttled)
+		distribute_cfs_runtime(cfs_b);
+
+	return 0;
+
+out_deactivate:
+	cfs_b->timer_active = 0;
+	raw_spin_unlock(&cfs_b->lock);
+	return 1;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 /**************************************************
  * CFS operations on tasks:
  */
@@ -1044,9 +1557,9 @@ static inline void hrtick_update(struct rq *rq)
 #endif
 
 /*
- * The enqueue_task method is called before nr_running is
- * increased. Here we update the fair scheduling stats and
- * then put the task into the rbtree:
+ * The enqueue_task method updates the fair scheduling stats, puts
+ * the task into the rbtree and increases nr_running, unless the task
+ * ends up below a throttled cfs_rq:
  */
 static void
 enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
@@ -1059,16 +1572,30 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 			break;
 		cfs_rq = cfs_rq_of(se);
 		enqueue_entity(cfs_rq, se, flags);
+		/* the group runs again once unthrottled */
+		if (cfs_rq_throttled(cfs_rq))
+			break;
+		cfs_rq->h_nr_running++;
 		flags = ENQUEUE_WAKEUP;
 	}
 
+	for_each_sched_entity(se) {
+		cfs_rq = cfs_rq_of(se);
+		cfs_rq->h_nr_running++;
+		if (cfs_rq_throttled(cfs_rq))
+			break;
+	}
+
+	if (!se)
+		inc_nr_running(rq);
+	update_cpufreq_fair(rq, p);
 	hrtick_update(rq);
 }
 
 /*
- * The dequeue_task method is called before nr_running is
- * decreased. We remove the task from the rbtree and
- * update the fair scheduling stats:
+ * The dequeue_task method removes the task from the rbtree, updates
+ * the fair scheduling stats and decreases nr_running, unless the task
+ * was below a throttled cfs_rq:
  */
 static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 {
@@ -1078,12 +1605,28 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		dequeue_entity(cfs_rq, se, flags);
+		if (cfs_rq_throttled(cfs_rq))
+			break;
+		cfs_rq->h_nr_running--;
+
 		/* Don't dequeue parent if it has other entities besides us */
-		if (cfs_rq->load.weight)
+		if (cfs_rq->load.weight) {
+			se = parent_entity(se);
 			break;
+		}
 		flags |= DEQUEUE_SLEEP;
 	}
 
+	for_each_sched_entity(se) {
+		cfs_rq = cfs_rq_of(se);
+		cfs_rq->h_nr_running--;
+		if (cfs_rq_throttled(cfs_rq))
+			break;
+	}
+
+	if (!se)
+		dec_nr_running(rq);
+	update_cpufreq_fair(rq, NULL);
 	hrtick_update(rq);
 }
 
@@ -1389,6 +1932,19 @@ find_idlest_cpu(struct sched_group *group, struct task_struct *p, int this_cpu)
 	return idlest;
 }
 
+/*
+ * Whether waking the task up on an idle cpu would cost it more time for
+ * the cpu to come out of its idle state than the task usually runs for:
+ * short running tasks, like the binder threads serving a call, are better
+ * off queued behind a running task which is about to sleep.
+ */
+static inline int idle_cpu_too_deep(struct task_struct *p, int cpu)
+{
+	unsigned int latency = ACCESS_ONCE(cpu_rq(cpu)->idle_exit_latency);
+
+	return (u64)latency * NSEC_PER_USEC > p->se.avg_burst;
+}
+
 /*
  * Try and locate an idle CPU in the sched_domain.
  */
@@ -1397,6 +1953,9 @@ static int select_idle_sibling(struct task_struct *p, int target)
 	int cpu = smp_processor_id();
 	int prev_cpu = task_cpu(p);
 	struct sched_domain *sd;
+	unsigned int latency, best_latency = UINT_MAX;
+	int nr_scanned = 0;
+	int best = -1;
 	int i;
 
 	/*
@@ -1408,22 +1967,34 @@ static int select_idle_sibling(struct task_struct *p, int target)
 
 	/*
 	 * If the task is going to be woken-up on the cpu where it previously
-	 * ran and if it is currently idle, then it the right target.
+	 * ran and if it is currently idle, then it the right target, unless
+	 * it is in an idle state too deep for the task.
 	 */
-	if (target == prev_cpu && idle_cpu(prev_cpu))
+	if (target == prev_cpu && idle_cpu(prev_cpu) &&
+	    !idle_cpu_too_deep(p, prev_cpu))
 		return prev_cpu;
 
 	/*
-	 * Otherwise, iterate the domains and find an elegible idle cpu.
+	 * Otherwise, iterate the domains and find the eligible idle cpu in
+	 * the shallowest idle state, looking at no more than
+	 * sysctl_sched_wake_idle_scan cpus.
 	 */
 	for_each_domain(target, sd) {
 		if (!(sd->flags & SD_SHARE_PKG_RESOURCES))
 			break;
 
 		for_each_cpu_and(i, sched_domain_span(sd), &p->cpus_allowed) {
-			if (idle_cpu(i)) {
-				target = i;
-				break;
+			if (nr_scanned++ >= sysctl_sched_wake_idle_scan)
+				goto done;
+			if (!idle_cpu(i))
+				continue;
+
+			latency = ACCESS_ONCE(cpu_rq(i)->idle_exit_latency);
+			if (latency < best_latency) {
+				best = i;
+				best_latency = latency;
+				if (!latency)
+					goto done;
 			}
 		}
 
@@ -1435,8 +2006,19 @@ static int select_idle_sibling(struct task_struct *p, int target)
 		    cpumask_test_cpu(prev_cpu, sched_domain_span(sd)))
 			break;
 	}
+done:
+	if (best < 0 || !idle_cpu_too_deep(p, best))
+		return best < 0 ? target : best;
+
+	/*
+	 * Rather than a cpu in deep idle, a short running task takes the
+	 * target if it is running, or whichever is in the shallower state.
+	 */
+	if (!idle_cpu(target) ||
+	    ACCESS_ONCE(cpu_rq(target)->idle_exit_latency) <= best_latency)
+		return target;
 
-	return target;
+	return best;
 }
 
 /*
@@ -1670,6 +2252,10 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 	if (unlikely(se == pse))
 		return;
 
+	/* a task of a throttled group waits for the group to get runtime */
+	if (unlikely(throttled_hierarchy(cfs_rq_of(pse))))
+		return;
+
 	if (sched_feat(NEXT_BUDDY) && scale && !(wake_flags & WF_FORK))
 		set_next_buddy(pse);
 
@@ -1840,6 +2426,9 @@ move_one_task(struct rq *this_rq, int this_cpu, struct rq *busiest,
 	int pinned = 0;
 
 	for_each_leaf_cfs_rq(busiest, cfs_rq) {
+		if (throttled_hierarchy(cfs_rq))
+			continue;
+
 		list_for_each_entry_safe(p, n, &cfs_rq->tasks, se.group_node) {
 
 			if (!can_migrate_task(p, busiest, this_cpu,
@@ -1947,6 +2536,14 @@ load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 		if (!busiest_cfs_rq->task_weight)
 			continue;
 
+		/*
+		 * tasks of a throttled group do not run, and would not on
+		 * this cpu either
+		 */
+		if (throttled_hierarchy(busiest_cfs_rq) ||
+		    throttled_hierarchy(tg->cfs_rq[this_cpu]))
+			continue;
+
 		rem_load = (u64)rem_load_move * busiest_weight;
 		rem_load = div_u64(rem_load, busiest_h_load + 1);
 
@@ -3739,6 +4336,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
 	}
+
+	update_cpufreq_fair(rq, curr);
 }
 
 /*
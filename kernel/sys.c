@@ -1083,7 +1083,7 @@ out:
 	write_unlock_irq(&tasklist_lock);
 	if (err > 0) {
 		proc_sid_connector(group_leader);
-		sched_autogroup_create_attach(group_leader);
+		sched_autogroup_setsid(group_leader);
 	}
 	return err;
 }
@@ -1731,6 +1731,16 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			else
 				error = PR_MCE_KILL_DEFAULT;
 			break;
+		case PR_SET_AUTOGROUP:
+			if (arg3 | arg4 | arg5)
+				return -EINVAL;
+			error = sched_autogroup_set_key(arg2);
+			break;
+		case PR_GET_AUTOGROUP:
+			if (arg2 | arg3 | arg4 | arg5)
+				return -EINVAL;
+			error = sched_autogroup_get_key();
+			break;
 		default:
 			error = -EINVAL;
 			break;
@@ -14,6 +14,9 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/cpu.h>
 #include "internal.h"
 
 /*
@@ -604,3 +607,244 @@ void compaction_unregister_node(struct node *node)
 	return sysdev_remove_file(&node->sysdev, &attr_compact);
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
+
+/*
+ * Background compaction: one kcompactd thread per node compacts its zones
+ * ahead of high-order allocations so that they find free pages instead of
+ * stalling in direct compaction.  It is woken by kswapd when a high-order
+ * request it was woken for is held back by fragmentation rather than by a
+ * shortage of memory, and it checks on its own every
+ * compaction_proactive_centisecs whether the fragmentation index of the
+ * smallest order direct compaction is entered for has crossed
+ * extfrag_threshold.  Two passes over a node are at least
+ * compaction_ratelimit_centisecs apart.
+ */
+#define KCOMPACTD_ORDER		(PAGE_ALLOC_COSTLY_ORDER + 1)
+
+int sysctl_compaction_proactive_centisecs = 500;
+int sysctl_compaction_ratelimit_centisecs = 10;
+
+/* Is @zone fragmented enough at @order for compaction to help? */
+static bool kcompactd_zone_suitable(struct zone *zone, int order)
+{
+	unsigned long watermark = low_wmark_pages(zone);
+
+	if (!populated_zone(zone) || zone->all_unreclaimable)
+		return false;
+
+	/* A page of this order can already be allocated */
+	if (zone_watermark_ok(zone, order, watermark, 0, 0))
+		return false;
+
+	/* Migration needs free pages to copy to, see try_to_compact_pages() */
+	if (!zone_watermark_ok(zone, 0, watermark + (2UL << order), 0, 0))
+		return false;
+
+	return fragmentation_index(zone, order) > sysctl_extfrag_threshold;
+}
+
+static bool kcompactd_node_suitable(pg_data_t *pgdat, int order)
+{
+	int zoneid;
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++)
+		if (kcompactd_zone_suitable(&pgdat->node_zones[zoneid], order))
+			return true;
+
+	return false;
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat, int order)
+{
+	int zoneid;
+
+	count_vm_event(KCOMPACTD_WAKE);
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+		};
+
+		if (!kcompactd_zone_suitable(zone, order))
+			continue;
+		if (compaction_deferred(zone))
+			continue;
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		compact_zone(zone, &cc);
+
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0)) {
+			zone->compact_considered = 0;
+			zone->compact_defer_shift = 0;
+		} else {
+			defer_compaction(zone);
+		}
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+}
+
+static void kcompactd_timeout(unsigned long data)
+{
+	wake_up_process((struct task_struct *)data);
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned long last_run = jiffies;
+	struct timer_list timer;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	/*
+	 * The proactive checks are not worth waking an idle cpu for, so
+	 * they are timed by a deferrable timer.
+	 */
+	setup_deferrable_timer_on_stack(&timer, kcompactd_timeout,
+					(unsigned long)current);
+
+	while (!kthread_should_stop()) {
+		int proactive = sysctl_compaction_proactive_centisecs;
+		unsigned long next;
+		long delta;
+		int order;
+
+		if (proactive)
+			mod_timer(&timer, jiffies +
+				  msecs_to_jiffies(proactive * 10));
+
+		wait_event_freezable(pgdat->kcompactd_wait,
+				pgdat->kcompactd_max_order ||
+				kthread_should_stop() ||
+				(proactive && !timer_pending(&timer)));
+		if (kthread_should_stop())
+			break;
+
+		order = pgdat->kcompactd_max_order;
+		pgdat->kcompactd_max_order = 0;
+		if (!order) {
+			/* Proactive check, nobody asked for a given order */
+			if (!sysctl_compaction_proactive_centisecs)
+				continue;
+			order = KCOMPACTD_ORDER;
+			if (!kcompactd_node_suitable(pgdat, order))
+				continue;
+		}
+
+		next = last_run + msecs_to_jiffies(
+				sysctl_compaction_ratelimit_centisecs * 10);
+		delta = (long)(next - jiffies);
+		if (delta > 0) {
+			schedule_timeout_interruptible(delta);
+			try_to_freeze();
+		}
+
+		kcompactd_do_work(pgdat, order);
+		last_run = jiffies;
+	}
+
+	del_timer_sync(&timer);
+	destroy_timer_on_stack(&timer);
+	return 0;
+}
+
+/**
+ * wakeup_kcompactd - ask for a node to be compacted in the background
+ * @pgdat: node to compact
+ * @order: order of the allocation that could not be satisfied
+ *
+ * Called by kswapd after reclaiming for a high-order request.  The
+ * daemon is only woken if some zone of the node is fragmented at @order.
+ */
+void wakeup_kcompactd(pg_data_t *pgdat, int order)
+{
+	if (!order)
+		return;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	if (!kcompactd_node_suitable(pgdat, order))
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ * Unlike kswapd, the system keeps going if the thread can't be started.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+/* Same as kswapd: restore the node binding once one of its CPUs is back */
+static int __devinit kcompactd_cpu_callback(struct notifier_block *nfb,
+					    unsigned long action, void *hcpu)
+{
+	int nid;
+
+	if (action == CPU_ONLINE || action == CPU_ONLINE_FROZEN) {
+		for_each_node_state(nid, N_HIGH_MEMORY) {
+			pg_data_t *pgdat = NODE_DATA(nid);
+			const struct cpumask *mask;
+
+			mask = cpumask_of_node(pgdat->node_id);
+
+			if (pgdat->kcompactd &&
+			    cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
+				set_cpus_allowed_ptr(pgdat->kcompactd, mask);
+		}
+	}
+	return NOTIFY_OK;
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	hotcpu_notifier(kcompactd_cpu_callback, 0);
+	return 0;
+}
+module_init(kcompactd_init)
@@ -110,16 +110,45 @@
  *    ->i_mmap_lock
  */
 
+static void page_cache_tree_delete(struct address_space *mapping,
+				   struct page *page, void *shadow)
+{
+	void **slot;
+	int tag;
+
+	if (!shadow) {
+		radix_tree_delete(&mapping->page_tree, page->index);
+		return;
+	}
+
+	/*
+	 * Leave the shadow entry in the page's slot.  A page going away
+	 * should not be tagged anymore, but shadow entries must never be
+	 * returned by tagged lookups, so make sure.
+	 */
+	slot = radix_tree_lookup_slot(&mapping->page_tree, page->index);
+	for (tag = 0; tag < RADIX_TREE_MAX_TAGS; tag++) {
+		if (radix_tree_tagged(&mapping->page_tree, tag))
+			radix_tree_tag_clear(&mapping->page_tree, page->index,
+					     tag);
+	}
+	radix_tree_replace_slot(slot, shadow);
+	mapping->nrshadows++;
+}
+
 /*
  * Remove a page from the page cache and free it. Caller has to make
  * sure the page is locked and that nobody else uses it - or that usage
  * is safe.  The caller must hold the mapping's tree_lock.
+ *
+ * If @shadow is not NULL, it is left in the page's slot for refault
+ * detection, see mm/workingset.c.
  */
-void __remove_from_page_cache(struct page *page)
+void __delete_from_page_cache(struct page *page, void *shadow)
 {
 	struct address_space *mapping = page->mapping;
 
-	radix_tree_delete(&mapping->page_tree, page->index);
+	page_cache_tree_delete(mapping, page, shadow);
 	page->mapping = NULL;
 	mapping->nrpages--;
 	__dec_zone_page_state(page, NR_FILE_PAGES);
@@ -140,6 +169,11 @@ void __remove_from_page_cache(struct page *page)
 	}
 }
 
+void __remove_from_page_cache(struct page *page)
+{
+	__delete_from_page_cache(page, NULL);
+}
+
 void remove_from_page_cache(struct page *page)
 {
 	struct address_space *mapping = page->mapping;
@@ -384,18 +418,32 @@ int filemap_write_and_wait_range(struct address_space *mapping,
 }
 EXPORT_SYMBOL(filemap_write_and_wait_range);
 
-/**
- * add_to_page_cache_locked - add a locked page to the pagecache
- * @page:	page to add
- * @mapping:	the page's address_space
- * @offset:	page index
- * @gfp_mask:	page allocation mode
- *
- * This function is used to add a page to the pagecache. It must be locked.
- * This function does not add the page to the LRU.  The caller must do that.
- */
-int add_to_page_cache_locked(struct page *page, struct address_space *mapping,
-		pgoff_t offset, gfp_t gfp_mask)
+static int page_cache_tree_insert(struct address_space *mapping,
+				  struct page *page, void **shadowp)
+{
+	void **slot;
+	void *p;
+
+	slot = radix_tree_lookup_slot(&mapping->page_tree, page->index);
+	if (!slot)
+		return radix_tree_insert(&mapping->page_tree, page->index, page);
+
+	p = radix_tree_deref_slot(slot);
+	if (!radix_tree_exceptional_entry(p))
+		return -EEXIST;
+
+	/* the page was evicted recently, take over its shadow entry */
+	radix_tree_replace_slot(slot, page);
+	mapping->nrshadows--;
+	if (shadowp)
+		*shadowp = p;
+	return 0;
+}
+
+static int __add_to_page_cache_locked(struct page *page,
+				      struct address_space *mapping,
+				      pgoff_t offset, gfp_t gfp_mask,
+				      void **shadowp)
 {
 	int error;
 
@@ -413,7 +461,7 @@ int add_to_page_cache_locked(struct page *page, struct address_space *mapping,
 		page->index = offset;
 
 		spin_lock_irq(&mapping->tree_lock);
-		error = radix_tree_insert(&mapping->page_tree, offset, page);
+		error = page_cache_tree_insert(mapping, page, shadowp);
 		if (likely(!error)) {
 			mapping->nrpages++;
 			__inc_zone_page_state(page, NR_FILE_PAGES);
@@ -432,11 +480,28 @@ int add_to_page_cache_locked(struct page *page, struct address_space *mapping,
 out:
 	return error;
 }
+
+/**
+ * add_to_page_cache_locked - add a locked page to the pagecache
+ * @page:	page to add
+ * @mapping:	the page's address_space
+ * @offset:	page index
+ * @gfp_mask:	page allocation mode
+ *
+ * This function is used to add a page to the pagecache. It must be locked.
+ * This function does not add the page to the LRU.  The caller must do that.
+ */
+int add_to_page_cache_locked(struct page *page, struct address_space *mapping,
+		pgoff_t offset, gfp_t gfp_mask)
+{
+	return __add_to_page_cache_locked(page, mapping, offset, gfp_mask, NULL);
+}
 EXPORT_SYMBOL(add_to_page_cache_locked);
 
 int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 				pgoff_t offset, gfp_t gfp_mask)
 {
+	void *shadow = NULL;
 	int ret;
 
 	/*
@@ -448,14 +513,27 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 	if (mapping_cap_swap_backed(mapping))
 		SetPageSwapBacked(page);
 
-	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
-	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
-			lru_cache_add_anon(page);
+	__set_page_locked(page);
+	ret = __add_to_page_cache_locked(page, mapping, offset, gfp_mask,
+					 &shadow);
+	if (unlikely(ret)) {
+		__clear_page_locked(page);
+		return ret;
 	}
-	return ret;
+
+	if (page_is_file_cache(page)) {
+		/*
+		 * A refault of a page that was evicted while still
+		 * part of the working set goes straight to the active
+		 * list.
+		 */
+		if (shadow && workingset_refault(shadow))
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		else
+			lru_cache_add_file(page);
+	} else
+		lru_cache_add_anon(page);
+	return 0;
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
 
@@ -635,6 +713,11 @@ repeat:
 			goto out;
 		if (radix_tree_deref_retry(page))
 			goto repeat;
+		/* shadow entry of an evicted page */
+		if (radix_tree_exceptional_entry(page)) {
+			page = NULL;
+			goto out;
+		}
 
 		if (!page_cache_get_speculative(page))
 			goto repeat;
@@ -752,38 +835,54 @@ EXPORT_SYMBOL(find_or_create_page);
 unsigned find_get_pages(struct address_space *mapping, pgoff_t start,
 			    unsigned int nr_pages, struct page **pages)
 {
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
 	unsigned int i;
-	unsigned int ret;
+	unsigned int ret = 0;
 	unsigned int nr_found;
 
+	/*
+	 * Look up in batches, so that a range holding only shadow entries
+	 * is skipped rather than ending the search.
+	 */
 	rcu_read_lock();
+	while (ret < nr_pages) {
 restart:
-	nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
-				(void ***)pages, start, nr_pages);
-	ret = 0;
-	for (i = 0; i < nr_found; i++) {
-		struct page *page;
+		nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
+				slots, indices, start,
+				min_t(unsigned int, nr_pages - ret,
+				      PAGEVEC_SIZE));
+		if (!nr_found)
+			break;
+		for (i = 0; i < nr_found; i++) {
+			struct page *page;
 repeat:
-		page = radix_tree_deref_slot((void **)pages[i]);
-		if (unlikely(!page))
-			continue;
-		if (radix_tree_deref_retry(page)) {
-			if (ret)
-				start = pages[ret-1]->index;
-			goto restart;
-		}
+			page = radix_tree_deref_slot(slots[i]);
+			if (unlikely(!page))
+				continue;
+			if (radix_tree_deref_retry(page)) {
+				start = indices[i];
+				goto restart;
+			}
+			/* shadow entry of an evicted page */
+			if (radix_tree_exceptional_entry(page))
+				continue;
 
-		if (!page_cache_get_speculative(page))
-			goto repeat;
+			if (!page_cache_get_speculative(page))
+				goto repeat;
 
-		/* Has the page moved? */
-		if (unlikely(page != *((void **)pages[i]))) {
-			page_cache_release(page);
-			goto repeat;
-		}
+			/* Has the page moved? */
+			if (unlikely(page != *slots[i])) {
+				page_cache_release(page);
+				goto repeat;
+			}
 
-		pages[ret] = page;
-		ret++;
+			pages[ret] = page;
+			ret++;
+		}
+		start = indices[nr_found - 1] + 1;
+		if (!start)
+			break;
 	}
 	rcu_read_unlock();
 	return ret;
@@ -811,7 +910,7 @@ unsigned find_get_pages_contig(struct address_space *mapping, pgoff_t index,
 	rcu_read_lock();
 restart:
 	nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
-				(void ***)pages, index, nr_pages);
+				(void ***)pages, NULL, index, nr_pages);
 	ret = 0;
 	for (i = 0; i < nr_found; i++) {
 		struct page *page;
@@ -821,6 +920,9 @@ repeat:
 			continue;
 		if (radix_tree_deref_retry(page))
 			goto restart;
+		/* a shadow entry is a hole */
+		if (radix_tree_exceptional_entry(page))
+			break;
 
 		if (!page_cache_get_speculative(page))
 			goto repeat;
@@ -881,6 +983,9 @@ repeat:
 			continue;
 		if (radix_tree_deref_retry(page))
 			goto restart;
+		/* the page was evicted since the lookup */
+		if (radix_tree_exceptional_entry(page))
+			continue;
 
 		if (!page_cache_get_speculative(page))
 			goto repeat;
@@ -1633,8 +1738,103 @@ page_not_uptodate:
 }
 EXPORT_SYMBOL(filemap_fault);
 
+/**
+ * filemap_map_pages - map the cached pages around a read fault
+ * @vma:	vma in which the fault was taken
+ * @vmf:	struct vm_fault with the window to map
+ *
+ * Maps the pages from @vmf->pgoff to @vmf->max_pgoff that are uptodate in
+ * the page cache and whose ptes are still empty.  Called with the page
+ * table lock held, so nothing here blocks: pages that are locked, being
+ * read or flagged for async readahead are left to filemap_fault().
+ */
+void filemap_map_pages(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	struct file *file = vma->vm_file;
+	struct address_space *mapping = file->f_mapping;
+	struct file_ra_state *ra = &file->f_ra;
+	unsigned long address = (unsigned long)vmf->virtual_address;
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	pgoff_t index = vmf->pgoff;
+	pgoff_t size;
+	unsigned int i, nr_found;
+	struct page *page;
+	pte_t *pte;
+
+	size = (i_size_read(mapping->host) + PAGE_CACHE_SIZE - 1) >>
+		PAGE_CACHE_SHIFT;
+
+	rcu_read_lock();
+	while (index <= vmf->max_pgoff) {
+restart:
+		nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
+				slots, indices, index,
+				min_t(unsigned long, vmf->max_pgoff - index + 1,
+				      PAGEVEC_SIZE));
+		if (!nr_found)
+			break;
+		for (i = 0; i < nr_found; i++) {
+			if (indices[i] > vmf->max_pgoff)
+				goto out;
+repeat:
+			page = radix_tree_deref_slot(slots[i]);
+			if (unlikely(!page))
+				continue;
+			if (radix_tree_deref_retry(page)) {
+				index = indices[i];
+				goto restart;
+			}
+			/* shadow entry of an evicted page */
+			if (radix_tree_exceptional_entry(page))
+				continue;
+
+			if (!page_cache_get_speculative(page))
+				goto repeat;
+
+			/* Has the page moved? */
+			if (unlikely(page != *slots[i])) {
+				page_cache_release(page);
+				goto repeat;
+			}
+
+			if (!PageUptodate(page) || PageReadahead(page) ||
+			    PageHWPoison(page))
+				goto skip;
+			if (!trylock_page(page))
+				goto skip;
+			if (page->mapping != mapping || !PageUptodate(page) ||
+			    page->index >= size)
+				goto unlock;
+
+			pte = vmf->pte + page->index - vmf->pgoff;
+			if (!pte_none(*pte))
+				goto unlock;
+
+			if (ra->mmap_miss > 0)
+				ra->mmap_miss--;
+			map_file_pte(vma, address +
+				     (page->index - vmf->pgoff) * PAGE_SIZE,
+				     page, pte);
+			unlock_page(page);
+			continue;
+unlock:
+			unlock_page(page);
+skip:
+			page_cache_release(page);
+		}
+		index = indices[nr_found - 1] + 1;
+		if (!index)
+			break;
+	}
+out:
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(filemap_map_pages);
+
 const struct vm_operations_struct generic_file_vm_ops = {
 	.fault		= filemap_fault,
+	.map_pages	= filemap_map_pages,
 };
 
 /* This is used for a general mmap of a disk file */
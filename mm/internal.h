@@ -16,6 +16,9 @@
 void free_pgtables(struct mmu_gather *tlb, struct vm_area_struct *start_vma,
 		unsigned long floor, unsigned long ceiling);
 
+void map_file_pte(struct vm_area_struct *vma, unsigned long address,
+		struct page *page, pte_t *pte);
+
 static inline void set_page_count(struct page *page, int v)
 {
 	atomic_set(&page->_count, v);
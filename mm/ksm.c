@@ -127,6 +127,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @age: number of scans this page has been through without being merged
+ * @remaining_skips: how many more scans are to skip this page
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -137,6 +139,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned char age;		/* scans since last merged */
+	unsigned char remaining_skips;	/* scans left to skip it for */
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -187,6 +191,41 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Upper bound of the adaptive batch size, 0 to scan pages_to_scan only */
+static unsigned int ksm_thread_max_pages_to_scan;
+
+/* Current batch size, adapted to the yield of the last full scan */
+static unsigned int ksm_thread_cur_pages_to_scan = 100;
+
+/* Whether to skip pages which have not been merged for several scans */
+static unsigned int ksm_smart_scan = 1;
+
+/* The number of pages ksmd has compared against the trees */
+static unsigned long ksm_pages_scanned;
+
+/* The number of pages ksmd has skipped as unlikely to be merged */
+static unsigned long ksm_pages_skipped;
+
+/* The number of pages ksmd has merged */
+static unsigned long ksm_pages_merged;
+
+/* Pages scanned per page merged in the last full scan, 0 if none merged */
+static unsigned long ksm_scanned_per_merged;
+
+/* Counters at the start of the current full scan */
+static unsigned long ksm_scan_start_scanned;
+static unsigned long ksm_scan_start_merged;
+
+/*
+ * A full scan merging a page every KSM_YIELD_GOOD pages scanned or better
+ * doubles the batch size, one worse than KSM_YIELD_POOR halves it.
+ */
+#define KSM_YIELD_GOOD	64
+#define KSM_YIELD_POOR	1024
+
+/* Most scans a page not merged for a long time gets skipped for */
+#define KSM_MAX_SKIPS	8
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -1103,6 +1142,10 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 	rmap_item->address |= STABLE_FLAG;
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
 
+	rmap_item->age = 0;
+	rmap_item->remaining_skips = 0;
+	ksm_pages_merged++;
+
 	if (rmap_item->hlist.next)
 		ksm_pages_sharing++;
 	else
@@ -1222,6 +1265,88 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * should_skip_rmap_item - back off from scanning a page which keeps on
+ * not being merged: after a few scans it is only looked at every other
+ * scan, then every fourth, up to every KSM_MAX_SKIPS+1th scan.  Merging
+ * it resets that.
+ */
+static bool should_skip_rmap_item(struct page *page,
+				  struct rmap_item *rmap_item)
+{
+	unsigned char age;
+
+	if (!ksm_smart_scan)
+		return false;
+
+	/* cmp_and_merge_page() leaves those alone, but they must be seen */
+	if (PageKsm(page))
+		return false;
+
+	age = rmap_item->age;
+	if (age != (unsigned char)~0U)
+		rmap_item->age++;
+
+	/* Give a new page time to go through the unstable tree first */
+	if (age < 3)
+		return false;
+
+	if (!rmap_item->remaining_skips) {
+		if (age <= 3)
+			rmap_item->remaining_skips = 1;
+		else if (age <= 5)
+			rmap_item->remaining_skips = 2;
+		else if (age <= 8)
+			rmap_item->remaining_skips = 4;
+		else
+			rmap_item->remaining_skips = KSM_MAX_SKIPS;
+		return false;
+	}
+
+	rmap_item->remaining_skips--;
+	/* It would be left over from a previous scan in the unstable tree */
+	remove_rmap_item_from_tree(rmap_item);
+	ksm_pages_skipped++;
+	return true;
+}
+
+/*
+ * ksm_scan_done - account the yield of the full scan just completed, and
+ * adapt the batch size to it when max_pages_to_scan allows.
+ */
+static void ksm_scan_done(void)
+{
+	unsigned long scanned, merged;
+	unsigned int min_pages, max_pages, cur;
+
+	scanned = ksm_pages_scanned - ksm_scan_start_scanned;
+	merged = ksm_pages_merged - ksm_scan_start_merged;
+	ksm_scan_start_scanned = ksm_pages_scanned;
+	ksm_scan_start_merged = ksm_pages_merged;
+	ksm_scanned_per_merged = merged ? DIV_ROUND_UP(scanned, merged) : 0;
+
+	min_pages = ksm_thread_pages_to_scan;
+	max_pages = ksm_thread_max_pages_to_scan;
+	if (max_pages <= min_pages)
+		return;
+
+	cur = clamp(ksm_thread_cur_pages_to_scan, min_pages, max_pages);
+	if (merged && ksm_scanned_per_merged <= KSM_YIELD_GOOD)
+		cur = cur > max_pages / 2 ? max_pages : cur * 2;
+	else if (!merged || ksm_scanned_per_merged > KSM_YIELD_POOR)
+		cur = max(cur / 2, min_pages);
+	ksm_thread_cur_pages_to_scan = cur;
+}
+
+/* Number of pages ksmd should scan in its next batch */
+static unsigned int ksm_scan_batch(void)
+{
+	if (ksm_thread_max_pages_to_scan <= ksm_thread_pages_to_scan)
+		return ksm_thread_pages_to_scan;
+	return clamp(ksm_thread_cur_pages_to_scan,
+		     ksm_thread_pages_to_scan, ksm_thread_max_pages_to_scan);
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1290,12 +1415,16 @@ next_mm:
 				if (rmap_item) {
 					ksm_scan.rmap_list =
 							&rmap_item->rmap_list;
+					if (should_skip_rmap_item(*page,
+								  rmap_item))
+						goto next_page;
 					ksm_scan.address += PAGE_SIZE;
 				} else
 					put_page(*page);
 				up_read(&mm->mmap_sem);
 				return rmap_item;
 			}
+next_page:
 			if (!IS_ERR_OR_NULL(*page))
 				put_page(*page);
 			ksm_scan.address += PAGE_SIZE;
@@ -1345,6 +1474,7 @@ next_mm:
 		goto next_mm;
 
 	ksm_scan.seqnr++;
+	ksm_scan_done();
 	return NULL;
 }
 
@@ -1362,6 +1492,7 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
+		ksm_pages_scanned++;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
@@ -1380,7 +1511,7 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_do_scan(ksm_scan_batch());
 		mutex_unlock(&ksm_thread_mutex);
 
 		if (ksmd_should_run()) {
@@ -1814,6 +1945,59 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t max_pages_to_scan_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_max_pages_to_scan);
+}
+
+static ssize_t max_pages_to_scan_store(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       const char *buf, size_t count)
+{
+	int err;
+	unsigned long nr_pages;
+
+	err = strict_strtoul(buf, 10, &nr_pages);
+	if (err || nr_pages > UINT_MAX)
+		return -EINVAL;
+
+	ksm_thread_max_pages_to_scan = nr_pages;
+
+	return count;
+}
+KSM_ATTR(max_pages_to_scan);
+
+static ssize_t cur_pages_to_scan_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_scan_batch());
+}
+KSM_ATTR_RO(cur_pages_to_scan);
+
+static ssize_t smart_scan_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_smart_scan);
+}
+
+static ssize_t smart_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	int err;
+	unsigned long enable;
+
+	err = strict_strtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_smart_scan = enable;
+
+	return count;
+}
+KSM_ATTR(smart_scan);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1906,15 +2090,50 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scanned_per_merged_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_scanned_per_merged);
+}
+KSM_ATTR_RO(scanned_per_merged);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&max_pages_to_scan_attr.attr,
+	&cur_pages_to_scan_attr.attr,
+	&smart_scan_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_skipped_attr.attr,
+	&pages_merged_attr.attr,
+	&scanned_per_merged_attr.attr,
 	NULL,
 };
 
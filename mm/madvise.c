@@ -13,6 +13,14 @@
 #include <linux/hugetlb.h>
 #include <linux/sched.h>
 #include <linux/ksm.h>
+#include <linux/swap.h>
+#include <linux/swapops.h>
+#include <linux/mmu_notifier.h>
+#include <linux/pagevec.h>
+
+#include <asm/tlbflush.h>
+
+#include "internal.h"
 
 /*
  * Any behaviour which results in changes to the vma->vm_flags needs to
@@ -25,6 +33,7 @@ static int madvise_need_mmap_write(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+	case MADV_FREE:
 		return 0;
 	default:
 		/* be safe, default to 1. list exceptions explicitly */
@@ -177,6 +186,153 @@ static long madvise_dontneed(struct vm_area_struct * vma,
 	return 0;
 }
 
+static int madvise_free_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->private;
+	struct mm_struct *mm = walk->mm;
+	struct page *pages[PAGEVEC_SIZE];
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	int nr_swap = 0;
+	int nr_pages = 0;
+	int i;
+
+again:
+	orig_pte = pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	arch_enter_lazy_mmu_mode();
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+
+		if (pte_none(ptent))
+			continue;
+
+		/* The swapped out copy is not needed any more */
+		if (!pte_present(ptent)) {
+			swp_entry_t entry;
+
+			if (pte_file(ptent))
+				continue;
+			entry = pte_to_swp_entry(ptent);
+			if (non_swap_entry(entry))
+				continue;
+			nr_swap--;
+			free_swap_and_cache(entry);
+			pte_clear_not_present_full(mm, addr, pte, 0);
+			continue;
+		}
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || PageKsm(page))
+			continue;
+
+		/* Leave pages shared with another process (after fork) alone */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		/*
+		 * Drop the swap cache copy, and the dirty bit that tells
+		 * reclaim the page must be written out.
+		 */
+		if (PageSwapCache(page) || PageDirty(page)) {
+			if (!trylock_page(page))
+				continue;
+			if (PageSwapCache(page) && !try_to_free_swap(page)) {
+				unlock_page(page);
+				continue;
+			}
+			ClearPageDirty(page);
+			unlock_page(page);
+		}
+
+		/*
+		 * A write from now on dirties the pte again, which keeps
+		 * the page from being dropped by reclaim.
+		 */
+		if (pte_young(ptent) || pte_dirty(ptent)) {
+			ptent = ptep_get_and_clear_full(mm, addr, pte, 0);
+			ptent = pte_mkold(ptent);
+			ptent = pte_mkclean(ptent);
+			set_pte_at(mm, addr, pte, ptent);
+		}
+
+		/* Move active pages to the inactive list, after unlocking */
+		if (PageActive(page)) {
+			get_page(page);
+			pages[nr_pages++] = page;
+			if (nr_pages == PAGEVEC_SIZE) {
+				addr += PAGE_SIZE;
+				pte++;
+				break;
+			}
+		}
+	}
+
+	if (nr_swap)
+		add_mm_counter(mm, MM_SWAPENTS, nr_swap);
+	nr_swap = 0;
+	arch_leave_lazy_mmu_mode();
+	pte_unmap_unlock(orig_pte, ptl);
+
+	for (i = 0; i < nr_pages; i++) {
+		page = pages[i];
+		if (!isolate_lru_page(page)) {
+			ClearPageActive(page);
+			putback_lru_page(page);
+		}
+		put_page(page);
+	}
+	cond_resched();
+	if (nr_pages == PAGEVEC_SIZE && addr != end) {
+		nr_pages = 0;
+		goto again;
+	}
+	return 0;
+}
+
+/*
+ * Application no longer needs the contents of the given anonymous pages,
+ * but may reuse the range soon.  Unlike MADV_DONTNEED, the pages stay
+ * mapped: reclaim drops them only if memory gets short, instead of
+ * swapping them out, and a write before that just keeps the page and
+ * its contents.  Until written, a page reads back either its old
+ * contents or zeroes, once reclaimed.
+ *
+ * Pages can only be dropped once they are in the swap cache, so without
+ * swap this behaves like MADV_DONTNEED.
+ */
+static long madvise_free(struct vm_area_struct *vma,
+			 struct vm_area_struct **prev,
+			 unsigned long start, unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct mm_walk free_walk = {
+		.pmd_entry = madvise_free_pte_range,
+		.mm = mm,
+		.private = vma,
+	};
+
+	*prev = vma;
+	if (vma->vm_flags & (VM_LOCKED|VM_HUGETLB|VM_PFNMAP))
+		return -EINVAL;
+
+	/* Only private anonymous memory, for now */
+	if (vma->vm_ops || vma->vm_file)
+		return -EINVAL;
+
+	if (nr_swap_pages <= 0)
+		return madvise_dontneed(vma, prev, start, end);
+
+	/* So that isolate_lru_page() finds the pages on the LRU */
+	lru_add_drain();
+	mmu_notifier_invalidate_range_start(mm, start, end);
+	walk_page_range(start, end, &free_walk);
+	flush_tlb_range(vma, start, end);
+	mmu_notifier_invalidate_range_end(mm, start, end);
+	return 0;
+}
+
 /*
  * Application wants to free up the pages and associated backing store.
  * This is effectively punching a hole into the middle of a file.
@@ -262,6 +418,8 @@ madvise_vma(struct vm_area_struct *vma, struct vm_area_struct **prev,
 		return madvise_willneed(vma, prev, start, end);
 	case MADV_DONTNEED:
 		return madvise_dontneed(vma, prev, start, end);
+	case MADV_FREE:
+		return madvise_free(vma, prev, start, end);
 	default:
 		return madvise_behavior(vma, prev, start, end, behavior);
 	}
@@ -279,6 +437,7 @@ madvise_behavior_valid(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+	case MADV_FREE:
 #ifdef CONFIG_KSM
 	case MADV_MERGEABLE:
 	case MADV_UNMERGEABLE:
@@ -312,6 +471,9 @@ madvise_behavior_valid(int behavior)
  *		some pages ahead.
  *  MADV_DONTNEED - the application is finished with the given range,
  *		so the kernel can free resources associated with it.
+ *  MADV_FREE - the application is finished with the contents of the given
+ *		anonymous range, so the kernel can free the pages if memory
+ *		gets short, unless they are written to again first.
  *  MADV_REMOVE - the application wants to free up the given range of
  *		pages and associated backing store.
  *  MADV_DONTFORK - omit this area from child's address space when forking:
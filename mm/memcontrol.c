@@ -48,6 +48,7 @@
 #include <linux/page_cgroup.h>
 #include <linux/cpu.h>
 #include <linux/oom.h>
+#include <linux/workqueue.h>
 #include "internal.h"
 
 #include <asm/uaccess.h>
@@ -89,6 +90,8 @@ enum mem_cgroup_stat_index {
 	MEM_CGROUP_STAT_PGPGIN_COUNT,	/* # of pages paged in */
 	MEM_CGROUP_STAT_PGPGOUT_COUNT,	/* # of pages paged out */
 	MEM_CGROUP_STAT_SWAPOUT, /* # of pages, swapped out */
+	MEM_CGROUP_STAT_PGRECLAIM_BG,	/* # of pages reclaimed in background */
+	MEM_CGROUP_STAT_PGRECLAIM_DIRECT, /* # of pages reclaimed on charge */
 	MEM_CGROUP_EVENTS,	/* incremented at every  pagein/pageout */
 
 	MEM_CGROUP_STAT_NSTATS,
@@ -250,6 +253,11 @@ struct mem_cgroup {
 	 * mem_cgroup ? And what type of charges should we move ?
 	 */
 	unsigned long 	move_charge_at_immigrate;
+	/*
+	 * Reclaims in the background once usage is above res.high_wmark,
+	 * until it is back down to res.low_wmark.
+	 */
+	struct work_struct bgreclaim_work;
 	/*
 	 * percpu counter.
 	 */
@@ -338,11 +346,14 @@ enum charge_type {
 #define MEM_CGROUP_RECLAIM_SHRINK	(1 << MEM_CGROUP_RECLAIM_SHRINK_BIT)
 #define MEM_CGROUP_RECLAIM_SOFT_BIT	0x2
 #define MEM_CGROUP_RECLAIM_SOFT		(1 << MEM_CGROUP_RECLAIM_SOFT_BIT)
+#define MEM_CGROUP_RECLAIM_BG_BIT	0x3
+#define MEM_CGROUP_RECLAIM_BG		(1 << MEM_CGROUP_RECLAIM_BG_BIT)
 
 static void mem_cgroup_get(struct mem_cgroup *mem);
 static void mem_cgroup_put(struct mem_cgroup *mem);
 static struct mem_cgroup *parent_mem_cgroup(struct mem_cgroup *mem);
 static void drain_all_stock_async(void);
+static void mem_cgroup_check_wmark(struct mem_cgroup *mem);
 
 static struct mem_cgroup_per_zone *
 mem_cgroup_zoneinfo(struct mem_cgroup *mem, int nid, int zid)
@@ -613,6 +624,7 @@ static void memcg_check_events(struct mem_cgroup *mem, struct page *page)
 	/* threshold event is triggered in finer grain than soft limit */
 	if (unlikely(__memcg_event_check(mem, THRESHOLDS_EVENTS_THRESH))) {
 		mem_cgroup_threshold(mem);
+		mem_cgroup_check_wmark(mem);
 		if (unlikely(__memcg_event_check(mem, SOFTLIMIT_EVENTS_THRESH)))
 			mem_cgroup_update_tree(mem, page);
 	}
@@ -1258,6 +1270,7 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 	bool noswap = reclaim_options & MEM_CGROUP_RECLAIM_NOSWAP;
 	bool shrink = reclaim_options & MEM_CGROUP_RECLAIM_SHRINK;
 	bool check_soft = reclaim_options & MEM_CGROUP_RECLAIM_SOFT;
+	bool background = reclaim_options & MEM_CGROUP_RECLAIM_BG;
 	unsigned long excess = mem_cgroup_get_excess(root_mem);
 
 	/* If memsw_is_minimum==1, swap-out is of-no-use. */
@@ -1305,6 +1318,10 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 		else
 			ret = try_to_free_mem_cgroup_pages(victim, gfp_mask,
 						noswap, get_swappiness(victim));
+		if (!check_soft)
+			this_cpu_add(victim->stat->count[background ?
+					MEM_CGROUP_STAT_PGRECLAIM_BG :
+					MEM_CGROUP_STAT_PGRECLAIM_DIRECT], ret);
 		css_put(&victim->css);
 		/*
 		 * At shrinking usage, we can't check we should stop here or
@@ -1323,6 +1340,72 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 	return total;
 }
 
+/*
+ * Background reclaim: when the usage of a memcg goes above its high
+ * watermark, reclaim from it asynchronously until the usage is back down
+ * to its low watermark, so that charges do not stall in direct reclaim
+ * when it hits its limit.  The work items run on an unbound workqueue and
+ * hold a css reference while queued.
+ */
+static struct workqueue_struct *memcg_bgreclaim_wq;
+
+static void mem_cgroup_bgreclaim(struct work_struct *work)
+{
+	struct mem_cgroup *mem = container_of(work, struct mem_cgroup,
+					      bgreclaim_work);
+	int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
+
+	while (!res_counter_check_under_low_wmark(&mem->res)) {
+		if (!mem_cgroup_hierarchical_reclaim(mem, NULL, GFP_KERNEL,
+				MEM_CGROUP_RECLAIM_SHRINK |
+				MEM_CGROUP_RECLAIM_BG)) {
+			/* nothing reclaimable, leave it to direct reclaim */
+			if (!--nr_retries)
+				break;
+		}
+		cond_resched();
+	}
+	css_put(&mem->css);
+}
+
+/*
+ * Called from memcg_check_events(); with use_hierarchy, charging a memcg
+ * also raises the usage of its ancestors.
+ */
+static void mem_cgroup_check_wmark(struct mem_cgroup *mem)
+{
+	if (!memcg_bgreclaim_wq)
+		return;
+
+	for (; mem; mem = parent_mem_cgroup(mem)) {
+		if (work_pending(&mem->bgreclaim_work))
+			continue;
+		if (!res_counter_check_over_high_wmark(&mem->res))
+			continue;
+		css_get(&mem->css);
+		if (!queue_work(memcg_bgreclaim_wq, &mem->bgreclaim_work))
+			css_put(&mem->css);
+	}
+}
+
+/*
+ * The root memcg is created from cgroup_init(), before workqueues and
+ * kthreadd are up, so the workqueue is allocated later on.  Until then,
+ * memcgs are not checked against their watermarks.
+ */
+static int __init memcg_bgreclaim_init(void)
+{
+	if (mem_cgroup_disabled())
+		return 0;
+
+	memcg_bgreclaim_wq = alloc_workqueue("memcg_bgreclaim",
+					     WQ_UNBOUND | WQ_RESCUER, 0);
+	if (!memcg_bgreclaim_wq)
+		printk(KERN_WARNING "memcg: background reclaim is disabled\n");
+	return 0;
+}
+module_init(memcg_bgreclaim_init);
+
 static int mem_cgroup_oom_lock_cb(struct mem_cgroup *mem, void *data)
 {
 	int *val = (int *)data;
@@ -3257,6 +3340,21 @@ static int mem_cgroup_write(struct cgroup *cont, struct cftype *cft,
 		else
 			ret = -EINVAL;
 		break;
+	case RES_HIGH_WMARK:
+	case RES_LOW_WMARK:
+		/* As for the limit, the root cgroup has no watermarks */
+		if (mem_cgroup_is_root(memcg) || type != _MEM) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = res_counter_memparse_write_strategy(buffer, &val);
+		if (ret)
+			break;
+		if (name == RES_HIGH_WMARK)
+			ret = res_counter_set_high_wmark(&memcg->res, val);
+		else
+			ret = res_counter_set_low_wmark(&memcg->res, val);
+		break;
 	default:
 		ret = -EINVAL; /* should be BUG() ? */
 		break;
@@ -3360,6 +3458,8 @@ enum {
 	MCS_PGPGIN,
 	MCS_PGPGOUT,
 	MCS_SWAP,
+	MCS_PGRECLAIM_BG,
+	MCS_PGRECLAIM_DIRECT,
 	MCS_INACTIVE_ANON,
 	MCS_ACTIVE_ANON,
 	MCS_INACTIVE_FILE,
@@ -3382,6 +3482,8 @@ struct {
 	{"pgpgin", "total_pgpgin"},
 	{"pgpgout", "total_pgpgout"},
 	{"swap", "total_swap"},
+	{"pgreclaim_background", "total_pgreclaim_background"},
+	{"pgreclaim_direct", "total_pgreclaim_direct"},
 	{"inactive_anon", "total_inactive_anon"},
 	{"active_anon", "total_active_anon"},
 	{"inactive_file", "total_inactive_file"},
@@ -3410,6 +3512,10 @@ static int mem_cgroup_get_local_stat(struct mem_cgroup *mem, void *data)
 		val = mem_cgroup_read_stat(mem, MEM_CGROUP_STAT_SWAPOUT);
 		s->stat[MCS_SWAP] += val * PAGE_SIZE;
 	}
+	val = mem_cgroup_read_stat(mem, MEM_CGROUP_STAT_PGRECLAIM_BG);
+	s->stat[MCS_PGRECLAIM_BG] += val;
+	val = mem_cgroup_read_stat(mem, MEM_CGROUP_STAT_PGRECLAIM_DIRECT);
+	s->stat[MCS_PGRECLAIM_DIRECT] += val;
 
 	/* per zone stat */
 	val = mem_cgroup_get_local_zonestat(mem, LRU_INACTIVE_ANON);
@@ -3889,6 +3995,18 @@ static struct cftype mem_cgroup_files[] = {
 		.write_string = mem_cgroup_write,
 		.read_u64 = mem_cgroup_read,
 	},
+	{
+		.name = "high_wmark_in_bytes",
+		.private = MEMFILE_PRIVATE(_MEM, RES_HIGH_WMARK),
+		.write_string = mem_cgroup_write,
+		.read_u64 = mem_cgroup_read,
+	},
+	{
+		.name = "low_wmark_in_bytes",
+		.private = MEMFILE_PRIVATE(_MEM, RES_LOW_WMARK),
+		.write_string = mem_cgroup_write,
+		.read_u64 = mem_cgroup_read,
+	},
 	{
 		.name = "failcnt",
 		.private = MEMFILE_PRIVATE(_MEM, RES_FAILCNT),
@@ -4183,6 +4301,7 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	mem->last_scanned_child = 0;
 	spin_lock_init(&mem->reclaim_param_lock);
 	INIT_LIST_HEAD(&mem->oom_notify);
+	INIT_WORK(&mem->bgreclaim_work, mem_cgroup_bgreclaim);
 
 	if (parent)
 		mem->swappiness = get_swappiness(parent);
@@ -4201,6 +4320,10 @@ static int mem_cgroup_pre_destroy(struct cgroup_subsys *ss,
 {
 	struct mem_cgroup *mem = mem_cgroup_from_cont(cont);
 
+	/* A queued background reclaim holds a reference on the css */
+	if (cancel_work_sync(&mem->bgreclaim_work))
+		css_put(&mem->css);
+
 	return mem_cgroup_force_empty(mem, false);
 }
 
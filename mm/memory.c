@@ -2646,11 +2646,11 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
-	page = lookup_swap_cache(entry);
+	page = lookup_swap_cache(entry, vma, address);
 	if (!page) {
 		grab_swap_token(mm); /* Contend for token _before_ read-in */
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+		page = swap_vma_readahead(entry,
+					GFP_HIGHUSER_MOVABLE, vma, address, pmd);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -3083,14 +3083,110 @@ unwritable_page:
 	return ret;
 }
 
+/*
+ * Read faults on file mappings map the pages around the faulting address
+ * which are already in the page cache, so that they don't each take a
+ * fault of their own.  The window is aligned to its size, is at most one
+ * page table, and fault-around is off if it is a single page.
+ */
+unsigned long sysctl_fault_around_bytes __read_mostly = 65536;
+
+static unsigned long fault_around_pages(void)
+{
+	unsigned long nr_pages = sysctl_fault_around_bytes >> PAGE_SHIFT;
+
+	if (nr_pages <= 1)
+		return 1;
+	return min_t(unsigned long, rounddown_pow_of_two(nr_pages),
+		     PTRS_PER_PTE);
+}
+
+/*
+ * Install a read-only pte for a page cache page, for ->map_pages().
+ * The caller holds the page table lock, the page lock and a reference
+ * to the page, which the pte takes over.
+ */
+void map_file_pte(struct vm_area_struct *vma, unsigned long address,
+		struct page *page, pte_t *pte)
+{
+	pte_t entry;
+
+	flush_icache_page(vma, page);
+	entry = mk_pte(page, vma->vm_page_prot);
+	inc_mm_counter_fast(vma->vm_mm, MM_FILEPAGES);
+	page_add_file_rmap(page);
+	set_pte_at(vma->vm_mm, address, pte, entry);
+
+	/* no need to invalidate: a not-present page won't be cached */
+	update_mmu_cache(vma, address, pte);
+}
+
+/*
+ * Called with the pte of @address mapped and locked.  Hands the empty
+ * ptes of the fault-around window to ->map_pages().
+ */
+static void do_fault_around(struct vm_area_struct *vma, unsigned long address,
+		pte_t *pte, pgoff_t pgoff, unsigned int flags,
+		unsigned long nr_pages)
+{
+	unsigned long start_addr, max_pgoff;
+	struct vm_fault vmf;
+	int off;
+
+	start_addr = max(address & ~(nr_pages * PAGE_SIZE - 1),
+			 vma->vm_start);
+	off = ((address - start_addr) >> PAGE_SHIFT) & (PTRS_PER_PTE - 1);
+	pte -= off;
+	pgoff -= off;
+
+	/* End of the window, of the vma or of the page table: nearest wins */
+	max_pgoff = pgoff - ((start_addr >> PAGE_SHIFT) & (PTRS_PER_PTE - 1)) +
+		PTRS_PER_PTE - 1;
+	max_pgoff = min(max_pgoff, vma_pages(vma) + vma->vm_pgoff - 1);
+	max_pgoff = min(max_pgoff, pgoff + nr_pages - 1);
+
+	/* Skip the ptes already populated at the start of the window */
+	while (!pte_none(*pte)) {
+		if (++pgoff > max_pgoff)
+			return;
+		start_addr += PAGE_SIZE;
+		if (start_addr >= vma->vm_end)
+			return;
+		pte++;
+	}
+
+	vmf.virtual_address = (void __user *)start_addr;
+	vmf.pte = pte;
+	vmf.pgoff = pgoff;
+	vmf.max_pgoff = max_pgoff;
+	vmf.flags = flags;
+	vma->vm_ops->map_pages(vma, &vmf);
+}
+
 static int do_linear_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned long address, pte_t *page_table, pmd_t *pmd,
 		unsigned int flags, pte_t orig_pte)
 {
 	pgoff_t pgoff = (((address & PAGE_MASK)
 			- vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
+	unsigned long nr_pages;
+	spinlock_t *ptl;
+	int mapped;
 
 	pte_unmap(page_table);
+
+	nr_pages = fault_around_pages();
+	if (!(flags & FAULT_FLAG_WRITE) && vma->vm_ops->map_pages &&
+	    nr_pages > 1) {
+		page_table = pte_offset_map_lock(mm, pmd, address, &ptl);
+		do_fault_around(vma, address, page_table, pgoff, flags,
+				nr_pages);
+		mapped = !pte_same(*page_table, orig_pte);
+		pte_unmap_unlock(page_table, ptl);
+		if (mapped)
+			return 0;
+	}
+
 	return __do_fault(mm, vma, address, pmd, pgoff, flags, orig_pte);
 }
 
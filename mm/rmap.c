@@ -1027,6 +1027,17 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 		swp_entry_t entry = { .val = page_private(page) };
 
 		if (PageSwapCache(page)) {
+			/*
+			 * A page freed with MADV_FREE and not written since
+			 * has nothing worth keeping: drop it, unless another
+			 * mapping has been given the swap entry already.
+			 */
+			if ((flags & TTU_FREE) && !PageDirty(page) &&
+			    page_mapcount(page) == 1) {
+				dec_mm_counter(mm, MM_ANONPAGES);
+				count_vm_event(PGLAZYFREED);
+				goto discard;
+			}
 			/*
 			 * Store the swap location in the pte.
 			 * See handle_pte_fault() ...
@@ -1036,6 +1047,9 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 				ret = SWAP_FAIL;
 				goto out_unmap;
 			}
+			/* The swap entry now holds the data: write it out */
+			if (flags & TTU_FREE)
+				SetPageDirty(page);
 			if (list_empty(&mm->mmlist)) {
 				spin_lock(&mmlist_lock);
 				if (list_empty(&mm->mmlist))
@@ -1063,6 +1077,7 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 	} else
 		dec_mm_counter(mm, MM_FILEPAGES);
 
+discard:
 	page_remove_rmap(page);
 	page_cache_release(page);
 
@@ -1284,7 +1284,7 @@ repeat:
 
 	if (swap.val) {
 		/* Look it up and read it in.. */
-		swappage = lookup_swap_cache(swap);
+		swappage = lookup_swap_cache(swap, NULL, 0);
 		if (!swappage) {
 			shmem_swp_unmap(entry);
 			/* here we actually do the io */
@@ -166,13 +166,13 @@ int add_to_swap(struct page *page)
 	 * deadlock in the swap out path.
 	 */
 	/*
-	 * Add it to the swap cache and mark it dirty
+	 * Add it to the swap cache.  The caller marks it dirty, unless it
+	 * may be a page freed with MADV_FREE: see shrink_page_list().
 	 */
 	err = add_to_swap_cache(page, entry,
 			__GFP_HIGH|__GFP_NOMEMALLOC|__GFP_NOWARN);
 
 	if (!err) {	/* Success */
-		SetPageDirty(page);
 		return 1;
 	} else {	/* -ENOMEM radix-tree allocation failure */
 		/*
@@ -251,37 +251,78 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * Swap readahead by virtual address.  vma->swap_readahead_info packs the
+ * address of the last swap fault in the vma, the readahead window used
+ * for it and the number of readahead pages faulted in since.
+ */
+int sysctl_swap_vma_readahead __read_mostly = 1;
+
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Largest window, bounded by the ptes copied on the stack */
+#define SWAP_RA_ORDER_MAX	5
+#define SWAP_RA_WIN_MAX		(1 << SWAP_RA_ORDER_MAX)
+
+static void swap_ra_hit(struct vm_area_struct *vma, unsigned long addr)
+{
+	unsigned long ra_val = atomic_long_read(&vma->swap_readahead_info);
+	unsigned long hits = SWAP_RA_HITS(ra_val);
+
+	if (hits < SWAP_RA_HITS_MAX)
+		hits++;
+	atomic_long_set(&vma->swap_readahead_info,
+			SWAP_RA_VAL(addr, SWAP_RA_WIN(ra_val), hits));
+}
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
- * lock before returning.
+ * lock before returning.  @vma and @addr, when known, are those of the
+ * fault that wants the page, and credit it with a readahead hit.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page * lookup_swap_cache(swp_entry_t entry,
+			struct vm_area_struct *vma, unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		/* PG_readahead is PG_reclaim while under writeback */
+		if (!PageWriteback(page) && TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			if (vma)
+				swap_ra_hit(vma, addr);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
 }
 
-/* 
- * Locate a page of swap in physical memory, reserving swap cache space
- * and reading the disk if it is not already cached.
- * A failure return means that either the page allocation failed or that
- * the swap entry is no longer in use.
- */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool *new_page_allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_allocated = false;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -332,6 +373,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*new_page_allocated = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -349,6 +391,31 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+/* 
+ * Locate a page of swap in physical memory, reserving swap cache space
+ * and reading the disk if it is not already cached.
+ * A failure return means that either the page allocation failed or that
+ * the swap entry is no longer in use.
+ */
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool new_page_allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_allocated);
+}
+
+/* Marks a page read ahead, for lookup_swap_cache() to count the hit */
+static void swap_ra_page(struct page *page, bool new_page_allocated)
+{
+	if (new_page_allocated) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -375,6 +442,7 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
+	bool new_page_allocated;
 
 	/*
 	 * Get starting offset for readaround, and number of pages to read.
@@ -386,12 +454,132 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
+		page = __read_swap_cache_async(swp_entry(swp_type(entry), offset),
+						gfp_mask, vma, addr,
+						&new_page_allocated);
 		if (!page)
 			break;
-		page_cache_release(page);
+		if (offset == swp_offset(entry)) {
+			page_cache_release(page);
+			continue;
+		}
+		swap_ra_page(page, new_page_allocated);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * Number of pages to read around a swap fault at @pfn: grow the window
+ * with the readahead hits since the previous fault at @prev_pfn, and only
+ * start one without hits if the two faults are next to each other.
+ */
+static unsigned int swap_ra_window(unsigned long pfn, unsigned long prev_pfn,
+				   unsigned int hits, unsigned int max_win,
+				   unsigned int prev_win)
+{
+	unsigned int win;
+
+	win = hits + 2;
+	if (win == 2) {
+		if (pfn != prev_pfn + 1 && pfn != prev_pfn - 1)
+			win = 1;
+	} else {
+		win = roundup_pow_of_two(win);
+	}
+	if (win > max_win)
+		win = max_win;
+
+	/* Don't shrink the window too fast */
+	if (win < prev_win / 2)
+		win = prev_win / 2;
+	return win;
+}
+
+/**
+ * swap_vma_readahead - swap in pages in hope we need them soon
+ * @fentry: swap entry of the faulting pte
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the fault is in
+ * @addr: address of the fault
+ * @pmd: pmd the faulting pte is in
+ *
+ * Returns the struct page for @fentry and @addr, after queueing swapin.
+ *
+ * Unlike swapin_readahead(), which reads the neighbours of @fentry in the
+ * swap area, this reads the swap entries of the ptes around @addr: pages
+ * are rarely swapped out in the order the process uses them, and with
+ * zram there is no seek time to save by reading neighbouring slots.
+ * The window, up to (1 << page_cluster) pages, follows the readahead hits
+ * in @vma and points in the direction of the faults.
+ *
+ * Falls back to swapin_readahead() if vm.swap_vma_readahead is 0.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	pte_t ptes[SWAP_RA_WIN_MAX], *pte;
+	unsigned long ra_val, fpfn, pfn, start, end, lower, back;
+	unsigned int max_win, win, i;
+	bool new_page_allocated;
+	swp_entry_t entry;
+	struct page *page;
+
+	if (!sysctl_swap_vma_readahead)
+		return swapin_readahead(fentry, gfp_mask, vma, addr);
+
+	if (page_cluster >= SWAP_RA_ORDER_MAX)
+		max_win = SWAP_RA_WIN_MAX;
+	else
+		max_win = 1 << max(page_cluster, 0);
+
+	fpfn = addr >> PAGE_SHIFT;
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	pfn = SWAP_RA_ADDR(ra_val) >> PAGE_SHIFT;
+	win = swap_ra_window(fpfn, pfn, SWAP_RA_HITS(ra_val), max_win,
+			     SWAP_RA_WIN(ra_val));
+	atomic_long_set(&vma->swap_readahead_info, SWAP_RA_VAL(addr, win, 0));
+	if (win == 1)
+		goto skip;
+
+	/* Read ahead in the direction the process is faulting in */
+	if (fpfn == pfn + 1)
+		back = 0;
+	else if (pfn == fpfn + 1)
+		back = win - 1;
+	else
+		back = (win - 1) / 2;
+
+	/* Stay within the vma and the page table of the fault */
+	lower = max(vma->vm_start, addr & PMD_MASK) >> PAGE_SHIFT;
+	if (back > fpfn - lower)
+		back = fpfn - lower;
+	start = fpfn - back;
+	end = min(start + win, pmd_addr_end(addr, vma->vm_end) >> PAGE_SHIFT);
+
+	/* Copy the ptes, the swapins below may sleep */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < end - start; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	for (i = 0; i < end - start; i++) {
+		if (start + i == fpfn || !is_swap_pte(ptes[i]))
+			continue;
+		entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(entry)))
+			continue;
+		page = __read_swap_cache_async(entry, gfp_mask, vma,
+					       (start + i) << PAGE_SHIFT,
+					       &new_page_allocated);
+		if (!page)
+			continue;
+		swap_ra_page(page, new_page_allocated);
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(fentry, gfp_mask, vma, addr);
+}
@@ -22,6 +22,50 @@
 #include "internal.h"
 
 
+/*
+ * Shadow entries left behind by evicted pages (see mm/workingset.c) have
+ * no struct page for pagevec_lookup() to find: remove the ones between
+ * @start and @end by walking the tree directly.
+ */
+static void clear_shadow_entries(struct address_space *mapping,
+				 pgoff_t start, pgoff_t end)
+{
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	unsigned int i, nr, nr_shadows;
+	pgoff_t last;
+
+	while (mapping->nrshadows && start <= end) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots,
+						 indices, start, PAGEVEC_SIZE);
+		if (!nr) {
+			spin_unlock_irq(&mapping->tree_lock);
+			break;
+		}
+		last = indices[nr - 1];
+
+		/* deleting may free nodes, so collect the indices first */
+		nr_shadows = 0;
+		for (i = 0; i < nr && indices[i] <= end; i++) {
+			void *entry = radix_tree_deref_slot(slots[i]);
+
+			if (radix_tree_exceptional_entry(entry))
+				indices[nr_shadows++] = indices[i];
+		}
+		for (i = 0; i < nr_shadows; i++) {
+			radix_tree_delete(&mapping->page_tree, indices[i]);
+			mapping->nrshadows--;
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+
+		if (last >= end)
+			break;
+		start = last + 1;
+		cond_resched();
+	}
+}
+
 /**
  * do_invalidatepage - invalidate part or all of a page
  * @page: the page which is affected
@@ -215,7 +259,7 @@ void truncate_inode_pages_range(struct address_space *mapping,
 	pgoff_t next;
 	int i;
 
-	if (mapping->nrpages == 0)
+	if (mapping->nrpages == 0 && mapping->nrshadows == 0)
 		return;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
@@ -292,6 +336,7 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		pagevec_release(&pvec);
 		mem_cgroup_uncharge_end();
 	}
+	clear_shadow_entries(mapping, start, end);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
 
@@ -488,6 +533,7 @@ int invalidate_inode_pages2_range(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 		cond_resched();
 	}
+	clear_shadow_entries(mapping, start, end);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(invalidate_inode_pages2_range);
@@ -29,6 +29,7 @@
 #include <linux/pagevec.h>
 #include <linux/backing-dev.h>
 #include <linux/rmap.h>
+#include <linux/ksm.h>
 #include <linux/topology.h>
 #include <linux/cpu.h>
 #include <linux/cpuset.h>
@@ -37,6 +38,7 @@
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/freezer.h>
+#include <linux/compaction.h>
 #include <linux/memcontrol.h>
 #include <linux/delayacct.h>
 #include <linux/sysctl.h>
@@ -92,6 +94,9 @@ struct scan_control {
 	 * are scanned.
 	 */
 	nodemask_t	*nodemask;
+
+	/* Reclaim pages even if they were referenced recently? */
+	int ignore_references;
 };
 
 #define lru_to_page(_head) (list_entry((_head)->prev, struct page, lru))
@@ -419,7 +424,8 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
  * Same as remove_mapping, but if the page is removed from the mapping, it
  * gets returned with a refcount of 0.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -464,7 +470,18 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 		spin_unlock_irq(&mapping->tree_lock);
 		swapcache_free(swap, page);
 	} else {
-		__remove_from_page_cache(page);
+		void *shadow = NULL;
+
+		/*
+		 * Remember evicted file pages for refault detection,
+		 * unless the whole mapping is being torn down: nothing
+		 * would clean up the shadow entries after the final
+		 * truncate.
+		 */
+		if (reclaimed && page_is_file_cache(page) &&
+		    !mapping_exiting(mapping))
+			shadow = workingset_eviction(mapping, page);
+		__delete_from_page_cache(page, shadow);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
 	}
@@ -484,7 +501,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -664,6 +681,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		struct address_space *mapping;
 		struct page *page;
 		int may_enter_fs;
+		int lazyfree = 0;
 
 		cond_resched();
 
@@ -705,7 +723,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 				goto keep_locked;
 		}
 
-		references = page_check_references(page, sc);
+		if (sc->ignore_references)
+			references = PAGEREF_RECLAIM;
+		else
+			references = page_check_references(page, sc);
 		switch (references) {
 		case PAGEREF_ACTIVATE:
 			goto activate_locked;
@@ -723,8 +744,16 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		if (PageAnon(page) && !PageSwapCache(page)) {
 			if (!(sc->gfp_mask & __GFP_IO))
 				goto keep_locked;
+			/*
+			 * An anon page that is not dirty itself was either
+			 * freed with MADV_FREE, or has its data in dirty
+			 * ptes: try_to_unmap() tells which.
+			 */
+			lazyfree = !PageDirty(page) && !PageKsm(page);
 			if (!add_to_swap(page))
 				goto activate_locked;
+			if (!lazyfree)
+				SetPageDirty(page);
 			may_enter_fs = 1;
 		}
 
@@ -735,7 +764,14 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * processes. Try to unmap it here.
 		 */
 		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page, TTU_UNMAP)) {
+			int ret = try_to_unmap(page, lazyfree ?
+					       TTU_UNMAP | TTU_FREE : TTU_UNMAP);
+
+			/* Some ptes may still map it: keep its data */
+			if (lazyfree && ret != SWAP_SUCCESS)
+				SetPageDirty(page);
+
+			switch (ret) {
 			case SWAP_FAIL:
 				goto activate_locked;
 			case SWAP_AGAIN:
@@ -820,7 +856,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -869,6 +905,46 @@ keep:
 	return nr_reclaimed;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/**
+ * reclaim_pages_from_list - reclaim a list of isolated pages
+ * @page_list: pages taken off the LRU with isolate_lru_page()
+ *
+ * Tries to reclaim every page on @page_list, whether recently referenced
+ * or not, and puts the ones that could not be freed back on the LRU.
+ * Used by /proc/<pid>/reclaim, where userspace already knows that the
+ * pages will not be needed for a while.
+ *
+ * Returns the number of reclaimed pages.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.swappiness = vm_swappiness,
+		.ignore_references = 1,
+	};
+	unsigned long nr_reclaimed;
+	struct page *page;
+
+	list_for_each_entry(page, page_list, lru)
+		ClearPageActive(page);
+
+	nr_reclaimed = shrink_page_list(page_list, &sc, PAGEOUT_IO_ASYNC);
+
+	while (!list_empty(page_list)) {
+		page = lru_to_page(page_list);
+		list_del(&page->lru);
+		putback_lru_page(page);
+	}
+
+	return nr_reclaimed;
+}
+#endif
+
 /*
  * Attempt to remove the specified page from its LRU.  Only take this page
  * if it is of the appropriate PageActive status.  Pages which are being
@@ -2424,6 +2500,13 @@ static int kswapd(void *p)
 		if (!ret) {
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
 			balance_pgdat(pgdat, order);
+
+			/*
+			 * Reclaim alone may not have produced a page of
+			 * the order kswapd was woken for: leave the rest
+			 * to kcompactd if fragmentation is in the way.
+			 */
+			wakeup_kcompactd(pgdat, order);
 		}
 	}
 	return 0;
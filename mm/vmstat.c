@@ -789,6 +789,8 @@ static const char * const vmstat_text[] = {
 	"nr_isolated_anon",
 	"nr_isolated_file",
 	"nr_shmem",
+	"workingset_refault",
+	"workingset_activate",
 #ifdef CONFIG_NUMA
 	"numa_hit",
 	"numa_miss",
@@ -832,6 +834,7 @@ static const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"pglazyfreed",
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -840,11 +843,16 @@ static const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
 	"htlb_buddy_alloc_success",
 	"htlb_buddy_alloc_fail",
+#endif
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
 #endif
 	"unevictable_pgs_culled",
 	"unevictable_pgs_scanned",
@@ -0,0 +1,186 @@
+/*
+ * Workingset detection
+ *
+ * The inactive file list is where new page cache pages start out and
+ * where reclaim picks its victims; pages are promoted to the active list
+ * when they are referenced a second time while still inactive.  Sizing
+ * the inactive list by a fixed ratio means that a working set larger than
+ * the inactive list, but smaller than all of memory, is evicted before
+ * its second access and can never get activated: it just thrashes.
+ *
+ * To notice this, each zone keeps a counter of inactive list events:
+ * it is advanced every time a page leaves the inactive list, by eviction
+ * or by activation.  When a file page is evicted, a snapshot of the
+ * counter is stored in the page cache slot it used to occupy, in place
+ * of the page, as a radix tree exceptional entry (a "shadow entry").
+ *
+ * When the page is faulted back in, the difference between the current
+ * counter and the snapshot is the number of inactive list slots the page
+ * would have needed to survive until this refault: its refault distance.
+ * Had the active list been that much smaller, i.e. had the inactive list
+ * been that much bigger, the page would have been activated instead of
+ * evicted.  So if the refault distance does not exceed the size of the
+ * active list, the refaulting page is considered part of the working set
+ * and is activated right away, competing with the active pages for
+ * memory; otherwise it starts out on the inactive list as usual.
+ *
+ * Shadow entries are dropped when their page refaults or when the range
+ * they cover is truncated, including the final truncate of an inode.
+ * Long-lived mappings, such as the inode of a block device, are neither,
+ * so the radix tree nodes holding their shadow entries would pile up.
+ * But a shadow entry whose refault distance has grown beyond the active
+ * list can never activate its page anymore, and no more shadow entries
+ * than there are active file pages can be young enough to do so.  A
+ * mapping therefore keeps at most that many: past it, each eviction
+ * first drops stale shadow entries near the evicted page, freeing the
+ * nodes they leave empty, and stores no shadow entry if it finds none.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/pagemap.h>
+#include <linux/radix-tree.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+
+/*
+ * A shadow entry packs the eviction counter together with the node and
+ * zone of the evicted page, above the radix tree's exceptional bits.
+ * The counter loses its top bits: distances are taken modulo the room
+ * left, which is still far more than any zone has pages on 64-bit.
+ */
+#define EVICTION_SHIFT	(RADIX_TREE_EXCEPTIONAL_SHIFT + \
+			 NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << RADIX_TREE_EXCEPTIONAL_SHIFT);
+
+	return (void *)(eviction | RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *evictionp)
+{
+	unsigned long entry = (unsigned long)shadow;
+	int zid, nid;
+
+	entry >>= RADIX_TREE_EXCEPTIONAL_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*evictionp = entry;
+}
+
+static bool shadow_stale(void *shadow)
+{
+	unsigned long refault_distance;
+	unsigned long eviction;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &eviction);
+	refault_distance = (atomic_long_read(&zone->inactive_age) - eviction) &
+			   EVICTION_MASK;
+
+	return refault_distance > zone_page_state(zone, NR_ACTIVE_FILE);
+}
+
+#define PRUNE_BATCH	16
+
+/*
+ * Drops the stale shadow entries among the next PRUNE_BATCH entries of
+ * @mapping from @start on.  Returns the number dropped.
+ */
+static unsigned int prune_shadows(struct address_space *mapping,
+				  pgoff_t start)
+{
+	void **slots[PRUNE_BATCH];
+	unsigned long indices[PRUNE_BATCH];
+	unsigned int i, nr, nr_stale = 0;
+
+	nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots, indices,
+					 start, PRUNE_BATCH);
+
+	/* deleting may free nodes, so collect the indices first */
+	for (i = 0; i < nr; i++) {
+		void *entry = radix_tree_deref_slot(slots[i]);
+
+		if (radix_tree_exceptional_entry(entry) && shadow_stale(entry))
+			indices[nr_stale++] = indices[i];
+	}
+	for (i = 0; i < nr_stale; i++)
+		radix_tree_delete(&mapping->page_tree, indices[i]);
+	mapping->nrshadows -= nr_stale;
+
+	return nr_stale;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Returns a shadow entry to be stored in @mapping->page_tree in place
+ * of the evicted @page so that a later refault can be detected, or
+ * %NULL if @mapping holds too many shadow entries already.  Called
+ * with @mapping->tree_lock held.
+ */
+void *workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+
+	if (mapping->nrshadows >= global_page_state(NR_ACTIVE_FILE) &&
+	    !prune_shadows(mapping, page->index + 1) &&
+	    !prune_shadows(mapping, 0))
+		return NULL;
+
+	return pack_shadow(eviction, zone);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Calculates and evaluates the refault distance of the previously
+ * evicted page in the context of the zone it was allocated in.
+ *
+ * Returns %true if the page should be activated, %false otherwise.
+ */
+bool workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	unsigned long eviction;
+	unsigned long refault;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &eviction);
+
+	refault = atomic_long_read(&zone->inactive_age);
+	refault_distance = (refault - eviction) & EVICTION_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
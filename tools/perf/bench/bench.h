@@ -3,7 +3,17 @@
 
 extern int bench_sched_messaging(int argc, const char **argv, const char *prefix);
 extern int bench_sched_pipe(int argc, const char **argv, const char *prefix);
+extern int bench_sched_cpufreq(int argc, const char **argv, const char *prefix);
+extern int bench_sched_wakeup(int argc, const char **argv, const char *prefix);
+extern int bench_sched_bandwidth(int argc, const char **argv, const char *prefix);
+extern int bench_sched_autogroup(int argc, const char **argv, const char *prefix);
 extern int bench_mem_memcpy(int argc, const char **argv, const char *prefix __used);
+extern int bench_mem_smaps(int argc, const char **argv, const char *prefix);
+extern int bench_mem_mmap(int argc, const char **argv, const char *prefix);
+extern int bench_mem_madvise(int argc, const char **argv, const char *prefix);
+extern int bench_mem_compact(int argc, const char **argv, const char *prefix);
+extern int bench_mem_charge(int argc, const char **argv, const char *prefix);
+extern int bench_io_launch(int argc, const char **argv, const char *prefix);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
@@ -0,0 +1,241 @@
+/*
+ *
+ * io-launch.c
+ *
+ * launch: Benchmark for application start-up read latency
+ *
+ * A freshly forked process reads a set of scattered chunks from a cold
+ * file, the way an application being launched pages in its binary and
+ * libraries, while another process keeps writing a big file sequentially
+ * in the background.  The time taken by each "launch" is reported.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define CHUNK_SIZE	(16 * 1024)
+#define WRITE_SIZE	(1024 * 1024)
+
+static const char *dir = ".";
+static int file_mb = 64;
+static int writer_mb = 512;
+static int loops = 10;
+static int reads = 256;
+static int pause_ms = 1000;
+static bool no_writer;
+
+static const struct option options[] = {
+	OPT_STRING('d', "dir", &dir, "path",
+		    "Directory to create the test files in"),
+	OPT_INTEGER('s', "size", &file_mb,
+		    "Size of the file read at launch (MB)"),
+	OPT_INTEGER('w', "writer-size", &writer_mb,
+		    "Size of the file rewritten by the writer (MB)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of launches"),
+	OPT_INTEGER('r', "reads", &reads,
+		    "Number of 16KB reads issued by each launch"),
+	OPT_INTEGER('p', "pause", &pause_ms,
+		    "Pause between two launches (ms)"),
+	OPT_BOOLEAN('n', "no-writer", &no_writer,
+		    "Do not run the background writer"),
+	OPT_END()
+};
+
+static const char * const bench_io_launch_usage[] = {
+	"perf bench io launch <options>",
+	NULL
+};
+
+static char app_path[PATH_MAX];
+static char writer_path[PATH_MAX];
+
+static void create_file(const char *path, int mb)
+{
+	char *buf;
+	int fd, i;
+
+	buf = malloc(WRITE_SIZE);
+	assert(buf);
+	memset(buf, 0x5a, WRITE_SIZE);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "cannot create %s: %s\n", path,
+			strerror(errno));
+		exit(1);
+	}
+	for (i = 0; i < mb; i++)
+		assert(write(fd, buf, WRITE_SIZE) == WRITE_SIZE);
+	assert(!fsync(fd));
+	close(fd);
+	free(buf);
+}
+
+/* Rewrites writer_path sequentially until killed */
+static void NORETURN run_writer(void)
+{
+	char *buf;
+	int fd, i;
+
+	buf = malloc(WRITE_SIZE);
+	assert(buf);
+	memset(buf, 0xa5, WRITE_SIZE);
+
+	fd = open(writer_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	assert(fd >= 0);
+	for (;;) {
+		for (i = 0; i < writer_mb; i++)
+			assert(write(fd, buf, WRITE_SIZE) == WRITE_SIZE);
+		assert(!fdatasync(fd));
+		assert(lseek(fd, 0, SEEK_SET) == 0);
+	}
+}
+
+/* The launch itself: runs in a new process, returns its duration */
+static void NORETURN run_launch(int seed, int out)
+{
+	struct timeval start, stop, diff;
+	unsigned long long usecs;
+	unsigned int state = seed;
+	unsigned long nr_chunks;
+	char *buf;
+	off_t off;
+	int fd, i;
+
+	buf = malloc(CHUNK_SIZE);
+	assert(buf);
+	nr_chunks = (unsigned long)file_mb * 1024 * 1024 / CHUNK_SIZE;
+
+	gettimeofday(&start, NULL);
+	fd = open(app_path, O_RDONLY);
+	assert(fd >= 0);
+	for (i = 0; i < reads; i++) {
+		off = (off_t)(rand_r(&state) % nr_chunks) * CHUNK_SIZE;
+		assert(pread(fd, buf, CHUNK_SIZE, off) == CHUNK_SIZE);
+	}
+	close(fd);
+	gettimeofday(&stop, NULL);
+
+	timersub(&stop, &start, &diff);
+	usecs = diff.tv_sec * 1000000ULL + diff.tv_usec;
+	assert(write(out, &usecs, sizeof(usecs)) == sizeof(usecs));
+	exit(0);
+}
+
+int bench_io_launch(int argc, const char **argv,
+		    const char *prefix __used)
+{
+	unsigned long long usecs, total = 0, min = ~0ULL, max = 0;
+	pid_t writer = 0, pid, retpid;
+	int out[2], fd, i, wait_stat;
+
+	argc = parse_options(argc, argv, options,
+			     bench_io_launch_usage, 0);
+
+	if (file_mb <= 0 || writer_mb <= 0 || loops <= 0 || reads <= 0) {
+		usage_with_options(bench_io_launch_usage, options);
+		exit(1);
+	}
+
+	snprintf(app_path, sizeof(app_path), "%s/perf-io-launch.%d.app",
+		 dir, getpid());
+	snprintf(writer_path, sizeof(writer_path), "%s/perf-io-launch.%d.wr",
+		 dir, getpid());
+
+	create_file(app_path, file_mb);
+	assert(!pipe(out));
+
+	if (!no_writer) {
+		writer = fork();
+		assert(writer >= 0);
+		if (!writer)
+			run_writer();
+		/* let the writer fill the device queue first */
+		usleep(pause_ms * 1000);
+	}
+
+	for (i = 0; i < loops; i++) {
+		/* every launch starts from a cold page cache */
+		fd = open(app_path, O_RDONLY);
+		assert(fd >= 0);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+
+		pid = fork();
+		assert(pid >= 0);
+		if (!pid)
+			run_launch(i + 1, out[1]);
+
+		retpid = waitpid(pid, &wait_stat, 0);
+		assert((retpid == pid) && WIFEXITED(wait_stat) &&
+		       !WEXITSTATUS(wait_stat));
+		assert(read(out[0], &usecs, sizeof(usecs)) == sizeof(usecs));
+
+		total += usecs;
+		if (usecs < min)
+			min = usecs;
+		if (usecs > max)
+			max = usecs;
+
+		usleep(pause_ms * 1000);
+	}
+
+	if (writer) {
+		kill(writer, SIGKILL);
+		waitpid(writer, &wait_stat, 0);
+		unlink(writer_path);
+	}
+	unlink(app_path);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d launches of %d x %dKB random reads from a %dMB file\n",
+		       loops, reads, CHUNK_SIZE / 1024, file_mb);
+		if (no_writer)
+			printf("# no background writer\n\n");
+		else
+			printf("# background sequential writer, %dMB file\n\n",
+			       writer_mb);
+
+		printf(" %14s: %llu.%03llu [msec]\n", "Min launch",
+		       min / 1000, min % 1000);
+		printf(" %14s: %llu.%03llu [msec]\n", "Avg launch",
+		       total / loops / 1000, total / loops % 1000);
+		printf(" %14s: %llu.%03llu [msec]\n", "Max launch",
+		       max / 1000, max % 1000);
+		printf(" %14lf usecs/read\n",
+		       (double)total / ((double)loops * reads));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%llu.%03llu\n", total / loops / 1000,
+		       total / loops % 1000);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ *
+ * mem-charge.c
+ *
+ * charge: Benchmark for page charge latency in a memory cgroup
+ *
+ * Reads a file several times larger than the limit of a memory cgroup
+ * from inside of it, so that every read charges new page cache pages
+ * and the cgroup keeps running into its limit.  The latency of the reads
+ * is reported, with the pages the cgroup reclaimed in the background and
+ * on charge taken from its memory.stat.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define CHUNK_SIZE	(64 * 1024)
+#define WRITE_SIZE	(1024 * 1024)
+
+static const char *cgroup;
+static const char *dir = ".";
+static int file_mb = 256;
+static int loops = 4;
+
+static const struct option options[] = {
+	OPT_STRING('c', "cgroup", &cgroup, "path",
+		    "Memory cgroup directory to run in (default: current one)"),
+	OPT_STRING('d', "dir", &dir, "path",
+		    "Directory to create the test file in"),
+	OPT_INTEGER('s', "size", &file_mb,
+		    "Size of the file read (MB)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops"),
+	OPT_END()
+};
+
+static const char * const bench_mem_charge_usage[] = {
+	"perf bench mem charge <options>",
+	NULL
+};
+
+static void create_file(const char *path, int mb)
+{
+	char *buf;
+	int fd, i;
+
+	buf = malloc(WRITE_SIZE);
+	BUG_ON(!buf);
+	memset(buf, 0x5a, WRITE_SIZE);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		die("cannot create %s: %s\n", path, strerror(errno));
+	for (i = 0; i < mb; i++)
+		BUG_ON(write(fd, buf, WRITE_SIZE) != WRITE_SIZE);
+	BUG_ON(fsync(fd));
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+	free(buf);
+}
+
+static void join_cgroup(void)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/tasks", cgroup);
+	fp = fopen(path, "w");
+	if (!fp || fprintf(fp, "%d\n", getpid()) < 0 || fclose(fp))
+		die("cannot move to %s: %s\n", cgroup, strerror(errno));
+}
+
+/* Returns the value of a memory.stat field, 0 if there is none */
+static unsigned long long read_stat(const char *name)
+{
+	char path[PATH_MAX], line[BUFSIZ], field[64];
+	unsigned long long val, ret = 0;
+	FILE *fp;
+
+	if (!cgroup)
+		return 0;
+
+	snprintf(path, sizeof(path), "%s/memory.stat", cgroup);
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%63s %llu", field, &val) == 2 &&
+		    !strcmp(field, name)) {
+			ret = val;
+			break;
+		}
+	}
+	fclose(fp);
+	return ret;
+}
+
+int bench_mem_charge(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	unsigned long long usecs, total = 0, max = 0, nr_reads = 0;
+	unsigned long long bg, direct;
+	struct timeval start, stop, diff;
+	char path[PATH_MAX];
+	char *buf;
+	ssize_t len;
+	int fd, loop;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_charge_usage, 0);
+
+	if (file_mb <= 0 || loops <= 0) {
+		usage_with_options(bench_mem_charge_usage, options);
+		exit(1);
+	}
+
+	buf = malloc(CHUNK_SIZE);
+	BUG_ON(!buf);
+
+	/* the file is written from outside of the cgroup */
+	snprintf(path, sizeof(path), "%s/perf-mem-charge.%d", dir, getpid());
+	create_file(path, file_mb);
+
+	if (cgroup)
+		join_cgroup();
+	bg = read_stat("pgreclaim_background");
+	direct = read_stat("pgreclaim_direct");
+
+	fd = open(path, O_RDONLY);
+	BUG_ON(fd < 0);
+
+	for (loop = 0; loop < loops; loop++) {
+		BUG_ON(lseek(fd, 0, SEEK_SET));
+		for (;;) {
+			gettimeofday(&start, NULL);
+			len = read(fd, buf, CHUNK_SIZE);
+			gettimeofday(&stop, NULL);
+			BUG_ON(len < 0);
+			if (!len)
+				break;
+
+			timersub(&stop, &start, &diff);
+			usecs = diff.tv_sec * 1000000ULL + diff.tv_usec;
+			total += usecs;
+			if (usecs > max)
+				max = usecs;
+			nr_reads++;
+		}
+	}
+
+	bg = read_stat("pgreclaim_background") - bg;
+	direct = read_stat("pgreclaim_direct") - direct;
+
+	close(fd);
+	unlink(path);
+	free(buf);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d loops of reading a %dMB file in %dKB chunks%s%s\n\n",
+		       loops, file_mb, CHUNK_SIZE / 1024,
+		       cgroup ? " in " : "", cgroup ? cgroup : "");
+		printf(" %14lf usecs/read\n", (double)total / nr_reads);
+		printf(" %14s: %llu.%03llu [msec]\n", "Max read",
+		       max / 1000, max % 1000);
+		if (cgroup) {
+			printf(" %14llu pages reclaimed in background\n", bg);
+			printf(" %14llu pages reclaimed on charge\n", direct);
+		}
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf %llu %llu %llu\n", (double)total / nr_reads, max,
+		       bg, direct);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
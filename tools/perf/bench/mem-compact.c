@@ -0,0 +1,157 @@
+/*
+ *
+ * mem-compact.c
+ *
+ * compact: Benchmark for high-order allocation latency on fragmented memory
+ *
+ * Fragments memory by faulting in a big anonymous buffer and freeing
+ * every other page of it, optionally waits for background compaction to
+ * catch up, then times order-4 kernel allocations: each 60KB datagram
+ * queued on an AF_UNIX socket needs a 64KB linear buffer.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+/* With the skb overhead this is served from a 64KB, order-4, buffer */
+#define MSG_SIZE	60000
+
+static int frag_mb = 256;
+static int nr_allocs = 128;
+static int wait_ms;
+static int loops = 10;
+
+static const struct option options[] = {
+	OPT_INTEGER('s', "size", &frag_mb,
+		    "Size of the buffer used to fragment memory (MB)"),
+	OPT_INTEGER('n', "nr", &nr_allocs,
+		    "Number of order-4 allocations per loop"),
+	OPT_INTEGER('w', "wait", &wait_ms,
+		    "Time left to background compaction before measuring (ms)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops"),
+	OPT_END()
+};
+
+static const char * const bench_mem_compact_usage[] = {
+	"perf bench mem compact <options>",
+	NULL
+};
+
+/* Leaves every other page of the buffer allocated */
+static void fragment(char *buf, size_t len, long page_size)
+{
+	size_t off;
+
+	for (off = 0; off < len; off += page_size)
+		buf[off] = 1;
+	for (off = page_size; off < len; off += 2 * page_size)
+		BUG_ON(madvise(buf + off, page_size, MADV_DONTNEED));
+}
+
+int bench_mem_compact(int argc, const char **argv,
+		      const char *prefix __used)
+{
+	unsigned long long usecs, total = 0, max = 0;
+	struct timeval start, stop, diff;
+	int (*socks)[2];
+	long page_size;
+	char *buf, *msg;
+	size_t len;
+	int i, loop;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_compact_usage, 0);
+
+	if (frag_mb <= 0 || nr_allocs <= 0 || wait_ms < 0 || loops <= 0) {
+		usage_with_options(bench_mem_compact_usage, options);
+		exit(1);
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	len = (size_t)frag_mb * 1024 * 1024;
+
+	msg = malloc(MSG_SIZE);
+	BUG_ON(!msg);
+	memset(msg, 0x5a, MSG_SIZE);
+
+	/* one datagram per socket, so none is freed before the end of a loop */
+	socks = malloc(nr_allocs * sizeof(*socks));
+	BUG_ON(!socks);
+	for (i = 0; i < nr_allocs; i++) {
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, socks[i]))
+			die("socketpair failed: %s\n", strerror(errno));
+	}
+
+	buf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	BUG_ON(buf == MAP_FAILED);
+
+	for (loop = 0; loop < loops; loop++) {
+		fragment(buf, len, page_size);
+		if (wait_ms)
+			usleep(wait_ms * 1000);
+
+		for (i = 0; i < nr_allocs; i++) {
+			gettimeofday(&start, NULL);
+			if (send(socks[i][0], msg, MSG_SIZE, 0) != MSG_SIZE)
+				die("send failed: %s\n", strerror(errno));
+			gettimeofday(&stop, NULL);
+
+			timersub(&stop, &start, &diff);
+			usecs = diff.tv_sec * 1000000ULL + diff.tv_usec;
+			total += usecs;
+			if (usecs > max)
+				max = usecs;
+		}
+
+		for (i = 0; i < nr_allocs; i++)
+			BUG_ON(recv(socks[i][1], msg, MSG_SIZE, 0) != MSG_SIZE);
+	}
+
+	munmap(buf, len);
+	for (i = 0; i < nr_allocs; i++) {
+		close(socks[i][0]);
+		close(socks[i][1]);
+	}
+	free(socks);
+	free(msg);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d loops of %d order-4 allocations, %dMB fragmented, "
+		       "%dms settle time\n\n", loops, nr_allocs, frag_mb,
+		       wait_ms);
+		printf(" %14lf usecs/alloc\n",
+		       (double)total / ((double)loops * nr_allocs));
+		printf(" %14s: %llu.%03llu [msec]\n", "Max alloc",
+		       max / 1000, max % 1000);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf %llu\n",
+		       (double)total / ((double)loops * nr_allocs), max);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
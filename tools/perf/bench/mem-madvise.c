@@ -0,0 +1,129 @@
+/*
+ *
+ * mem-madvise.c
+ *
+ * madvise: Benchmark for returning memory to the kernel and reusing it
+ *
+ * Emulates the churn of a userspace allocator that hands freed chunks
+ * back with madvise() and soon allocates from them again: each loop
+ * writes to every page of a buffer, then releases it with MADV_DONTNEED
+ * or MADV_FREE.  The time taken and the page faults are reported.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifndef MADV_FREE
+#define MADV_FREE	8
+#endif
+
+static const char *advice_str = "free";
+static int size_kb = 4096;
+static int loops = 1000;
+
+static const struct option options[] = {
+	OPT_STRING('a', "advice", &advice_str, "free",
+		    "Specify how memory is released: free or dontneed"),
+	OPT_INTEGER('s', "size", &size_kb,
+		    "Size of the buffer (KB)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops"),
+	OPT_END()
+};
+
+static const char * const bench_mem_madvise_usage[] = {
+	"perf bench mem madvise <options>",
+	NULL
+};
+
+int bench_mem_madvise(int argc, const char **argv,
+		      const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct rusage ru_start, ru_stop;
+	unsigned long long usecs, faults;
+	long page_size;
+	size_t len, off;
+	char *buf;
+	int advice, i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_madvise_usage, 0);
+
+	if (!strcmp(advice_str, "free"))
+		advice = MADV_FREE;
+	else if (!strcmp(advice_str, "dontneed"))
+		advice = MADV_DONTNEED;
+	else
+		advice = -1;
+
+	if (advice < 0 || size_kb <= 0 || loops <= 0) {
+		usage_with_options(bench_mem_madvise_usage, options);
+		exit(1);
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	len = (size_t)size_kb * 1024;
+
+	buf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	BUG_ON(buf == MAP_FAILED);
+
+	if (madvise(buf, len, advice))
+		die("madvise(%s) failed: %s\n", advice_str, strerror(errno));
+
+	getrusage(RUSAGE_SELF, &ru_start);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++) {
+		for (off = 0; off < len; off += page_size)
+			buf[off] = i;
+		BUG_ON(madvise(buf, len, advice));
+	}
+	gettimeofday(&stop, NULL);
+	getrusage(RUSAGE_SELF, &ru_stop);
+
+	munmap(buf, len);
+
+	timersub(&stop, &start, &diff);
+	usecs = diff.tv_sec * 1000000ULL + diff.tv_usec;
+	faults = ru_stop.ru_minflt - ru_start.ru_minflt;
+	faults += ru_stop.ru_majflt - ru_start.ru_majflt;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d loops of writing %dKB and releasing it with "
+		       "MADV_%s\n\n", loops, size_kb,
+		       advice == MADV_FREE ? "FREE" : "DONTNEED");
+		printf(" %14s: %llu.%03llu [msec]\n", "Total time",
+		       usecs / 1000, usecs % 1000);
+		printf(" %14lf usecs/loop\n", (double)usecs / loops);
+		printf(" %14llu faults\n", faults);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%llu.%03llu %llu\n", usecs / 1000, usecs % 1000,
+		       faults);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ *
+ * mem-mmap.c
+ *
+ * mmap: Benchmark for faulting in a mapped file from the page cache
+ *
+ * Maps a file that is already in the page cache and reads one byte of
+ * each of its pages, the way an application touches the libraries it has
+ * just mapped.  The page faults taken and the time spent are reported.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define WRITE_SIZE	(1024 * 1024)
+
+static const char *dir = ".";
+static int file_mb = 64;
+static int loops = 10;
+static bool random_order;
+
+static const struct option options[] = {
+	OPT_STRING('d', "dir", &dir, "path",
+		    "Directory to create the test file in"),
+	OPT_INTEGER('s', "size", &file_mb,
+		    "Size of the mapped file (MB)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops"),
+	OPT_BOOLEAN('r', "random", &random_order,
+		    "Touch the pages in random order"),
+	OPT_END()
+};
+
+static const char * const bench_mem_mmap_usage[] = {
+	"perf bench mem mmap <options>",
+	NULL
+};
+
+static void create_file(const char *path, int mb)
+{
+	char *buf;
+	int fd, i;
+
+	buf = malloc(WRITE_SIZE);
+	BUG_ON(!buf);
+	memset(buf, 0x5a, WRITE_SIZE);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		die("cannot create %s: %s\n", path, strerror(errno));
+	for (i = 0; i < mb; i++)
+		BUG_ON(write(fd, buf, WRITE_SIZE) != WRITE_SIZE);
+	close(fd);
+	free(buf);
+}
+
+int bench_mem_mmap(int argc, const char **argv,
+		   const char *prefix __used)
+{
+	unsigned long long usecs, total = 0, faults = 0;
+	struct timeval start, stop, diff;
+	struct rusage ru_start, ru_stop;
+	unsigned long nr_pages, i, *order;
+	volatile char *map;
+	char path[PATH_MAX];
+	long page_size;
+	size_t len;
+	int fd, loop;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_mmap_usage, 0);
+
+	if (file_mb <= 0 || loops <= 0) {
+		usage_with_options(bench_mem_mmap_usage, options);
+		exit(1);
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	len = (size_t)file_mb * 1024 * 1024;
+	nr_pages = len / page_size;
+
+	order = malloc(nr_pages * sizeof(*order));
+	BUG_ON(!order);
+	for (i = 0; i < nr_pages; i++)
+		order[i] = i;
+	if (random_order) {
+		unsigned int seed = getpid();
+
+		for (i = nr_pages - 1; i > 0; i--) {
+			unsigned long j = rand_r(&seed) % (i + 1);
+			unsigned long tmp = order[i];
+
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+	}
+
+	snprintf(path, sizeof(path), "%s/perf-mem-mmap.%d", dir, getpid());
+	create_file(path, file_mb);
+
+	fd = open(path, O_RDONLY);
+	BUG_ON(fd < 0);
+
+	for (loop = 0; loop < loops; loop++) {
+		map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		BUG_ON(map == MAP_FAILED);
+
+		getrusage(RUSAGE_SELF, &ru_start);
+		gettimeofday(&start, NULL);
+		for (i = 0; i < nr_pages; i++)
+			(void)map[order[i] * page_size];
+		gettimeofday(&stop, NULL);
+		getrusage(RUSAGE_SELF, &ru_stop);
+
+		timersub(&stop, &start, &diff);
+		usecs = diff.tv_sec * 1000000ULL + diff.tv_usec;
+		total += usecs;
+		faults += ru_stop.ru_minflt - ru_start.ru_minflt;
+		faults += ru_stop.ru_majflt - ru_start.ru_majflt;
+
+		munmap((void *)map, len);
+	}
+
+	close(fd);
+	unlink(path);
+	free(order);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# touching %lu pages of a %dMB cached file, %s order\n\n",
+		       nr_pages, file_mb, random_order ? "random" : "linear");
+		printf(" %14s: %llu.%03llu [msec]\n", "Avg time",
+		       total / loops / 1000, total / loops % 1000);
+		printf(" %14llu faults/loop\n", faults / loops);
+		printf(" %14lf pages/fault\n",
+		       faults ? (double)nr_pages * loops / faults : 0.0);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%llu.%03llu %llu\n", total / loops / 1000,
+		       total / loops % 1000, faults / loops);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
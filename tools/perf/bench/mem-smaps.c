@@ -0,0 +1,174 @@
+/*
+ *
+ * mem-smaps.c
+ *
+ * smaps: Benchmark for reading the memory usage of processes
+ *
+ * Compares what memory accounting tools pay to get the Pss of a set of
+ * processes: reading /proc/<pid>/smaps and summing its per-mapping records
+ * in userspace, against reading the single record of
+ * /proc/<pid>/smaps_rollup.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/time.h>
+
+#define MAX_PIDS	4096
+
+static int target_pid;
+static int loops = 10;
+
+static const struct option options[] = {
+	OPT_INTEGER('p', "pid", &target_pid,
+		    "Only read the given process (default: all processes)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops"),
+	OPT_END()
+};
+
+static const char * const bench_mem_smaps_usage[] = {
+	"perf bench mem smaps <options>",
+	NULL
+};
+
+static int pids[MAX_PIDS];
+static int nr_pids;
+
+static void collect_pids(void)
+{
+	struct dirent *dent;
+	DIR *proc;
+
+	if (target_pid) {
+		pids[nr_pids++] = target_pid;
+		return;
+	}
+
+	proc = opendir("/proc");
+	if (!proc) {
+		fprintf(stderr, "cannot open /proc: %s\n", strerror(errno));
+		exit(1);
+	}
+	while ((dent = readdir(proc)) != NULL && nr_pids < MAX_PIDS) {
+		if (!isdigit(dent->d_name[0]))
+			continue;
+		pids[nr_pids++] = atoi(dent->d_name);
+	}
+	closedir(proc);
+}
+
+/* Sums the Pss lines of the given file, returns -1 if it can't be read */
+static long long sum_pss(int pid, const char *file)
+{
+	char path[PATH_MAX], line[BUFSIZ];
+	long long total = 0;
+	unsigned long kb;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "Pss: %lu kB", &kb) == 1)
+			total += kb;
+	}
+	fclose(fp);
+	return total;
+}
+
+/* Returns the time taken to read all the pids, in usecs */
+static unsigned long long run(const char *file, long long *pss, int *nr_read)
+{
+	struct timeval start, stop, diff;
+	long long val;
+	int i;
+
+	*pss = 0;
+	*nr_read = 0;
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nr_pids; i++) {
+		val = sum_pss(pids[i], file);
+		if (val < 0)
+			continue;
+		*pss += val;
+		(*nr_read)++;
+	}
+	gettimeofday(&stop, NULL);
+
+	timersub(&stop, &start, &diff);
+	return diff.tv_sec * 1000000ULL + diff.tv_usec;
+}
+
+int bench_mem_smaps(int argc, const char **argv,
+		    const char *prefix __used)
+{
+	unsigned long long smaps_usecs = 0, rollup_usecs = 0;
+	long long smaps_pss = 0, rollup_pss = 0;
+	int smaps_nr = 0, rollup_nr = 0;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_smaps_usage, 0);
+
+	if (loops <= 0 || target_pid < 0) {
+		usage_with_options(bench_mem_smaps_usage, options);
+		exit(1);
+	}
+
+	collect_pids();
+
+	run("smaps_rollup", &rollup_pss, &rollup_nr);
+	if (!rollup_nr) {
+		fprintf(stderr, "no readable smaps_rollup, "
+			"does the kernel provide it?\n");
+		exit(1);
+	}
+
+	for (i = 0; i < loops; i++) {
+		smaps_usecs += run("smaps", &smaps_pss, &smaps_nr);
+		rollup_usecs += run("smaps_rollup", &rollup_pss, &rollup_nr);
+	}
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Pss of %d processes, %d loops\n\n",
+		       rollup_nr, loops);
+		printf(" %14s: %llu.%03llu [msec], Pss %lld kB\n", "smaps",
+		       smaps_usecs / loops / 1000, smaps_usecs / loops % 1000,
+		       smaps_pss);
+		printf(" %14s: %llu.%03llu [msec], Pss %lld kB\n",
+		       "smaps_rollup",
+		       rollup_usecs / loops / 1000, rollup_usecs / loops % 1000,
+		       rollup_pss);
+		if (rollup_usecs)
+			printf(" %14lf x faster\n",
+			       (double)smaps_usecs / (double)rollup_usecs);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%llu.%03llu %llu.%03llu\n",
+		       smaps_usecs / loops / 1000, smaps_usecs / loops % 1000,
+		       rollup_usecs / loops / 1000, rollup_usecs / loops % 1000);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ *
+ * sched-autogroup.c
+ *
+ * autogroup: Benchmark for the cost of putting new processes in groups
+ *
+ * Forks short lived processes which join one of a few groups as they
+ * start, the way zygote forks apps: by changing their uid or calling
+ * prctl(PR_SET_AUTOGROUP) with kernel.sched_autogroup_key set accordingly,
+ * or by writing their pid to the tasks file of a cpu cgroup.  A process
+ * stays in each group so that it lives through the run.  The cost is
+ * the time to fork, join and reap, compared to a plain fork.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#ifndef PR_SET_AUTOGROUP
+#define PR_SET_AUTOGROUP 35
+#endif
+
+#define AUTOGROUP_KEY		"/proc/sys/kernel/sched_autogroup_key"
+#define AUTOGROUP_KEY_UID	1
+#define AUTOGROUP_KEY_PRCTL	2
+
+/* The uids of the groups start there, those of the Android apps do */
+#define FIRST_UID		10000
+
+enum mode {
+	MODE_FORK,
+	MODE_UID,
+	MODE_PRCTL,
+	MODE_CGROUP,
+	NR_MODES
+};
+
+static const char * const mode_names[NR_MODES] = {
+	"fork", "uid", "prctl", "cgroup",
+};
+
+static const char *cgroup;
+static int nr_spawns = 1000;
+static int nr_groups = 8;
+
+static const struct option options[] = {
+	OPT_INTEGER('n', "nr", &nr_spawns,
+		    "Number of processes to fork per method"),
+	OPT_INTEGER('g', "groups", &nr_groups,
+		    "Number of groups to spread them over"),
+	OPT_STRING('c', "cgroup", &cgroup, "path",
+		    "Cpu cgroup directory to create groups in (default: none)"),
+	OPT_END()
+};
+
+static const char * const bench_sched_autogroup_usage[] = {
+	"perf bench sched autogroup <options>",
+	NULL
+};
+
+static void write_file(const char *path, long val)
+{
+	FILE *fp = fopen(path, "w");
+
+	if (!fp || fprintf(fp, "%ld\n", val) < 0 || fclose(fp))
+		die("cannot write %s: %s\n", path, strerror(errno));
+}
+
+static long read_file(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	long val;
+
+	if (!fp || fscanf(fp, "%ld", &val) != 1)
+		die("cannot read %s: %s\n", path, strerror(errno));
+	fclose(fp);
+	return val;
+}
+
+static void cgroup_path(char *path, size_t len, int group, const char *file)
+{
+	snprintf(path, len, "%s/perf-bench-%d%s%s", cgroup, group,
+		 file ? "/" : "", file ? file : "");
+}
+
+/* Makes the calling process join that group, dies on failure */
+static void join(enum mode mode, int group)
+{
+	char path[PATH_MAX];
+
+	switch (mode) {
+	case MODE_UID:
+		if (setuid(FIRST_UID + group))
+			die("setuid failed: %s\n", strerror(errno));
+		break;
+	case MODE_PRCTL:
+		if (prctl(PR_SET_AUTOGROUP, group + 1, 0, 0, 0))
+			die("prctl(PR_SET_AUTOGROUP) failed: %s\n",
+			    strerror(errno));
+		break;
+	case MODE_CGROUP:
+		cgroup_path(path, sizeof(path), group, "tasks");
+		write_file(path, getpid());
+		break;
+	case MODE_FORK:
+	default:
+		break;
+	}
+}
+
+static pid_t spawn(enum mode mode, int group, int stay)
+{
+	pid_t pid = fork();
+
+	if (pid < 0)
+		die("fork failed: %s\n", strerror(errno));
+	if (pid)
+		return pid;
+
+	join(mode, group);
+	if (stay)
+		pause();
+	_exit(0);
+}
+
+/* Returns the usecs it took per spawn */
+static double run(enum mode mode)
+{
+	struct timeval start, stop, diff;
+	pid_t *anchors;
+	int i, status;
+
+	anchors = calloc(nr_groups, sizeof(*anchors));
+	BUG_ON(!anchors);
+	for (i = 0; i < nr_groups; i++)
+		anchors[i] = spawn(mode, i, 1);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nr_spawns; i++) {
+		pid_t pid = spawn(mode, i % nr_groups, 0);
+
+		if (waitpid(pid, &status, 0) != pid ||
+		    !WIFEXITED(status) || WEXITSTATUS(status))
+			die("a %s process failed\n", mode_names[mode]);
+	}
+	gettimeofday(&stop, NULL);
+
+	for (i = 0; i < nr_groups; i++) {
+		kill(anchors[i], SIGKILL);
+		waitpid(anchors[i], &status, 0);
+	}
+	free(anchors);
+
+	timersub(&stop, &start, &diff);
+	return (diff.tv_sec * 1000000.0 + diff.tv_usec) / nr_spawns;
+}
+
+static void print_result(enum mode mode, double usecs, double base)
+{
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %-6s: %14lf usecs/spawn", mode_names[mode], usecs);
+		if (mode != MODE_FORK)
+			printf(" (+%lf to join)", usecs - base);
+		printf("\n");
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%s %lf\n", mode_names[mode], usecs);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+}
+
+int bench_sched_autogroup(int argc, const char **argv,
+			  const char *prefix __used)
+{
+	char path[PATH_MAX];
+	long old_key;
+	double base;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_sched_autogroup_usage, 0);
+
+	if (nr_spawns <= 0 || nr_groups <= 0) {
+		usage_with_options(bench_sched_autogroup_usage, options);
+		exit(1);
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d processes over %d groups\n\n",
+		       nr_spawns, nr_groups);
+
+	base = run(MODE_FORK);
+	print_result(MODE_FORK, base, base);
+
+	if (!access(AUTOGROUP_KEY, F_OK)) {
+		old_key = read_file(AUTOGROUP_KEY);
+
+		write_file(AUTOGROUP_KEY, AUTOGROUP_KEY_UID);
+		print_result(MODE_UID, run(MODE_UID), base);
+
+		write_file(AUTOGROUP_KEY, AUTOGROUP_KEY_PRCTL);
+		print_result(MODE_PRCTL, run(MODE_PRCTL), base);
+
+		write_file(AUTOGROUP_KEY, old_key);
+	} else if (bench_format == BENCH_FORMAT_DEFAULT) {
+		printf(" no %s, skipping the autogroups\n", AUTOGROUP_KEY);
+	}
+
+	if (cgroup) {
+		for (i = 0; i < nr_groups; i++) {
+			cgroup_path(path, sizeof(path), i, NULL);
+			if (mkdir(path, 0755) && errno != EEXIST)
+				die("cannot create %s: %s\n", path,
+				    strerror(errno));
+		}
+
+		print_result(MODE_CGROUP, run(MODE_CGROUP), base);
+
+		for (i = 0; i < nr_groups; i++) {
+			cgroup_path(path, sizeof(path), i, NULL);
+			rmdir(path);
+		}
+	}
+
+	return 0;
+}
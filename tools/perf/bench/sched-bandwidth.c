@@ -0,0 +1,207 @@
+/*
+ *
+ * sched-bandwidth.c
+ *
+ * bandwidth: Benchmark for the cpu bandwidth control of cpu cgroups
+ *
+ * Sets the quota and period of a cpu cgroup, then runs busy loops inside
+ * of it while other busy loops contend for the cpus from outside.  The
+ * cpu time the group got is compared to the quota it was given, along
+ * with the throttling statistics of its cpu.stat.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static const char *cgroup;
+static int quota_us = 25000;
+static int period_us = 100000;
+static int nr_inside = 2;
+static int nr_outside = 1;
+static int duration = 5;
+
+static const struct option options[] = {
+	OPT_STRING('c', "cgroup", &cgroup, "path",
+		    "Cpu cgroup directory to limit"),
+	OPT_INTEGER('q', "quota", &quota_us,
+		    "Quota of the group per period (usecs)"),
+	OPT_INTEGER('p', "period", &period_us,
+		    "Period of the group (usecs)"),
+	OPT_INTEGER('n', "nr", &nr_inside,
+		    "Number of busy loops in the group"),
+	OPT_INTEGER('b', "background", &nr_outside,
+		    "Number of busy loops contending from outside the group"),
+	OPT_INTEGER('t', "time", &duration,
+		    "Time to run for (secs)"),
+	OPT_END()
+};
+
+static const char * const bench_sched_bandwidth_usage[] = {
+	"perf bench sched bandwidth <options>",
+	NULL
+};
+
+static void write_file(const char *file, long val)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", cgroup, file);
+	fp = fopen(path, "w");
+	if (!fp || fprintf(fp, "%ld\n", val) < 0 || fclose(fp))
+		die("cannot write %s: %s\n", path, strerror(errno));
+}
+
+/* Returns the value of a cpu.stat field, 0 if there is none */
+static unsigned long long read_stat(const char *name)
+{
+	char path[PATH_MAX], line[BUFSIZ], field[64];
+	unsigned long long val, ret = 0;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/cpu.stat", cgroup);
+	fp = fopen(path, "r");
+	if (!fp)
+		die("cannot open %s: %s\n", path, strerror(errno));
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%63s %llu", field, &val) == 2 &&
+		    !strcmp(field, name)) {
+			ret = val;
+			break;
+		}
+	}
+	fclose(fp);
+	return ret;
+}
+
+static pid_t start_loop(int inside)
+{
+	pid_t pid = fork();
+
+	if (pid < 0)
+		die("fork failed: %s\n", strerror(errno));
+	if (pid)
+		return pid;
+
+	if (inside)
+		write_file("tasks", getpid());
+	for (;;)
+		;
+}
+
+/* Kills the loops and returns the cpu time they used, in usecs */
+static unsigned long long stop_loops(pid_t *pids, int nr)
+{
+	unsigned long long usecs = 0;
+	struct rusage ru;
+	int i, status;
+
+	for (i = 0; i < nr; i++)
+		kill(pids[i], SIGKILL);
+	for (i = 0; i < nr; i++) {
+		if (wait4(pids[i], &status, 0, &ru) != pids[i])
+			die("wait4 failed: %s\n", strerror(errno));
+		usecs += ru.ru_utime.tv_sec * 1000000ULL + ru.ru_utime.tv_usec;
+		usecs += ru.ru_stime.tv_sec * 1000000ULL + ru.ru_stime.tv_usec;
+	}
+	return usecs;
+}
+
+int bench_sched_bandwidth(int argc, const char **argv,
+			  const char *prefix __used)
+{
+	unsigned long long periods, throttled, throttled_ns;
+	unsigned long long inside_us, outside_us, wall_us;
+	double expected, measured;
+	struct timeval start, stop, diff;
+	pid_t *pids;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_sched_bandwidth_usage, 0);
+
+	if (!cgroup || quota_us <= 0 || period_us <= 0 || nr_inside <= 0 ||
+	    nr_outside < 0 || duration <= 0) {
+		usage_with_options(bench_sched_bandwidth_usage, options);
+		exit(1);
+	}
+
+	write_file("cpu.cfs_period_us", period_us);
+	write_file("cpu.cfs_quota_us", quota_us);
+
+	periods = read_stat("nr_periods");
+	throttled = read_stat("nr_throttled");
+	throttled_ns = read_stat("throttled_time");
+
+	pids = calloc(nr_inside + nr_outside, sizeof(*pids));
+	BUG_ON(!pids);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nr_inside + nr_outside; i++)
+		pids[i] = start_loop(i < nr_inside);
+	sleep(duration);
+
+	inside_us = stop_loops(pids, nr_inside);
+	gettimeofday(&stop, NULL);
+	outside_us = stop_loops(pids + nr_inside, nr_outside);
+
+	periods = read_stat("nr_periods") - periods;
+	throttled = read_stat("nr_throttled") - throttled;
+	throttled_ns = read_stat("throttled_time") - throttled_ns;
+
+	write_file("cpu.cfs_quota_us", -1);
+	free(pids);
+
+	timersub(&stop, &start, &diff);
+	wall_us = diff.tv_sec * 1000000ULL + diff.tv_usec;
+
+	/* in cpus, the group being able to use no more than it has loops */
+	expected = (double)quota_us / period_us;
+	if (expected > nr_inside)
+		expected = nr_inside;
+	measured = (double)inside_us / wall_us;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d loops limited to %dus every %dus, "
+		       "%d loops contending, %ds\n\n",
+		       nr_inside, quota_us, period_us, nr_outside, duration);
+		printf(" %14lf cpus expected\n", expected);
+		printf(" %14lf cpus used by the group (%+.1lf%%)\n", measured,
+		       (measured - expected) * 100 / expected);
+		printf(" %14lf cpus used by the contending loops\n",
+		       (double)outside_us / wall_us);
+		printf(" %14llu periods, %llu throttled\n", periods, throttled);
+		printf(" %14s: %llu.%03llu [msec]\n", "Throttled time",
+		       throttled_ns / 1000000, throttled_ns / 1000 % 1000);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf %lf %lf %llu %llu %llu\n", expected, measured,
+		       (double)outside_us / wall_us, periods, throttled,
+		       throttled_ns);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
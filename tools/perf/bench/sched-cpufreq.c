@@ -0,0 +1,324 @@
+/*
+ *
+ * sched-cpufreq.c
+ *
+ * cpufreq: Replay of a load trace under cpufreq governors
+ *
+ * Replays a trace of busy and idle periods on one cpu under each of the
+ * given governors in turn.  A busy period is a fixed amount of work, the
+ * amount the cpu does in that time at its highest frequency, so running
+ * at a lower speed makes it late: the delays are the latency metrics.
+ * The energy proxy is taken from cpufreq_stats, as the time spent at
+ * each frequency weighted by the cube of its ratio to the highest one
+ * (the dynamic power of a cpu whose voltage scales with its frequency):
+ * 1.0 would be the whole replay at the highest frequency.
+ *
+ * The trace file holds one "<busy usecs> <idle usecs>" pair per line,
+ * lines starting with '#' are ignored.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define MAX_EVENTS	65536
+#define MAX_FREQS	64
+#define CALIBRATE_USECS	200000
+
+static const char *trace_file;
+static const char *governors = "interactive,sched";
+static int cpu;
+static int loops = 1;
+
+static const struct option options[] = {
+	OPT_STRING('t', "trace", &trace_file, "file",
+		    "Load trace to replay (default: a built-in UI-like trace)"),
+	OPT_STRING('g', "governors", &governors, "list",
+		    "Comma separated governors to compare"),
+	OPT_INTEGER('c', "cpu", &cpu,
+		    "Cpu to replay the trace on"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops"),
+	OPT_END()
+};
+
+static const char * const bench_sched_cpufreq_usage[] = {
+	"perf bench sched cpufreq <options>",
+	NULL
+};
+
+struct event {
+	unsigned int busy_us;
+	unsigned int idle_us;
+};
+
+static struct event events[MAX_EVENTS];
+static int nr_events;
+
+/* Loops of work done per usec at the highest frequency */
+static double loops_per_usec;
+
+static volatile unsigned long sink;
+
+static void load_trace(void)
+{
+	char line[BUFSIZ];
+	FILE *fp;
+	int i;
+
+	if (!trace_file) {
+		/* 60fps frames of 4ms, every tenth one a 30ms burst */
+		for (i = 0; i < 500; i++) {
+			events[i].busy_us = i % 10 == 9 ? 30000 : 4000;
+			events[i].idle_us = i % 10 == 9 ? 2000 : 12000;
+		}
+		nr_events = i;
+		return;
+	}
+
+	fp = fopen(trace_file, "r");
+	if (!fp)
+		die("cannot open %s: %s\n", trace_file, strerror(errno));
+	while (fgets(line, sizeof(line), fp) && nr_events < MAX_EVENTS) {
+		struct event *e = &events[nr_events];
+
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%u %u", &e->busy_us, &e->idle_us) == 2)
+			nr_events++;
+	}
+	fclose(fp);
+
+	if (!nr_events)
+		die("no events in %s\n", trace_file);
+}
+
+static void cpufreq_path(char *path, size_t len, const char *file)
+{
+	snprintf(path, len, "/sys/devices/system/cpu/cpu%d/cpufreq/%s",
+		 cpu, file);
+}
+
+static void read_string(const char *file, char *buf, size_t len)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	cpufreq_path(path, sizeof(path), file);
+	fp = fopen(path, "r");
+	if (!fp || !fgets(buf, len, fp))
+		die("cannot read %s: %s\n", path, strerror(errno));
+	fclose(fp);
+	buf[strcspn(buf, "\n")] = '\0';
+}
+
+static void set_governor(const char *name)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	cpufreq_path(path, sizeof(path), "scaling_governor");
+	fp = fopen(path, "w");
+	if (!fp || fprintf(fp, "%s\n", name) < 0 || fclose(fp))
+		die("cannot set governor %s: %s\n", name, strerror(errno));
+}
+
+/*
+ * Reads the time spent at each frequency, in 10ms units.  Returns the
+ * number of frequencies, 0 without cpufreq_stats.
+ */
+static int read_time_in_state(unsigned long *freqs,
+			      unsigned long long *times)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+	int n = 0;
+
+	cpufreq_path(path, sizeof(path), "stats/time_in_state");
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+	while (n < MAX_FREQS &&
+	       fscanf(fp, "%lu %llu", &freqs[n], &times[n]) == 2)
+		n++;
+	fclose(fp);
+	return n;
+}
+
+static void work(unsigned long nr)
+{
+	unsigned long i;
+
+	for (i = 0; i < nr; i++)
+		sink += i;
+}
+
+static unsigned long long usecs_since(struct timeval *start)
+{
+	struct timeval stop, diff;
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, start, &diff);
+	return diff.tv_sec * 1000000ULL + diff.tv_usec;
+}
+
+static void calibrate(void)
+{
+	struct timeval start;
+	unsigned long nr = 1000000;
+	unsigned long long usecs;
+
+	set_governor("performance");
+	for (;;) {
+		gettimeofday(&start, NULL);
+		work(nr);
+		usecs = usecs_since(&start);
+		if (usecs >= CALIBRATE_USECS)
+			break;
+		nr *= 2;
+	}
+	loops_per_usec = (double)nr / usecs;
+}
+
+struct result {
+	unsigned long long total_late;
+	unsigned long long max_late;
+	unsigned long long nr_late;
+	double energy;
+};
+
+static void replay(const char *governor, struct result *r)
+{
+	unsigned long freqs[MAX_FREQS], max_freq = 0;
+	unsigned long long before[MAX_FREQS], after[MAX_FREQS];
+	unsigned long long usecs, busy_us, total = 0;
+	struct timeval start;
+	int i, loop, nr_freqs;
+
+	memset(r, 0, sizeof(*r));
+	set_governor(governor);
+	/* let the governor settle from the previous one */
+	usleep(100000);
+
+	nr_freqs = read_time_in_state(freqs, before);
+
+	for (loop = 0; loop < loops; loop++) {
+		for (i = 0; i < nr_events; i++) {
+			busy_us = events[i].busy_us;
+
+			gettimeofday(&start, NULL);
+			work(busy_us * loops_per_usec);
+			usecs = usecs_since(&start);
+
+			if (usecs > busy_us) {
+				r->total_late += usecs - busy_us;
+				if (usecs - busy_us > r->max_late)
+					r->max_late = usecs - busy_us;
+				/* more than 10% late */
+				if ((usecs - busy_us) * 10 > busy_us)
+					r->nr_late++;
+			}
+			if (events[i].idle_us)
+				usleep(events[i].idle_us);
+		}
+	}
+
+	if (nr_freqs && read_time_in_state(freqs, after) == nr_freqs) {
+		for (i = 0; i < nr_freqs; i++) {
+			if (freqs[i] > max_freq)
+				max_freq = freqs[i];
+		}
+		for (i = 0; i < nr_freqs; i++) {
+			double ratio = (double)freqs[i] / max_freq;
+
+			r->energy += (after[i] - before[i]) *
+				ratio * ratio * ratio;
+			total += after[i] - before[i];
+		}
+		if (total)
+			r->energy /= total;
+	} else {
+		r->energy = -1;
+	}
+}
+
+int bench_sched_cpufreq(int argc, const char **argv,
+			const char *prefix __used)
+{
+	char old_governor[64], *list, *governor, *saveptr;
+	unsigned long long nr_busy;
+	struct result r;
+	cpu_set_t mask;
+
+	argc = parse_options(argc, argv, options,
+			     bench_sched_cpufreq_usage, 0);
+
+	if (loops <= 0 || cpu < 0 || cpu >= CPU_SETSIZE) {
+		usage_with_options(bench_sched_cpufreq_usage, options);
+		exit(1);
+	}
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask))
+		die("cannot run on cpu %d: %s\n", cpu, strerror(errno));
+
+	load_trace();
+	nr_busy = (unsigned long long)nr_events * loops;
+
+	read_string("scaling_governor", old_governor, sizeof(old_governor));
+	calibrate();
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# replaying %d events %d times on cpu%d\n\n",
+		       nr_events, loops, cpu);
+
+	list = strdup(governors);
+	BUG_ON(!list);
+	for (governor = strtok_r(list, ",", &saveptr); governor;
+	     governor = strtok_r(NULL, ",", &saveptr)) {
+		replay(governor, &r);
+
+		switch (bench_format) {
+		case BENCH_FORMAT_DEFAULT:
+			printf(" %-14s: %lf usecs late/event, max %llu.%03llu "
+			       "[msec], %llu events >10%% late",
+			       governor, (double)r.total_late / nr_busy,
+			       r.max_late / 1000, r.max_late % 1000,
+			       r.nr_late);
+			if (r.energy >= 0)
+				printf(", energy %lf\n", r.energy);
+			else
+				printf(", no cpufreq_stats\n");
+			break;
+
+		case BENCH_FORMAT_SIMPLE:
+			printf("%s %lf %llu %llu %lf\n", governor,
+			       (double)r.total_late / nr_busy, r.max_late,
+			       r.nr_late, r.energy);
+			break;
+
+		default:
+			/* reaching here is something disaster */
+			fprintf(stderr, "Unknown format:%d\n", bench_format);
+			set_governor(old_governor);
+			exit(1);
+			break;
+		}
+	}
+	free(list);
+
+	set_governor(old_governor);
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ *
+ * sched-wakeup.c
+ *
+ * wakeup: Benchmark for the wakeup latency of short running tasks
+ *
+ * Pairs of processes pass a token over pipes, the way a client calls a
+ * binder service: the client stamps the time and wakes the server up,
+ * which runs for a short burst and replies.  Between calls the client
+ * sleeps, leaving the cpus time to go idle.  The latency is the time from
+ * the stamp to the server running, the call time the whole round trip.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* Latencies are counted in 1 usec buckets up to that */
+#define MAX_LATENCY_US	4096
+
+static int nr_pairs = 1;
+static int burst_us = 100;
+static int idle_us = 2000;
+static int loops = 10000;
+
+static const struct option options[] = {
+	OPT_INTEGER('p', "pairs", &nr_pairs,
+		    "Number of client/server pairs"),
+	OPT_INTEGER('b', "burst", &burst_us,
+		    "Time the server runs per call (usecs)"),
+	OPT_INTEGER('i', "idle", &idle_us,
+		    "Time the client sleeps between calls (usecs)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of calls per pair"),
+	OPT_END()
+};
+
+static const char * const bench_sched_wakeup_usage[] = {
+	"perf bench sched wakeup <options>",
+	NULL
+};
+
+struct stats {
+	unsigned long long total_lat;
+	unsigned long long max_lat;
+	unsigned long long total_call;
+	unsigned long long hist[MAX_LATENCY_US + 1];
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void burn(unsigned long long ns)
+{
+	unsigned long long end = now_ns() + ns;
+
+	while (now_ns() < end)
+		;
+}
+
+static void server(int in, int out, struct stats *st)
+{
+	unsigned long long stamp, lat;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		if (read(in, &stamp, sizeof(stamp)) != sizeof(stamp))
+			die("read failed: %s\n", strerror(errno));
+		lat = now_ns() - stamp;
+
+		st->total_lat += lat;
+		if (lat > st->max_lat)
+			st->max_lat = lat;
+		lat /= 1000;
+		st->hist[lat > MAX_LATENCY_US ? MAX_LATENCY_US : lat]++;
+
+		burn(burst_us * 1000ULL);
+		if (write(out, &stamp, sizeof(stamp)) != sizeof(stamp))
+			die("write failed: %s\n", strerror(errno));
+	}
+}
+
+static void client(int in, int out, struct stats *st)
+{
+	unsigned long long stamp;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		if (idle_us)
+			usleep(idle_us);
+
+		stamp = now_ns();
+		if (write(out, &stamp, sizeof(stamp)) != sizeof(stamp))
+			die("write failed: %s\n", strerror(errno));
+		if (read(in, &stamp, sizeof(stamp)) != sizeof(stamp))
+			die("read failed: %s\n", strerror(errno));
+		st->total_call += now_ns() - stamp;
+	}
+}
+
+static pid_t start(void (*fn)(int, int, struct stats *), int in, int out,
+		   struct stats *st)
+{
+	pid_t pid = fork();
+
+	if (pid < 0)
+		die("fork failed: %s\n", strerror(errno));
+	if (!pid) {
+		fn(in, out, st);
+		exit(0);
+	}
+	return pid;
+}
+
+/* Returns the latency under which that permille of the wakeups were, usecs */
+static unsigned long long percentile(unsigned long long *hist,
+				     unsigned long long nr, int permille)
+{
+	unsigned long long sum = 0;
+	int i;
+
+	for (i = 0; i < MAX_LATENCY_US; i++) {
+		sum += hist[i];
+		if (sum * 1000 >= nr * permille)
+			break;
+	}
+	return i + 1;
+}
+
+int bench_sched_wakeup(int argc, const char **argv,
+		       const char *prefix __used)
+{
+	unsigned long long total_lat = 0, max_lat = 0, total_call = 0, nr;
+	unsigned long long *hist;
+	struct stats *stats;
+	int to_server[2], to_client[2];
+	int i, j, status;
+	pid_t *pids;
+
+	argc = parse_options(argc, argv, options,
+			     bench_sched_wakeup_usage, 0);
+
+	if (nr_pairs <= 0 || burst_us < 0 || idle_us < 0 || loops <= 0) {
+		usage_with_options(bench_sched_wakeup_usage, options);
+		exit(1);
+	}
+
+	stats = mmap(NULL, nr_pairs * sizeof(*stats), PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	BUG_ON(stats == MAP_FAILED);
+	pids = calloc(2 * nr_pairs, sizeof(*pids));
+	hist = calloc(MAX_LATENCY_US + 1, sizeof(*hist));
+	BUG_ON(!pids || !hist);
+
+	for (i = 0; i < nr_pairs; i++) {
+		if (pipe(to_server) || pipe(to_client))
+			die("pipe failed: %s\n", strerror(errno));
+		pids[2 * i] = start(server, to_server[0], to_client[1],
+				    &stats[i]);
+		pids[2 * i + 1] = start(client, to_client[0], to_server[1],
+					&stats[i]);
+		close(to_server[0]);
+		close(to_server[1]);
+		close(to_client[0]);
+		close(to_client[1]);
+	}
+
+	for (i = 0; i < 2 * nr_pairs; i++) {
+		if (waitpid(pids[i], &status, 0) != pids[i] ||
+		    !WIFEXITED(status) || WEXITSTATUS(status))
+			die("a benchmark process failed\n");
+	}
+
+	for (i = 0; i < nr_pairs; i++) {
+		total_lat += stats[i].total_lat;
+		total_call += stats[i].total_call;
+		if (stats[i].max_lat > max_lat)
+			max_lat = stats[i].max_lat;
+		for (j = 0; j <= MAX_LATENCY_US; j++)
+			hist[j] += stats[i].hist[j];
+	}
+	nr = (unsigned long long)nr_pairs * loops;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d pairs, %d calls each, %dus bursts every %dus\n\n",
+		       nr_pairs, loops, burst_us, idle_us);
+		printf(" %14lf usecs/wakeup\n", (double)total_lat / nr / 1000);
+		printf(" %14llu usecs 50th percentile\n",
+		       percentile(hist, nr, 500));
+		printf(" %14llu usecs 99th percentile\n",
+		       percentile(hist, nr, 990));
+		printf(" %14s: %llu.%03llu [msec]\n", "Max wakeup",
+		       max_lat / 1000000, max_lat / 1000 % 1000);
+		printf(" %14lf usecs/call\n", (double)total_call / nr / 1000);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf %llu %llu %llu %lf\n",
+		       (double)total_lat / nr / 1000,
+		       percentile(hist, nr, 500), percentile(hist, nr, 990),
+		       max_lat / 1000, (double)total_call / nr / 1000);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	free(hist);
+	free(pids);
+	munmap(stats, nr_pairs * sizeof(*stats));
+	return 0;
+}
@@ -13,6 +13,7 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  io    ... block I/O latency
  *
  */
 
@@ -42,6 +43,18 @@ static struct bench_suite sched_suites[] = {
 	{ "pipe",
 	  "Flood of communication over pipe() between two processes",
 	  bench_sched_pipe      },
+	{ "cpufreq",
+	  "Replay of a load trace under cpufreq governors",
+	  bench_sched_cpufreq   },
+	{ "wakeup",
+	  "Wakeup latency of short running tasks",
+	  bench_sched_wakeup    },
+	{ "bandwidth",
+	  "Cpu time of a cpu cgroup under a quota, against contention",
+	  bench_sched_bandwidth },
+	{ "autogroup",
+	  "Cost of grouping new processes by autogroup or cgroup",
+	  bench_sched_autogroup },
 	suite_all,
 	{ NULL,
 	  NULL,
@@ -52,12 +65,37 @@ static struct bench_suite mem_suites[] = {
 	{ "memcpy",
 	  "Simple memory copy in various ways",
 	  bench_mem_memcpy },
+	{ "smaps",
+	  "Summing smaps against reading smaps_rollup",
+	  bench_mem_smaps },
+	{ "mmap",
+	  "Faulting in a mapped file from the page cache",
+	  bench_mem_mmap },
+	{ "madvise",
+	  "Allocator churn with MADV_FREE or MADV_DONTNEED",
+	  bench_mem_madvise },
+	{ "compact",
+	  "Order-4 allocation latency on fragmented memory",
+	  bench_mem_compact },
+	{ "charge",
+	  "Page charge latency in a memory cgroup",
+	  bench_mem_charge },
 	suite_all,
 	{ NULL,
 	  NULL,
 	  NULL             }
 };
 
+static struct bench_suite io_suites[] = {
+	{ "launch",
+	  "Application start-up reads under a sequential writer",
+	  bench_io_launch },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL            }
+};
+
 struct bench_subsys {
 	const char *name;
 	const char *summary;
@@ -71,6 +109,9 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "io",
+	  "block I/O latency",
+	  io_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },